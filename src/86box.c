@@ -103,6 +103,7 @@
 #include <86box/version.h>
 #include <86box/gdbstub.h>
 #include <86box/machine_status.h>
+#include <86box/perf.h>
 #include <86box/apm.h>
 #include <86box/acpi.h>
 #include <86box/nv/vid_nv_rivatimer.h>
@@ -137,6 +138,7 @@ int video_fps = RENDER_FPS; /* (O) render speed in fps */
 #endif
 int settings_only     = 0; /* (O) show only the settings dialog */
 int confirm_exit_cmdl = 1; /* (O) do not ask for confirmation on quit if set to 0 */
+int unthrottled       = 0; /* (O) run the emulation as fast as the host allows */
 #ifdef _WIN32
 uint64_t unique_id   = 0;
 uint64_t source_hwnd = 0;
@@ -190,10 +192,17 @@ int      lba_enhancer_enabled                   = 0;              /* (C) enable
 int      ibm8514_standalone_enabled             = 0;              /* (C) video option */
 int      xga_standalone_enabled                 = 0;              /* (C) video option */
 int      da2_standalone_enabled                 = 0;              /* (C) video option */
+int      svga_render_thread                     = 0;              /* (C) render SVGA scanlines on a worker thread */
 uint32_t mem_size                               = 0;              /* (C) memory size (Installed on
                                                                          system board)*/
 uint32_t isa_mem_size                           = 0;              /* (C) memory size (ISA Memory Cards) */
 int      cpu_use_dynarec                        = 0;              /* (C) cpu uses/needs Dyna */
+int      cpu_dynarec_cache_size                 = 0;              /* (C) dynarec code cache size in MB,
+                                                                         0 = maximum */
+int      cpu_dynarec_tcache                     = 0;              /* (C) keep a persistent dynarec
+                                                                         translation cache */
+char     mem_file[1024]                         = { '\0' };      /* (C) file to back guest RAM with,
+                                                                         empty = anonymous memory */
 int      cpu                                    = 0;              /* (C) cpu type */
 int      fpu_type                               = 0;              /* (C) fpu type */
 int      fpu_softfloat                          = 0;              /* (C) fpu uses softfloat */
@@ -637,6 +646,10 @@ usage:
             printf("\nUsage: 86box [options] [cfg-file]\n\n");
             printf("Valid options are:\n\n");
             printf("-? or --help            - show this information\n");
+            printf("-A or --replay path     - replay the Voodoo capture 'path' on the configured card,\n");
+            printf("                          with -B 0 to exit once it is checked\n");
+            printf("-B or --benchmark secs  - run headless and unthrottled for 'secs' emulated seconds\n");
+            printf("                          (0 = until the guest ends it) and print a JSON report\n");
             printf("-C or --config path     - set 'path' to be config file\n");
 #ifdef _WIN32
             printf("-D or --debug           - force debug output logging\n");
@@ -658,11 +671,13 @@ usage:
             printf("-M or --missing         - dump missing machines and video cards\n");
             printf("-N or --noconfirm       - do not ask for confirmation on quit\n");
             printf("-P or --vmpath path     - set 'path' to be root for vm\n");
+            printf("-Q or --benchout path   - write the benchmark report to 'path'\n");
             printf("-R or --rompath path    - set 'path' to be ROM path\n");
 #ifndef USE_SDL_UI
             printf("-S or --settings        - show only the settings dialog\n");
 #endif
             printf("-T or --testmode        - test mode: execute the test mode entry point on init/hard reset\n");
+            printf("-U or --unthrottled     - run the emulation as fast as the host allows\n");
             printf("-V or --vmname name     - overrides the name of the running VM\n");
             printf("-W or --nohook          - disables keyboard hook (compatibility-only outside Windows)\n");
             printf("-X or --clear what      - clears the 'what' (cmos/flash/both)\n");
@@ -736,6 +751,25 @@ usage:
 #endif
         } else if (!strcasecmp(argv[c], "--testmode") || !strcasecmp(argv[c], "-T")) {
             test_mode = 1;
+        } else if (!strcasecmp(argv[c], "--benchmark") || !strcasecmp(argv[c], "-B")) {
+            if ((c + 1) == argc)
+                goto usage;
+
+            perf_bench_enabled = 1;
+            perf_bench_secs    = strtoul(argv[++c], NULL, 10);
+            unthrottled        = 1;
+        } else if (!strcasecmp(argv[c], "--benchout") || !strcasecmp(argv[c], "-Q")) {
+            if ((c + 1) == argc)
+                goto usage;
+
+            strncpy(perf_bench_report, argv[++c], sizeof(perf_bench_report) - 1);
+        } else if (!strcasecmp(argv[c], "--replay") || !strcasecmp(argv[c], "-A")) {
+            if ((c + 1) == argc)
+                goto usage;
+
+            strncpy(voodoo_replay_path, argv[++c], sizeof(voodoo_replay_path) - 1);
+        } else if (!strcasecmp(argv[c], "--unthrottled") || !strcasecmp(argv[c], "-U")) {
+            unthrottled = 1;
         } else if (!strcasecmp(argv[c], "--noconfirm") || !strcasecmp(argv[c], "-N")) {
             confirm_exit_cmdl = 0;
         } else if (!strcasecmp(argv[c], "--missing") || !strcasecmp(argv[c], "-M")) {
@@ -1497,6 +1531,10 @@ pc_close(UNUSED(thread_t *ptr))
 
     config_save();
 
+#ifdef USE_NEW_DYNAREC
+    codegen_tcache_save();
+#endif
+
     plat_mouse_capture(0);
 
     /* Close all the memory mappings. */
@@ -1577,6 +1615,7 @@ pc_run(void)
     /* Run a block of code. */
     startblit();
     cpu_exec((int32_t) cpu_s->rspeed / 100);
+    perf_counters.emu_slices++;
     ack_pause();
 #ifdef USE_GDBSTUB /* avoid a KBC FIFO overflow when CPU emulation is stalled */
     if (gdbstub_step == GDBSTUB_EXEC) {
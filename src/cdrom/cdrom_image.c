@@ -95,6 +95,11 @@ typedef struct cd_image_t {
     uint32_t     *bad_sectors;
 } cd_image_t;
 
+/* Off by default: an I/O error or a file truncated behind our back on
+   removable or network storage faults the mapping and kills the emulator,
+   where the stdio path just fails the read. */
+int cdrom_image_mmap = 0; /* (C) serve binary image reads from a file mapping */
+
 #ifdef ENABLE_IMAGE_LOG
 int image_do_log = ENABLE_IMAGE_LOG;
 
@@ -219,6 +224,20 @@ cleanup_error:
 }
 
 /* Binary file functions. */
+
+/* Copies count bytes swapping each pair, for MOTOROLA (big-endian audio)
+   tracks; src may equal dst. */
+static void
+bin_swap_copy(uint8_t *dst, const uint8_t *src, size_t count)
+{
+    for (size_t i = 0; (i + 1) < count; i += 2) {
+        const uint8_t b0 = src[i];
+        const uint8_t b1 = src[i + 1];
+        dst[i]           = b1;
+        dst[i + 1]       = b0;
+    }
+}
+
 static int
 bin_read(void *priv, uint8_t *buffer, const uint64_t seek, const size_t count)
 {
@@ -230,6 +249,21 @@ bin_read(void *priv, uint8_t *buffer, const uint64_t seek, const size_t count)
     image_log(tf->log, "binary_read(%08lx, pos=%" PRIu64 " count=%lu)\n",
                     tf->fp, seek, count);
 
+    if (tf->map != NULL) {
+        if ((seek > tf->map_size) || (count > (tf->map_size - seek))) {
+            image_log(tf->log, "binary_read failed, past the end of the file!\n");
+
+            return -1;
+        }
+
+        if (UNLIKELY(tf->motorola))
+            bin_swap_copy(buffer, &tf->map[seek], count);
+        else
+            memcpy(buffer, &tf->map[seek], count);
+
+        return 1;
+    }
+
     if (fseeko64(tf->fp, seek, SEEK_SET) == -1) {
         image_log(tf->log, "binary_read failed during seek!\n");
 
@@ -242,14 +276,8 @@ bin_read(void *priv, uint8_t *buffer, const uint64_t seek, const size_t count)
         return -1;
     }
 
-    if (UNLIKELY(tf->motorola)) {
-        for (uint64_t i = 0; i < count; i += 2) {
-            const uint8_t buffer0 = buffer[i];
-            const uint8_t buffer1 = buffer[i + 1];
-            buffer[i] = buffer1;
-            buffer[i + 1] = buffer0;
-        }
-    }
+    if (UNLIKELY(tf->motorola))
+        bin_swap_copy(buffer, buffer, count);
 
     return 1;
 }
@@ -262,6 +290,9 @@ bin_get_length(void *priv)
     if (tf->fp == NULL)
         return 0;
 
+    if (tf->map != NULL)
+        return tf->map_size;
+
     fseeko64(tf->fp, 0, SEEK_END);
     const off64_t len = ftello64(tf->fp);
     image_log(tf->log, "binary_length(%08lx) = %" PRIu64 "\n", tf->fp, len);
@@ -277,6 +308,11 @@ bin_close(void *priv)
     if (tf == NULL)
         return;
 
+    if (tf->map != NULL) {
+        plat_munmap_file(tf->map, tf->map_size);
+        tf->map = NULL;
+    }
+
     if (tf->fp != NULL) {
         fclose(tf->fp);
         tf->fp = NULL;
@@ -319,6 +355,14 @@ bin_init(const uint8_t id, const char *filename, int *error)
 
         sprintf(n, "CD-ROM %i Bin  ", id + 1);
         tf->log          = log_open(n);
+
+        /* Serve reads straight from a mapping of the file if enabled, stdio
+           remains the fallback (e.g. images too large to map). */
+        if (cdrom_image_mmap) {
+            tf->map_size = bin_get_length(tf);
+            tf->map      = (uint8_t *) plat_mmap_file(tf->fp, tf->map_size);
+            image_log(tf->log, "binary_map(%s) = %08lx\n", tf->fn, tf->map);
+        }
     } else {
         /* From the check above, error may still be non-zero if opening a directory.
          * The error is set for viso to try and open the directory following this function.
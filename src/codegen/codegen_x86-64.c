@@ -17,6 +17,7 @@
 #    include "x87_sf.h"
 #    include "x87.h"
 #    include <86box/mem.h>
+#    include <86box/perf.h>
 #    include <86box/plat_unused.h>
 
 #    include "386_common.h"
@@ -171,6 +172,7 @@ delete_block(codeblock_t *block)
     if (block->valid == 0)
         fatal("Deleting deleted block\n");
     block->valid = 0;
+    perf_counters.blocks_invalidated++;
 
     codeblock_tree_delete(block);
     remove_from_block_list(block, old_pc);
@@ -256,6 +258,7 @@ codegen_block_start_recompile(codeblock_t *block)
     if (block->pc != cs + cpu_state.pc || block->was_recompiled)
         fatal("Recompile to used block!\n");
 
+    perf_counters.blocks_compiled++;
     block->status = cpu_cur_status;
 
     block_pos = BLOCK_GPF_OFFSET;
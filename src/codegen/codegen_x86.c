@@ -47,6 +47,7 @@
 #    include <86box/plat.h>
 #    include "cpu.h"
 #    include <86box/mem.h>
+#    include <86box/perf.h>
 #    include "x86.h"
 #    include "x86_flags.h"
 #    include "x86_ops.h"
@@ -1347,6 +1348,7 @@ delete_block(codeblock_t *block)
     if (!block->valid)
         fatal("Deleting deleted block\n");
     block->valid = 0;
+    perf_counters.blocks_invalidated++;
 
     codeblock_tree_delete(block);
     remove_from_block_list(block, old_pc);
@@ -1431,6 +1433,7 @@ codegen_block_start_recompile(codeblock_t *block)
     if (block->pc != cs + cpu_state.pc || block->was_recompiled)
         fatal("Recompile to used block!\n");
 
+    perf_counters.blocks_compiled++;
     block->status = cpu_cur_status;
 
     block_pos = BLOCK_GPF_OFFSET;
@@ -30,6 +30,10 @@
   same page).
 */
 
+/*Number of successors remembered per block, enough for both sides of a
+  conditional branch.*/
+#define CODEBLOCK_LINKS 2
+
 typedef struct codeblock_t {
     uint32_t pc;
     uint32_t _cs;
@@ -57,6 +61,21 @@ typedef struct codeblock_t {
     /*First mem_block_t used by this block. Any subsequent mem_block_ts
       will be in the list starting at head_mem_block->next.*/
     struct mem_block_t *head_mem_block;
+
+    /*Bumped every time the block is invalidated or deleted, which unlinks
+      it from every block that has it as a successor.*/
+    uint32_t gen;
+
+    /*Blocks this block was last seen to exit to, see codegen_block_link_find().
+      Only valid while link_epoch matches codegen_link_epoch.*/
+    uint32_t link_epoch;
+    uint32_t link_gen[CODEBLOCK_LINKS];
+    uint16_t link[CODEBLOCK_LINKS];
+    uint8_t  link_next;
+
+    /*Aged execution count, used to pick a block to evict when the code cache
+      is full, see codegen_evict_block().*/
+    uint8_t uses;
 } codeblock_t;
 
 extern codeblock_t *codeblock;
@@ -92,6 +111,13 @@ get_block_nr(codeblock_t *block)
     return ((uintptr_t) block - (uintptr_t) codeblock) / sizeof(codeblock_t);
 }
 
+static inline void
+codegen_block_touch(codeblock_t *block)
+{
+    if (block->uses != 0xff)
+        block->uses++;
+}
+
 static inline codeblock_t *
 codeblock_tree_find(uint32_t phys, uint32_t _cs)
 {
@@ -297,6 +323,19 @@ extern void codegen_block_start_recompile(codeblock_t *block);
 extern void codegen_block_end_recompile(codeblock_t *block);
 extern void codegen_block_end(void);
 extern void codegen_delete_block(codeblock_t *block);
+
+/*Block linking. Every time the dispatcher goes from one compiled block to
+  the next, the successor is remembered in the predecessor. The next time
+  round the successor can then be entered without the hash lookup, tree walk
+  and address translation. The remaining checks (dirty masks, FPU TOP) are
+  still done by the dispatcher, as are interrupts and timers between blocks.
+
+  Links are dropped when either side is invalidated or deleted (the block
+  generation changes) and when the MMU cache is flushed (the link epoch
+  changes), as the linear to physical mapping may be different then.*/
+extern codeblock_t *codegen_block_link_find(void);
+extern void         codegen_block_link_add(codeblock_t *block);
+extern void         codegen_block_link_set_prev(codeblock_t *block);
 extern void codegen_generate_call(uint8_t opcode, OpFn op, uint32_t fetchdat, uint32_t new_pc, uint32_t old_pc);
 extern void codegen_generate_seg_restore(void);
 extern void codegen_set_op32(void);
@@ -307,10 +346,24 @@ x86seg     *codegen_generate_ea(struct ir_data_t *ir, x86seg *op_ea_seg, uint32_
 extern void codegen_check_seg_read(codeblock_t *block, struct ir_data_t *ir, x86seg *seg);
 extern void codegen_check_seg_write(codeblock_t *block, struct ir_data_t *ir, x86seg *seg);
 
+/*Persistent translation cache, see codegen_tcache.c. codegen_tcache_prewarm()
+  returns a freshly marked block ready to be compiled, or NULL if the profile
+  has nothing matching the current guest code.*/
+extern void         codegen_tcache_init(void);
+extern void         codegen_tcache_reset(void);
+extern void         codegen_tcache_record(codeblock_t *block);
+extern codeblock_t *codegen_tcache_prewarm(uint32_t phys_addr);
+
 extern int codegen_purge_purgable_list(void);
-/*Delete a random code block to free memory. This is obviously quite expensive, and
-  will only be called when the allocator is out of memory*/
-extern void codegen_delete_random_block(int required_mem_block);
+/*Delete the least recently used code block to free memory. This is quite
+  expensive, and will only be called when the block pool or the allocator is
+  out of memory.
+
+  Blocks are picked with a clock sweep over the block pool: every block passed
+  over has its use count halved, and the first block found with a use count of
+  zero is deleted. Blocks that are executed often therefore survive several
+  sweeps, while blocks that are no longer executed go on the next one.*/
+extern void codegen_evict_block(int required_mem_block);
 
 extern int      cpu_block_end;
 extern uint32_t codegen_endpc;
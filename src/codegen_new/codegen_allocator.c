@@ -31,6 +31,26 @@ static uint8_t    *mem_block_alloc = NULL;
 
 int codegen_allocator_usage = 0;
 
+/*Number of mem_block_ts that may be in use at once, from the configured code
+  cache size. This is looked up on every allocation, so a new size takes effect
+  straight away; when shrinking, blocks are evicted as new code is compiled.*/
+static int
+codegen_allocator_limit(void)
+{
+    uint64_t limit;
+
+    if (cpu_dynarec_cache_size <= 0)
+        return MEM_BLOCK_NR;
+
+    limit = ((uint64_t) cpu_dynarec_cache_size << 20) / MEM_BLOCK_SIZE;
+    if (limit < MEM_BLOCK_MIN)
+        limit = MEM_BLOCK_MIN;
+    else if (limit > MEM_BLOCK_NR)
+        limit = MEM_BLOCK_NR;
+
+    return (int) limit;
+}
+
 void
 codegen_allocator_init(void)
 {
@@ -53,13 +73,9 @@ codegen_allocator_allocate(mem_block_t *parent, int code_block)
     mem_block_t *block;
     uint32_t     block_nr;
 
-    while (!mem_block_free_list) {
-        /*Pick a random memory block and free the owning code block*/
-        block_nr = rand() & MEM_BLOCK_MASK;
-        block    = &mem_blocks[block_nr];
-
-        if (block->code_block && block->code_block != code_block)
-            codegen_delete_block(&codeblock[block->code_block]);
+    while (!mem_block_free_list || (codegen_allocator_usage >= codegen_allocator_limit())) {
+        /*Free the least recently used code block that owns memory*/
+        codegen_evict_block(1);
     }
 
     /*Remove from free list*/
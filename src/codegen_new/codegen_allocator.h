@@ -21,6 +21,8 @@
 
 #define MEM_BLOCK_MASK (MEM_BLOCK_NR - 1)
 #define MEM_BLOCK_SIZE 0x3c0
+/*Lower bound on the configurable code cache size, a little under 1 MB*/
+#define MEM_BLOCK_MIN 1024
 
 void codegen_allocator_init(void);
 /*Allocate a mem_block_t, and the associated backing memory.
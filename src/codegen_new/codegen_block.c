@@ -5,6 +5,7 @@
 #include <86box/86box.h>
 #include "cpu.h"
 #include <86box/mem.h>
+#include <86box/perf.h>
 #include <86box/plat_unused.h>
 
 #include "x86.h"
@@ -39,6 +40,10 @@ uint32_t op_old_pc;
 
 uint32_t recomp_page = -1;
 
+/*Block linking state, see codegen.h.*/
+static uint32_t     codegen_link_epoch = 1;
+static codeblock_t *codegen_link_prev  = NULL;
+
 int        block_current = 0;
 static int block_num;
 int        block_pos;
@@ -58,6 +63,7 @@ uint32_t instr_counts[256 * 256];
 #endif
 
 static uint16_t block_free_list;
+static int      codegen_evict_hand = 1;
 static void     delete_block(codeblock_t *block);
 static void     delete_dirty_block(codeblock_t *block);
 
@@ -204,7 +210,7 @@ block_free_list_get(void)
         }
         /*Free list is empty - free up a block*/
         if (!codegen_purge_purgable_list())
-            codegen_delete_random_block(0);
+            codegen_evict_block(0);
     }
 
     block           = &codeblock[block_free_list];
@@ -225,6 +231,7 @@ codegen_init(void)
         block_free_list_add(&codeblock[c]);
     block_dirty_list_head = block_dirty_list_tail = 0;
     dirty_list_size                               = 0;
+    codegen_tcache_init();
 #ifdef DEBUG_EXTRA
     memset(instr_counts, 0, sizeof(instr_counts));
 #endif
@@ -249,6 +256,10 @@ codegen_reset(void)
     memset(codeblock_hash, 0, HASH_SIZE * sizeof(uint16_t));
     mem_reset_page_blocks();
 
+    codegen_link_epoch++;
+    codegen_link_prev = NULL;
+    codegen_tcache_reset();
+
     block_free_list = 0;
     for (c = 0; c < BLOCK_SIZE; c++) {
         codeblock[c].pc = BLOCK_PC_INVALID;
@@ -376,6 +387,8 @@ invalidate_block(codeblock_t *block)
     if (block->pc == BLOCK_PC_INVALID)
         fatal("Invalidating deleted block\n");
 #endif
+    perf_counters.blocks_invalidated++;
+    block->gen++;
     remove_from_block_list(block, old_pc);
     block_dirty_list_add(block);
     if (block->head_mem_block)
@@ -396,6 +409,8 @@ delete_block(codeblock_t *block)
         fatal("Deleting deleted block\n");
 #endif
     block->pc = BLOCK_PC_INVALID;
+    block->gen++;
+    perf_counters.blocks_invalidated++;
 
     codeblock_tree_delete(block);
     if (block->flags & CODEBLOCK_IN_DIRTY_LIST)
@@ -419,6 +434,7 @@ delete_dirty_block(codeblock_t *block)
         fatal("Deleting deleted block\n");
 #endif
     block->pc = BLOCK_PC_INVALID;
+    block->gen++;
 
     codeblock_tree_delete(block);
     block_free_list_add(block);
@@ -432,21 +448,33 @@ codegen_delete_block(codeblock_t *block)
 }
 
 void
-codegen_delete_random_block(int required_mem_block)
+codegen_evict_block(int required_mem_block)
 {
-    int block_nr = rand() & BLOCK_MASK;
+    /*Every block is aged at most eight times before its count reaches
+      zero, allow for that plus a final pass to find it.*/
+    int scanned = 0;
+
+    while (scanned < BLOCK_SIZE * 9) {
+        int block_nr = codegen_evict_hand;
+
+        codegen_evict_hand = (codegen_evict_hand + 1) & BLOCK_MASK;
+        scanned++;
 
-    while (1) {
         if (block_nr && block_nr != block_current) {
             codeblock_t *block = &codeblock[block_nr];
 
             if (block->pc != BLOCK_PC_INVALID && (!required_mem_block || block->head_mem_block)) {
-                delete_block(block);
-                return;
+                if (!block->uses) {
+                    perf_counters.blocks_evicted++;
+                    delete_block(block);
+                    return;
+                }
+                block->uses >>= 1;
             }
         }
-        block_nr = (block_nr + 1) & BLOCK_MASK;
     }
+
+    fatal("codegen_evict_block: no block to evict\n");
 }
 
 void
@@ -514,6 +542,7 @@ codegen_block_init(uint32_t phys_addr)
         fatal("codegen_block_init: block_free_list_get() returned NULL\n");
 #endif
     block_current = get_block_nr(block);
+    perf_counters.blocks_missed++;
 
     block_num                 = HASH(phys_addr);
     codeblock_hash[block_num] = block_current;
@@ -529,6 +558,8 @@ codegen_block_init(uint32_t phys_addr)
     block->page_mask = block->page_mask2 = 0;
     block->flags                         = CODEBLOCK_STATIC_TOP;
     block->status                        = cpu_cur_status;
+    block->link_epoch                    = 0;
+    block->uses                          = 1;
 
     recomp_page = block->phys & ~0xfff;
     codeblock_tree_add(block);
@@ -560,6 +591,7 @@ codegen_block_start_recompile(codeblock_t *block)
 
     block->head_mem_block = codegen_allocator_allocate(NULL, block_current);
     block->data           = codeblock_allocator_get_ptr(block->head_mem_block);
+    perf_counters.blocks_compiled++;
 
     block->status = cpu_cur_status;
 
@@ -776,12 +808,67 @@ codegen_block_end_recompile(codeblock_t *block)
 
     codegen_accumulate_flush(ir_data);
     codegen_ir_compile(ir_data, block);
+    codegen_tcache_record(block);
 }
 
+/*Called whenever the MMU cache is flushed. Linear to physical translations
+  may have changed, so drop all block links.*/
 void
 codegen_flush(void)
 {
-    return;
+    codegen_link_epoch++;
+}
+
+codeblock_t *
+codegen_block_link_find(void)
+{
+    const codeblock_t *prev = codegen_link_prev;
+
+    if (!prev || (prev->link_epoch != codegen_link_epoch))
+        return NULL;
+
+    for (uint8_t c = 0; c < CODEBLOCK_LINKS; c++) {
+        codeblock_t *block;
+
+        if (prev->link[c] == BLOCK_INVALID)
+            continue;
+
+        block = &codeblock[prev->link[c]];
+        if ((block->gen == prev->link_gen[c]) && (block->pc == cs + cpu_state.pc) && (block->_cs == cs) &&
+            !((block->status ^ cpu_cur_status) & CPU_STATUS_FLAGS) &&
+            ((block->status & cpu_cur_status & CPU_STATUS_MASK) == (cpu_cur_status & CPU_STATUS_MASK)))
+            return block;
+    }
+
+    return NULL;
+}
+
+void
+codegen_block_link_add(codeblock_t *block)
+{
+    codeblock_t *prev = codegen_link_prev;
+    uint8_t      c;
+
+    if (!prev)
+        return;
+
+    if (prev->link_epoch != codegen_link_epoch) {
+        memset(prev->link, 0, sizeof(prev->link));
+        prev->link_epoch = codegen_link_epoch;
+        prev->link_next  = 0;
+    }
+
+    /*Replace the oldest link.*/
+    c                 = prev->link_next;
+    prev->link[c]     = get_block_nr(block);
+    prev->link_gen[c] = block->gen;
+    prev->link_next   = (c + 1) % CODEBLOCK_LINKS;
+}
+
+void
+codegen_block_link_set_prev(codeblock_t *block)
+{
+    codegen_link_prev = block;
 }
 
 void
@@ -1,9 +1,13 @@
 #include <stdint.h>
+#include <string.h>
 #include <86box/86box.h>
 #include "cpu.h"
 #include <86box/mem.h>
+#include <86box/perf.h>
 #include <86box/plat_unused.h>
 
+#include "x86.h"
+#include "x86_flags.h"
 #include "codegen.h"
 #include "codegen_allocator.h"
 #include "codegen_backend.h"
@@ -59,6 +63,120 @@ duplicate_uop(ir_data_t *ir, uop_t *uop, int offset)
     }
 }
 
+static inline int
+flags_op_is_zn(const uop_t *uop)
+{
+    return ((uop->type & UOP_MASK) == (UOP_MOV_IMM & UOP_MASK)) && ((uop->imm_data == FLAGS_ZN8) || (uop->imm_data == FLAGS_ZN16) || (uop->imm_data == FLAGS_ZN32));
+}
+
+/*Flag liveness pass. flags_op1 and flags_op2 are only ever looked at through
+  flags_op, and none of the FLAGS_ZN* evaluations use them, so a write to
+  either is dead if every later reader or observation point (barriers and block
+  exits, including the end of the block) sees flags_op set to FLAGS_ZN*, or
+  sees the register overwritten first. This catches the common case of an
+  ADD/SUB/CMP followed by a logic op, where codegen_reg_mark_as_required()
+  would otherwise keep the stale operands alive to be written back.
+
+  The forward pass records whether flags_op is known to be FLAGS_ZN* before
+  each uOP. Barriers may change flags_op, and jump destinations merge paths,
+  so both drop back to unknown. The backward pass then tracks whether the
+  current value of each register is dead, merging in the state at the
+  destination of each jump.*/
+static uint8_t ir_flags_zn[UOP_NR_MAX + 1];
+static uint8_t ir_flags_dead[UOP_NR_MAX + 1];
+static uint8_t ir_jump_dest[UOP_NR_MAX + 1];
+
+#define DEAD_OP1 (1 << 0)
+#define DEAD_OP2 (1 << 1)
+
+static void
+codegen_ir_flags_liveness(ir_data_t *ir)
+{
+    int zn   = 0;
+    int dead;
+    int c;
+
+    memset(ir_jump_dest, 0, ir->wr_pos + 1);
+    for (c = 0; c < ir->wr_pos; c++) {
+        const uop_t *uop = &ir->uops[c];
+
+        if ((uop->type & UOP_TYPE_JUMP) && uop->jump_dest_uop >= 0 && uop->jump_dest_uop <= ir->wr_pos)
+            ir_jump_dest[uop->jump_dest_uop] = 1;
+    }
+
+    for (c = 0; c < ir->wr_pos; c++) {
+        const uop_t *uop = &ir->uops[c];
+
+        if (ir_jump_dest[c])
+            zn = 0;
+        ir_flags_zn[c] = zn;
+
+        if ((uop->type & UOP_MASK) == UOP_INVALID)
+            continue;
+        if (uop->type & UOP_TYPE_BARRIER)
+            zn = 0;
+        if (!ir_reg_is_invalid(uop->dest_reg_a) && IREG_GET_REG(uop->dest_reg_a.reg) == IREG_flags_op)
+            zn = flags_op_is_zn(uop);
+    }
+    if (ir_jump_dest[ir->wr_pos])
+        zn = 0;
+
+    /*Nothing outside the block will look at the operands either if the block
+      ends with flags_op set to FLAGS_ZN*.*/
+    dead                      = zn ? (DEAD_OP1 | DEAD_OP2) : 0;
+    ir_flags_dead[ir->wr_pos] = dead;
+
+    for (c = ir->wr_pos - 1; c >= 0; c--) {
+        const uop_t *uop = &ir->uops[c];
+
+        if ((uop->type & UOP_MASK) == UOP_INVALID) {
+            ir_flags_dead[c] = dead;
+            continue;
+        }
+
+        if (uop->type & UOP_TYPE_JUMP) {
+            if (uop->jump_dest_uop >= 0 && uop->jump_dest_uop <= ir->wr_pos)
+                dead &= ir_flags_dead[uop->jump_dest_uop];
+            else
+                dead = 0;
+        }
+
+        if (!ir_reg_is_invalid(uop->dest_reg_a)) {
+            int reg = IREG_GET_REG(uop->dest_reg_a.reg);
+
+            if (reg == IREG_flags_op1 || reg == IREG_flags_op2) {
+                int            mask = (reg == IREG_flags_op1) ? DEAD_OP1 : DEAD_OP2;
+                reg_version_t *regv = &reg_version[reg][uop->dest_reg_a.version];
+
+                if (!reg_is_native_size(uop->dest_reg_a)) {
+                    /*Partial writes merge with the previous version*/
+                    dead &= ~mask;
+                } else {
+                    if ((dead & mask) && !(uop->type & (UOP_TYPE_BARRIER | UOP_TYPE_ORDER_BARRIER)) && !regv->refcount && (regv->flags & REG_FLAGS_REQUIRED) && !(regv->flags & REG_FLAGS_DEAD)) {
+                        regv->flags &= ~REG_FLAGS_REQUIRED;
+                        add_to_dead_list(regv, reg, uop->dest_reg_a.version);
+                        perf_counters.flag_writes_elided++;
+                    }
+                    dead |= mask;
+                }
+            }
+        }
+
+        if (!ir_reg_is_invalid(uop->src_reg_a) && (IREG_GET_REG(uop->src_reg_a.reg) == IREG_flags_op1 || IREG_GET_REG(uop->src_reg_a.reg) == IREG_flags_op2))
+            dead &= (IREG_GET_REG(uop->src_reg_a.reg) == IREG_flags_op1) ? ~DEAD_OP1 : ~DEAD_OP2;
+        if (!ir_reg_is_invalid(uop->src_reg_b) && (IREG_GET_REG(uop->src_reg_b.reg) == IREG_flags_op1 || IREG_GET_REG(uop->src_reg_b.reg) == IREG_flags_op2))
+            dead &= (IREG_GET_REG(uop->src_reg_b.reg) == IREG_flags_op1) ? ~DEAD_OP1 : ~DEAD_OP2;
+        if (!ir_reg_is_invalid(uop->src_reg_c) && (IREG_GET_REG(uop->src_reg_c.reg) == IREG_flags_op1 || IREG_GET_REG(uop->src_reg_c.reg) == IREG_flags_op2))
+            dead &= (IREG_GET_REG(uop->src_reg_c.reg) == IREG_flags_op1) ? ~DEAD_OP1 : ~DEAD_OP2;
+
+        /*Barriers and exits see the flags as they are before the uOP*/
+        if ((uop->type & (UOP_TYPE_BARRIER | UOP_TYPE_ORDER_BARRIER)) && !ir_flags_zn[c])
+            dead = 0;
+
+        ir_flags_dead[c] = dead;
+    }
+}
+
 void
 codegen_ir_compile(ir_data_t *ir, codeblock_t *block)
 {
@@ -82,6 +200,7 @@ codegen_ir_compile(ir_data_t *ir, codeblock_t *block)
     }
 
     codegen_reg_mark_as_required();
+    codegen_ir_flags_liveness(ir);
     codegen_reg_process_dead_list(ir);
     block_write_data = codeblock_allocator_get_ptr(block->head_mem_block);
     block_pos        = 0;
@@ -0,0 +1,270 @@
+#include <stddef.h>
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <wchar.h>
+#include <86box/86box.h>
+#include "cpu.h"
+#include <86box/mem.h>
+#include <86box/path.h>
+#include <86box/perf.h>
+#include <86box/plat.h>
+
+#include "codegen.h"
+#include "codegen_public.h"
+
+/*Persistent translation cache.
+
+  Generated code can not be kept across runs, as it embeds host addresses
+  (helper functions, emulator state, the code allocator itself) that change
+  every time the emulator is started. What is kept instead is the profile of
+  every block that got compiled: where it starts, how long it is, the CPU
+  status it was compiled for, the code flags it ended up with (byte masks,
+  no immediates) and a hash of its guest code.
+
+  When the dispatcher then comes across a block it has no code for, and the
+  profile has an entry with matching guest code, the block is compiled on the
+  spot instead of being interpreted and marked first, and starts out with the
+  code flags it had been promoted to last time round. Entries are only ever
+  used as hints; the generated code is the same as it would have been
+  otherwise.
+
+  The file is tied to the CPU model, as that selects the timing model used by
+  the code generator.*/
+#define TCACHE_MAGIC   "86BoxTC"
+#define TCACHE_VERSION 1
+#define TCACHE_FN      "dynarec.tcache"
+
+#define TCACHE_SIZE    0x10000
+#define TCACHE_MASK    (TCACHE_SIZE - 1)
+#define TCACHE_PROBES  16
+
+#define TCACHE_FLAGS   (CODEBLOCK_BYTE_MASK | CODEBLOCK_NO_IMMEDIATES)
+
+typedef struct tcache_header_t {
+    char     magic[8];
+    uint32_t version;
+    char     cpu_family[64];
+    int32_t  cpu;
+    int32_t  fpu_type;
+    int32_t  fpu_softfloat;
+    uint32_t count;
+} tcache_header_t;
+
+typedef struct tcache_entry_t {
+    uint32_t start_pc;
+    uint32_t _cs;
+    uint32_t phys;
+    uint32_t hash;
+    uint16_t status;
+    uint16_t flags;
+    uint16_t len;
+    uint16_t valid;
+} tcache_entry_t;
+
+static tcache_entry_t *tcache;
+static tcache_header_t tcache_cpu;
+static int             tcache_count;
+static int             tcache_dirty;
+
+static void
+tcache_fill_header(tcache_header_t *hdr)
+{
+    memset(hdr, 0x00, sizeof(tcache_header_t));
+
+    memcpy(hdr->magic, TCACHE_MAGIC, sizeof(TCACHE_MAGIC));
+    hdr->version = TCACHE_VERSION;
+    strncpy(hdr->cpu_family, cpu_f->internal_name, sizeof(hdr->cpu_family) - 1);
+    hdr->cpu           = cpu;
+    hdr->fpu_type      = fpu_type;
+    hdr->fpu_softfloat = fpu_softfloat;
+}
+
+static inline uint32_t
+tcache_slot(uint32_t phys, uint32_t start_pc, uint32_t _cs)
+{
+    uint32_t h = phys * 0x9e3779b1 ^ start_pc * 0x85ebca6b ^ _cs;
+
+    return (h ^ (h >> 16)) & TCACHE_MASK;
+}
+
+/*FNV-1a over the guest code of the block. Blocks that cross a page are never
+  recorded, so this never leaves the page at phys.*/
+static uint32_t
+tcache_hash(uint32_t phys, int len)
+{
+    uint32_t h = 0x811c9dc5;
+
+    for (int c = 0; c < len; c++) {
+        h ^= mem_readb_phys(phys + c);
+        h *= 0x01000193;
+    }
+
+    return h;
+}
+
+static tcache_entry_t *
+tcache_find(uint32_t phys, uint32_t start_pc, uint32_t _cs, uint16_t status, int insert)
+{
+    uint32_t slot = tcache_slot(phys, start_pc, _cs);
+
+    for (int c = 0; c < TCACHE_PROBES; c++) {
+        tcache_entry_t *entry = &tcache[(slot + c) & TCACHE_MASK];
+
+        if (!entry->valid)
+            return insert ? entry : NULL;
+        if ((entry->phys == phys) && (entry->start_pc == start_pc) && (entry->_cs == _cs) && (entry->status == status))
+            return entry;
+    }
+
+    return NULL;
+}
+
+static void
+tcache_clear(void)
+{
+    memset(tcache, 0x00, TCACHE_SIZE * sizeof(tcache_entry_t));
+    tcache_count = 0;
+    tcache_dirty = 0;
+    tcache_fill_header(&tcache_cpu);
+}
+
+void
+codegen_tcache_init(void)
+{
+    tcache_header_t hdr;
+    tcache_header_t cur;
+    tcache_entry_t  entry;
+    char            path[1024];
+    FILE           *fp;
+
+    if (!cpu_dynarec_tcache)
+        return;
+
+    if (tcache == NULL)
+        tcache = malloc(TCACHE_SIZE * sizeof(tcache_entry_t));
+    tcache_clear();
+
+    path_append_filename(path, usr_path, TCACHE_FN);
+    fp = plat_fopen(path, "rb");
+    if (fp == NULL)
+        return;
+
+    tcache_fill_header(&cur);
+    if ((fread(&hdr, 1, sizeof(hdr), fp) != sizeof(hdr)) || memcmp(&hdr, &cur, offsetof(tcache_header_t, count))) {
+        /*Different CPU or format, start over*/
+        fclose(fp);
+        return;
+    }
+
+    for (uint32_t c = 0; c < hdr.count; c++) {
+        tcache_entry_t *slot;
+
+        if (fread(&entry, 1, sizeof(entry), fp) != sizeof(entry))
+            break;
+        slot = tcache_find(entry.phys, entry.start_pc, entry._cs, entry.status, 1);
+        if (slot && !slot->valid) {
+            *slot = entry;
+            tcache_count++;
+        }
+    }
+
+    fclose(fp);
+}
+
+void
+codegen_tcache_reset(void)
+{
+    tcache_header_t cur;
+
+    if (tcache == NULL)
+        return;
+
+    /*The CPU may have been changed along with a hard reset*/
+    tcache_fill_header(&cur);
+    if (memcmp(&cur, &tcache_cpu, offsetof(tcache_header_t, count)))
+        tcache_clear();
+}
+
+void
+codegen_tcache_save(void)
+{
+    tcache_header_t hdr;
+    char            path[1024];
+    FILE           *fp;
+
+    if ((tcache == NULL) || !tcache_dirty)
+        return;
+
+    path_append_filename(path, usr_path, TCACHE_FN);
+    fp = plat_fopen(path, "wb");
+    if (fp == NULL)
+        return;
+
+    hdr       = tcache_cpu;
+    hdr.count = tcache_count;
+    fwrite(&hdr, 1, sizeof(hdr), fp);
+    for (int c = 0; c < TCACHE_SIZE; c++) {
+        if (tcache[c].valid)
+            fwrite(&tcache[c], 1, sizeof(tcache_entry_t), fp);
+    }
+
+    fclose(fp);
+    tcache_dirty = 0;
+}
+
+void
+codegen_tcache_record(codeblock_t *block)
+{
+    tcache_entry_t *entry;
+    uint32_t        len = codegen_endpc - block->pc;
+
+    if (!cpu_dynarec_tcache || (tcache == NULL) || block->page_mask2 || !len || ((block->phys & 0xfff) + len) > 0x1000)
+        return;
+
+    entry = tcache_find(block->phys, block->pc, block->_cs, block->status, 1);
+    if (entry == NULL)
+        return;
+
+    if (!entry->valid)
+        tcache_count++;
+    else if ((entry->len == len) && (entry->flags == (block->flags & TCACHE_FLAGS)))
+        return;
+
+    entry->phys     = block->phys;
+    entry->start_pc = block->pc;
+    entry->_cs      = block->_cs;
+    entry->status   = block->status;
+    entry->flags    = block->flags & TCACHE_FLAGS;
+    entry->len      = len;
+    entry->hash     = tcache_hash(block->phys, len);
+    entry->valid    = 1;
+    tcache_dirty    = 1;
+}
+
+codeblock_t *
+codegen_tcache_prewarm(uint32_t phys_addr)
+{
+    const tcache_entry_t *entry;
+    codeblock_t          *block;
+
+    if (!cpu_dynarec_tcache || (tcache == NULL) || !tcache_count)
+        return NULL;
+
+    entry = tcache_find(phys_addr, cs + cpu_state.pc, cs, (uint16_t) cpu_cur_status, 0);
+    if ((entry == NULL) || (tcache_hash(phys_addr, entry->len) != entry->hash))
+        return NULL;
+
+    /*Do what the mark pass would have done, with the length it found
+      last time.*/
+    codegen_block_init(phys_addr);
+    block         = &codeblock[block_current];
+    codegen_endpc = block->pc + entry->len;
+    codegen_block_end();
+    block->flags |= entry->flags;
+
+    perf_counters.blocks_prewarmed++;
+
+    return block;
+}
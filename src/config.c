@@ -63,6 +63,7 @@
 #include <86box/scsi.h>
 #include <86box/scsi_device.h>
 #include <86box/cdrom.h>
+#include <86box/cdrom_image.h>
 #include <86box/cdrom_interface.h>
 #include <86box/zip.h>
 #include <86box/mo.h>
@@ -390,6 +391,20 @@ load_machine(void)
         mem_size = machine_get_max_ram(machine);
 
     cpu_use_dynarec = !!ini_section_get_int(cat, "cpu_use_dynarec", 0);
+    cpu_dynarec_cache_size = ini_section_get_int(cat, "cpu_dynarec_cache_size", 0);
+    if (cpu_dynarec_cache_size < 0)
+        cpu_dynarec_cache_size = 0;
+    cpu_dynarec_tcache = !!ini_section_get_int(cat, "cpu_dynarec_tcache", 0);
+
+    memset(mem_file, 0x00, sizeof(mem_file));
+    p = ini_section_get_string(cat, "mem_file", "");
+    if (p[0] != 0x00) {
+        if (path_abs((char *) p))
+            strncpy(mem_file, p, sizeof(mem_file) - 1);
+        else
+            path_append_filename(mem_file, usr_path, p);
+        path_normalize(mem_file);
+    }
     fpu_softfloat = !!ini_section_get_int(cat, "fpu_softfloat", 0);
     if ((fpu_type != FPU_NONE) && machine_has_flags(machine, MACHINE_SOFTFLOAT_ONLY))
         fpu_softfloat = 1;
@@ -457,6 +472,7 @@ load_video(void)
     xga_standalone_enabled           = !!ini_section_get_int(cat, "xga", 0);
     xga_active                       = xga_standalone_enabled;
     da2_standalone_enabled           = !!ini_section_get_int(cat, "da2", 0);
+    svga_render_thread               = !!ini_section_get_int(cat, "svga_render_thread", 0);
     show_second_monitors             = !!ini_section_get_int(cat, "show_second_monitors", 1);
     video_fullscreen_scale_maximized = !!ini_section_get_int(cat, "video_fullscreen_scale_maximized", 0);
 
@@ -1007,6 +1023,19 @@ load_hard_disks(void)
     uint32_t      board = 0;
     uint32_t      dev = 0;
 
+    hdd_image_cache_size = ini_section_get_int(cat, "host_cache_size", 0);
+    if (hdd_image_cache_size < 0)
+        hdd_image_cache_size = 0;
+    p = ini_section_get_string(cat, "host_cache_mode", "writethrough");
+    hdd_image_cache_write_back = !strcmp(p, "writeback");
+    p = ini_section_get_string(cat, "overlay", "none");
+    if (!strcmp(p, "keep"))
+        hdd_image_overlay = HDD_OVERLAY_KEEP;
+    else if (!strcmp(p, "discard"))
+        hdd_image_overlay = HDD_OVERLAY_DISCARD;
+    else
+        hdd_image_overlay = HDD_OVERLAY_NONE;
+
     memset(temp, '\0', sizeof(temp));
     for (uint8_t c = 0; c < HDD_NUM; c++) {
         sprintf(temp, "hdd_%02i_parameters", c + 1);
@@ -1286,6 +1315,8 @@ load_floppy_and_cdrom_drives(void)
         }
     }
 
+    cdrom_image_mmap = !!ini_section_get_int(cat, "cdrom_image_mmap", 0);
+
     memset(temp, 0x00, sizeof(temp));
     for (c = 0; c < CDROM_NUM; c++) {
         sprintf(temp, "cdrom_%02i_host_drive", c + 1);
@@ -2144,6 +2175,21 @@ save_machine(void)
 
     ini_section_set_int(cat, "cpu_use_dynarec", cpu_use_dynarec);
 
+    if (cpu_dynarec_cache_size == 0)
+        ini_section_delete_var(cat, "cpu_dynarec_cache_size");
+    else
+        ini_section_set_int(cat, "cpu_dynarec_cache_size", cpu_dynarec_cache_size);
+
+    if (cpu_dynarec_tcache == 0)
+        ini_section_delete_var(cat, "cpu_dynarec_tcache");
+    else
+        ini_section_set_int(cat, "cpu_dynarec_tcache", cpu_dynarec_tcache);
+
+    if (mem_file[0] == 0x00)
+        ini_section_delete_var(cat, "mem_file");
+    else
+        ini_section_set_string(cat, "mem_file", mem_file);
+
     if (fpu_softfloat == 0)
         ini_section_delete_var(cat, "fpu_softfloat");
     else
@@ -2194,6 +2240,11 @@ save_video(void)
     else
         ini_section_set_int(cat, "da2", da2_standalone_enabled);
 
+    if (svga_render_thread == 0)
+        ini_section_delete_var(cat, "svga_render_thread");
+    else
+        ini_section_set_int(cat, "svga_render_thread", svga_render_thread);
+
     // TODO
     for (uint8_t i = 1; i < GFXCARD_MAX; i ++) {
         if (gfxcard[i] == 0)
@@ -2801,6 +2852,23 @@ save_hard_disks(void)
             ini_section_set_string(cat, temp, hdd_preset_get_internal_name(hdd[c].speed_preset));
     }
 
+    if (hdd_image_cache_size == 0)
+        ini_section_delete_var(cat, "host_cache_size");
+    else
+        ini_section_set_int(cat, "host_cache_size", hdd_image_cache_size);
+
+    if (!hdd_image_cache_write_back)
+        ini_section_delete_var(cat, "host_cache_mode");
+    else
+        ini_section_set_string(cat, "host_cache_mode", "writeback");
+
+    if (hdd_image_overlay == HDD_OVERLAY_KEEP)
+        ini_section_set_string(cat, "overlay", "keep");
+    else if (hdd_image_overlay == HDD_OVERLAY_DISCARD)
+        ini_section_set_string(cat, "overlay", "discard");
+    else
+        ini_section_delete_var(cat, "overlay");
+
     ini_delete_section_if_empty(config, cat);
 }
 
@@ -2869,6 +2937,11 @@ save_floppy_and_cdrom_drives(void)
         }
     }
 
+    if (cdrom_image_mmap)
+        ini_section_set_int(cat, "cdrom_image_mmap", cdrom_image_mmap);
+    else
+        ini_section_delete_var(cat, "cdrom_image_mmap");
+
     for (c = 0; c < CDROM_NUM; c++) {
         sprintf(temp, "cdrom_%02i_host_drive", c + 1);
         ini_section_delete_var(cat, temp);
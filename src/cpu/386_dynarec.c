@@ -32,6 +32,7 @@
 #include <86box/plat_fallthrough.h>
 #include <86box/plat_unused.h>
 #include <86box/gdbstub.h>
+#include <86box/perf.h>
 #ifdef USE_DYNAREC
 #    include "codegen.h"
 #    ifdef USE_NEW_DYNAREC
@@ -379,13 +380,28 @@ static __inline void
 #endif
 exec386_dynarec_dyn(void)
 {
-    uint32_t start_pc  = 0;
-    uint32_t phys_addr = get_phys(cs + cpu_state.pc);
-    int      hash      = HASH(phys_addr);
+    uint32_t start_pc = 0;
+    uint32_t phys_addr;
+    int      hash;
 #    ifdef USE_NEW_DYNAREC
-    codeblock_t *block = &codeblock[codeblock_hash[hash]];
+    /* If the previous block has been seen going here before, skip the
+       lookup, it has been validated then. */
+    codeblock_t *block  = codegen_block_link_find();
+    int          linked = (block != NULL);
+
+    if (linked)
+        phys_addr = block->phys;
+    else {
+        phys_addr = get_phys(cs + cpu_state.pc);
+        block     = &codeblock[codeblock_hash[HASH(phys_addr)]];
+    }
+    hash = HASH(phys_addr);
 #    else
-    codeblock_t *block = codeblock_hash[hash];
+    codeblock_t *block;
+
+    phys_addr = get_phys(cs + cpu_state.pc);
+    hash      = HASH(phys_addr);
+    block     = codeblock_hash[hash];
 #    endif
     int valid_block = 0;
 
@@ -400,7 +416,12 @@ exec386_dynarec_dyn(void)
         /* Block must match current CS, PC, code segment size,
            and physical address. The physical address check will
            also catch any page faults at this stage */
-        valid_block = (block->pc == cs + cpu_state.pc) && (block->_cs == cs) && (block->phys == phys_addr) && !((block->status ^ cpu_cur_status) & CPU_STATUS_FLAGS) && ((block->status & cpu_cur_status & CPU_STATUS_MASK) == (cpu_cur_status & CPU_STATUS_MASK));
+#    ifdef USE_NEW_DYNAREC
+        if (linked)
+            valid_block = 1;
+        else
+#    endif
+            valid_block = (block->pc == cs + cpu_state.pc) && (block->_cs == cs) && (block->phys == phys_addr) && !((block->status ^ cpu_cur_status) & CPU_STATUS_FLAGS) && ((block->status & cpu_cur_status & CPU_STATUS_MASK) == (cpu_cur_status & CPU_STATUS_MASK));
         if (!valid_block) {
             uint64_t mask = (uint64_t) 1 << ((phys_addr >> PAGE_MASK_SHIFT) & PAGE_MASK_MASK);
 #    ifdef USE_NEW_DYNAREC
@@ -495,6 +516,15 @@ exec386_dynarec_dyn(void)
             block->was_recompiled = 0;
 #    endif
         }
+
+#    ifdef USE_NEW_DYNAREC
+        /* Go straight to compiling blocks the translation cache knows. */
+        if (!valid_block) {
+            block = codegen_tcache_prewarm(phys_addr);
+            if (block)
+                valid_block = 1;
+        }
+#    endif
     }
 
 #    ifdef USE_NEW_DYNAREC
@@ -505,7 +535,15 @@ exec386_dynarec_dyn(void)
     {
         void (*code)(void) = (void *) &block->data[BLOCK_START];
 
-#    ifndef USE_NEW_DYNAREC
+#    ifdef USE_NEW_DYNAREC
+        codegen_block_touch(block);
+        if (linked)
+            perf_counters.blocks_chained++;
+        else {
+            perf_counters.blocks_dispatched++;
+            codegen_block_link_add(block);
+        }
+#    else
         codeblock_hash[hash] = block;
 #    endif
         inrecomp = 1;
@@ -515,7 +553,10 @@ exec386_dynarec_dyn(void)
 #    endif
         inrecomp = 0;
 
-#    ifndef USE_NEW_DYNAREC
+#    ifdef USE_NEW_DYNAREC
+        /* Do not link across an exception. */
+        codegen_block_link_set_prev(cpu_state.abrt ? NULL : block);
+#    else
         if (!use32)
             cpu_state.pc &= 0xffff;
 #    endif
@@ -529,6 +570,9 @@ exec386_dynarec_dyn(void)
 
         cpu_block_end = 0;
         x86_was_reset = 0;
+#    ifdef USE_NEW_DYNAREC
+        codegen_block_link_set_prev(NULL);
+#    endif
 
 #    if defined(__APPLE__) && defined(__aarch64__)
         if (__builtin_available(macOS 11.0, *)) {
@@ -637,6 +681,9 @@ exec386_dynarec_dyn(void)
 
         cpu_block_end = 0;
         x86_was_reset = 0;
+#    ifdef USE_NEW_DYNAREC
+        codegen_block_link_set_prev(NULL);
+#    endif
 
         codegen_block_init(phys_addr);
 
@@ -42,6 +42,7 @@
 #include <86box/pci.h>
 #include <86box/smram.h>
 #include <86box/timer.h>
+#include <86box/snapshot.h>
 #include <86box/gdbstub.h>
 #include <86box/plat_fallthrough.h>
 #include <86box/plat_unused.h>
@@ -4505,3 +4506,102 @@ cpu_update_waitstates(void)
     if (cpu_s->rspeed <= 8000000)
         cpu_rom_prefetch_cycles = cpu_mem_prefetch_cycles;
 }
+
+void
+cpu_save_state(snapshot_t *s)
+{
+    snapshot_write_var(s, tsc);
+    snapshot_write_var(s, cpu_state);
+    snapshot_write_var(s, fpu_state);
+    snapshot_write_var(s, cpu_cur_status);
+    snapshot_write_var(s, use32);
+    snapshot_write_var(s, stack32);
+    snapshot_write_var(s, cr2);
+    snapshot_write_var(s, cr3);
+    snapshot_write_var(s, cr4);
+    snapshot_write_var(s, dr);
+    snapshot_write_var(s, gdt);
+    snapshot_write_var(s, ldt);
+    snapshot_write_var(s, idt);
+    snapshot_write_var(s, tr);
+    snapshot_write_var(s, msr);
+    snapshot_write_var(s, cs_msr);
+    snapshot_write_var(s, esp_msr);
+    snapshot_write_var(s, eip_msr);
+    snapshot_write_var(s, smi_latched);
+    snapshot_write_var(s, smm_in_hlt);
+    snapshot_write_var(s, smi_block);
+    snapshot_write_var(s, nmi);
+    snapshot_write_var(s, nmi_mask);
+    snapshot_write_var(s, cpu_old_paging);
+    snapshot_write_var(s, cyrix);
+    snapshot_write_var(s, cyrix_addr);
+    snapshot_write_var(s, ccr0);
+    snapshot_write_var(s, ccr1);
+    snapshot_write_var(s, ccr2);
+    snapshot_write_var(s, ccr3);
+    snapshot_write_var(s, ccr4);
+    snapshot_write_var(s, ccr5);
+    snapshot_write_var(s, ccr6);
+    snapshot_write_var(s, ccr7);
+    snapshot_write_var(s, reg_30);
+    snapshot_write_var(s, arr);
+    snapshot_write_var(s, rcr);
+}
+
+void
+cpu_load_state(snapshot_t *s)
+{
+    uint64_t new_tsc = 0ULL;
+
+    snapshot_read_var(s, new_tsc);
+    if (snapshot_error(s))
+        return;
+
+    /* Move every running timer along with the TSC, the ones that belong to
+       saved devices get their own timestamps back afterwards. */
+    timer_set_new_tsc(new_tsc);
+
+    snapshot_read_var(s, cpu_state);
+    snapshot_read_var(s, fpu_state);
+    snapshot_read_var(s, cpu_cur_status);
+    snapshot_read_var(s, use32);
+    snapshot_read_var(s, stack32);
+    snapshot_read_var(s, cr2);
+    snapshot_read_var(s, cr3);
+    snapshot_read_var(s, cr4);
+    snapshot_read_var(s, dr);
+    snapshot_read_var(s, gdt);
+    snapshot_read_var(s, ldt);
+    snapshot_read_var(s, idt);
+    snapshot_read_var(s, tr);
+    snapshot_read_var(s, msr);
+    snapshot_read_var(s, cs_msr);
+    snapshot_read_var(s, esp_msr);
+    snapshot_read_var(s, eip_msr);
+    snapshot_read_var(s, smi_latched);
+    snapshot_read_var(s, smm_in_hlt);
+    snapshot_read_var(s, smi_block);
+    snapshot_read_var(s, nmi);
+    snapshot_read_var(s, nmi_mask);
+    snapshot_read_var(s, cpu_old_paging);
+    snapshot_read_var(s, cyrix);
+    snapshot_read_var(s, cyrix_addr);
+    snapshot_read_var(s, ccr0);
+    snapshot_read_var(s, ccr1);
+    snapshot_read_var(s, ccr2);
+    snapshot_read_var(s, ccr3);
+    snapshot_read_var(s, ccr4);
+    snapshot_read_var(s, ccr5);
+    snapshot_read_var(s, ccr6);
+    snapshot_read_var(s, ccr7);
+    snapshot_read_var(s, reg_30);
+    snapshot_read_var(s, arr);
+    snapshot_read_var(s, rcr);
+
+    /* Host pointer, only meaningful within an instruction. */
+    cpu_state.ea_seg = &cpu_state.seg_ds;
+
+    cpu_flush_pending = 0;
+    flushmmucache();
+}
@@ -55,6 +55,8 @@
 #include <86box/mem.h>
 #include <86box/plat.h>
 #include <86box/rom.h>
+#include <86box/timer.h>
+#include <86box/snapshot.h>
 #include <86box/sound.h>
 #include <86box/ui.h>
 
@@ -734,6 +736,83 @@ device_force_redraw(void)
     }
 }
 
+/* Devices without an init function have no state of their own; everything
+   else is saved, including devices keeping their state in globals. */
+static int
+device_has_state(uint16_t c)
+{
+    return (devices[c] != NULL) && (devices[c]->init != NULL);
+}
+
+/* Returns the first device that has state but no save state hooks. */
+const device_t *
+device_find_unsaveable(void)
+{
+    for (uint16_t c = 0; c < DEVICE_MAX; c++) {
+        if (device_has_state(c)) {
+            if ((devices[c]->save_state == NULL) || (devices[c]->load_state == NULL))
+                return devices[c];
+        }
+    }
+
+    return NULL;
+}
+
+static const char *
+device_state_name(const device_t *dev)
+{
+    return (dev->internal_name != NULL) ? dev->internal_name : "";
+}
+
+void
+device_save_state_all(snapshot_t *s)
+{
+    for (uint16_t c = 0; c < DEVICE_MAX; c++) {
+        if (device_has_state(c)) {
+            device_log("DEVICE: saving state of device '%s'\n", devices[c]->name);
+
+            snapshot_begin_section(s, SNAPSHOT_TAG('D', 'E', 'V', ' '), c);
+            snapshot_write(s, device_state_name(devices[c]), strlen(device_state_name(devices[c])) + 1);
+            devices[c]->save_state(device_priv[c], s);
+            snapshot_end_section(s);
+        }
+    }
+}
+
+void
+device_load_state_all(snapshot_t *s)
+{
+    char        name[256];
+    const char *iname;
+
+    for (uint16_t c = 0; c < DEVICE_MAX; c++) {
+        if (device_has_state(c)) {
+            iname = device_state_name(devices[c]);
+            if (strlen(iname) >= sizeof(name)) {
+                snapshot_set_error(s);
+                return;
+            }
+
+            device_log("DEVICE: loading state of device '%s'\n", devices[c]->name);
+
+            if (!snapshot_enter_section(s, SNAPSHOT_TAG('D', 'E', 'V', ' '), c))
+                return;
+
+            /* The device list must match the one the state was saved with. */
+            memset(name, 0x00, sizeof(name));
+            snapshot_read(s, name, strlen(iname) + 1);
+            if (strcmp(name, iname)) {
+                device_log("DEVICE: state is for device '%s', not '%s'\n", name, iname);
+                snapshot_set_error(s);
+                return;
+            }
+
+            devices[c]->load_state(device_priv[c], s);
+            snapshot_leave_section(s);
+        }
+    }
+}
+
 int
 device_get_instance(void)
 {
@@ -27,6 +27,7 @@
 #define HAVE_STDARG_H
 #include <86box/86box.h>
 #include <86box/io.h>
+#include <86box/perf.h>
 #include <86box/plat.h>
 #include <86box/unittester.h>
 #include <86box/video.h>
@@ -286,7 +287,15 @@ unittester_write(uint16_t port, uint8_t val, UNUSED(void *priv))
                     unittester_log("[UT] Exit received - code = %02X\n", unittester.exit_code);
 
                     /* CHECK: Do we actually exit? */
-                    if (unittester_exit_enabled) {
+                    if (perf_bench_enabled) {
+                        /* In benchmark mode, end the run once this slice
+                           is done, so that the report gets written. */
+                        if (unittester.exit_code > 0x7F)
+                            unittester.exit_code = 0x7F;
+
+                        unittester_log("[UT] Benchmark mode, ending the run with code %02X\n", unittester.exit_code);
+                        perf_bench_stop(unittester.exit_code);
+                    } else if (unittester_exit_enabled) {
                         /* Yes - call exit! */
                         /* Clamp exit code */
                         if (unittester.exit_code > 0x7F)
@@ -1785,6 +1785,17 @@ ide_writeb(uint16_t addr, uint8_t val, void *priv)
 
                     if (ide->type == IDE_HDD) {
                         ui_sb_update_icon(SB_HDD | hdd[ide->hdd_num].bus_type, 1);
+                        /* Fetch the sectors on the host while the seek and transfer
+                           time runs down, the callback then only has to collect them.
+                           Only for a read the callback will carry out: not before
+                           SPECIFY and not past the end of the image. */
+                        if (ide->tf->lba || ide->cfg_spt) {
+                            uint32_t read_count = ide->tf->secount ? ide->tf->secount : 256;
+                            off64_t  read_start = ide_get_sector(ide);
+
+                            if ((read_start + read_count - 1) <= (off64_t) hdd_image_get_last_sector(ide->hdd_num))
+                                hdd_image_read_start(ide->hdd_num, (uint32_t) read_start, read_count);
+                        }
                         uint32_t sec_count;
                         double   wait_time;
                         if ((val == WIN_READ_DMA) || (val == WIN_READ_DMA_ALT)) {
@@ -2349,10 +2360,15 @@ ide_callback(void *priv)
                 err = IDNF_ERR;
             else {
                 if (ide->do_initial_read) {
+                    /* The host is still reading, hold the drive busy a little longer. */
+                    if (hdd_image_read_busy(ide->hdd_num)) {
+                        ide_set_callback(ide, IDE_TIME);
+                        return;
+                    }
                     ide->do_initial_read = 0;
                     ide->sector_pos      = 0;
-                    ret = hdd_image_read(ide->hdd_num, ide_get_sector(ide),
-                                         ide->tf->secount ? ide->tf->secount : 256, ide->sector_buffer);
+                    ret = hdd_image_read_finish(ide->hdd_num, ide_get_sector(ide),
+                                                ide->tf->secount ? ide->tf->secount : 256, ide->sector_buffer);
                 } else
                     ret = 0;
 
@@ -2381,6 +2397,10 @@ ide_callback(void *priv)
             } else if (!ide->tf->lba && (ide->cfg_spt == 0)) {
                 ide_log("IDE %i: DMA read aborted (SPECIFY failed)\n", ide->channel);
                 err = IDNF_ERR;
+            } else if (hdd_image_read_busy(ide->hdd_num)) {
+                /* The host is still reading, hold the drive busy a little longer. */
+                ide_set_callback(ide, IDE_TIME);
+                return;
             } else {
                 ide->sector_pos = 0;
                 if (ide->tf->secount)
@@ -2390,7 +2410,7 @@ ide_callback(void *priv)
 
                 ide->tf->pos = 0;
 
-                if (hdd_image_read(ide->hdd_num, ide_get_sector(ide), ide->sector_pos, ide->sector_buffer) < 0) {
+                if (hdd_image_read_finish(ide->hdd_num, ide_get_sector(ide), ide->sector_pos, ide->sector_buffer) < 0) {
                     ide_log("IDE %i: DMA read aborted (image read error)\n", ide->channel);
                     err = UNC_ERR;
                 } else if (!ide_boards[ide->board]->force_ata3 && bm->dma) {
@@ -2434,10 +2454,15 @@ ide_callback(void *priv)
                 err = IDNF_ERR;
             else {
                 if (ide->do_initial_read) {
+                    /* The host is still reading, hold the drive busy a little longer. */
+                    if (hdd_image_read_busy(ide->hdd_num)) {
+                        ide_set_callback(ide, IDE_TIME);
+                        return;
+                    }
                     ide->do_initial_read = 0;
                     ide->sector_pos      = 0;
-                    ret = hdd_image_read(ide->hdd_num, ide_get_sector(ide),
-                                         ide->tf->secount ? ide->tf->secount : 256, ide->sector_buffer);
+                    ret = hdd_image_read_finish(ide->hdd_num, ide_get_sector(ide),
+                                                ide->tf->secount ? ide->tf->secount : 256, ide->sector_buffer);
                 } else {
                     ret = 0;
                 }
@@ -26,6 +26,7 @@
 #include <time.h>
 #include <wchar.h>
 #include <errno.h>
+#include <stdatomic.h>
 #ifdef __unix__
 #include <unistd.h>
 #endif
@@ -34,7 +35,9 @@
 #include <86box/path.h>
 #include <86box/plat.h>
 #include <86box/random.h>
+#include <86box/thread.h>
 #include <86box/hdd.h>
+#include <86box/perf.h>
 #include "minivhd/minivhd.h"
 #include "minivhd/internal.h"
 
@@ -43,9 +46,75 @@
 #define HDD_IMAGE_HDX 2
 #define HDD_IMAGE_VHD 3
 
+/* Reads started ahead of time by the controllers are done by a worker
+   thread per image, so a slow host read holds up the emulated controller
+   rather than the CPU thread. Only one read is in flight per image, and
+   every other access to the image waits for it first, which keeps them
+   in order. */
+enum {
+    ASYNC_IDLE = 0,
+    ASYNC_PENDING,
+    ASYNC_DONE
+};
+
+typedef struct hdd_image_async_t {
+    thread_t  *thread;
+    event_t   *wake;
+    event_t   *done;
+    atomic_int state;
+    int        run;
+    uint8_t    id;
+
+    uint32_t sector;
+    uint32_t count;
+    uint32_t buffer_size;
+    uint8_t *buffer;
+    int      ret;
+    int      stalled;
+} hdd_image_async_t;
+
+/* In overlay mode the image itself is opened read-only, so one base image
+   can be shared by any number of machines, and every sector the guest
+   writes goes to a delta file in the machine's directory instead. The
+   delta holds a header, an allocation table with one entry per 64 kB
+   cluster and then the clusters in the order they were first written,
+   so it only grows with what the guest changes, on any file system. The
+   whole table stays in memory. The header records a hash of the first
+   and last sectors of the base image, so a delta is never applied to
+   another image of the same size. */
+#define OVERLAY_MAGIC         "86BoxOVL"
+#define OVERLAY_VERSION       2
+#define OVERLAY_CLUSTER_SHIFT 7 /* 128 sectors, 64 kB */
+#define OVERLAY_CLUSTER_SECS  (1 << OVERLAY_CLUSTER_SHIFT)
+#define OVERLAY_HASH_SECS     64
+
+typedef struct hdd_overlay_header_t {
+    char     magic[8];
+    uint32_t version;
+    uint32_t sectors;
+    uint32_t clusters;
+    uint32_t reserved;
+    uint64_t base_hash;
+} hdd_overlay_header_t;
+
+typedef struct hdd_overlay_t {
+    FILE     *file;
+    uint32_t *table;      /* 1-based position of each cluster in the delta, 0 if not there */
+    uint32_t  sectors;
+    uint32_t  clusters;
+    uint32_t  allocated;  /* clusters in the delta */
+    uint32_t  table_size; /* in bytes, rounded up to whole sectors */
+    uint64_t  data_offset;
+    char      fn[1024];
+} hdd_overlay_t;
+
 typedef struct hdd_image_t {
-    FILE     *file; /* Used for HDD_IMAGE_RAW, HDD_IMAGE_HDI, and HDD_IMAGE_HDX. */
-    MVHDMeta *vhd;  /* Used for HDD_IMAGE_VHD. */
+    FILE              *file; /* Used for HDD_IMAGE_RAW, HDD_IMAGE_HDI, and HDD_IMAGE_HDX. */
+    MVHDMeta          *vhd;  /* Used for HDD_IMAGE_VHD. */
+    hdd_image_async_t *async;
+    hdd_image_cache_t *cache;
+    uint8_t            cache_tried;
+    hdd_overlay_t     *overlay;
     uint32_t  base;
     uint32_t  pos;
     uint32_t  last_sector;
@@ -55,6 +124,8 @@ typedef struct hdd_image_t {
 
 hdd_image_t hdd_images[HDD_NUM];
 
+int hdd_image_overlay = HDD_OVERLAY_NONE; /* (C) copy-on-write overlay mode */
+
 static char  empty_sector[512];
 static char *empty_sector_1mb;
 
@@ -248,8 +319,8 @@ hdd_image_init(void)
         memset(&hdd_images[i], 0, sizeof(hdd_image_t));
 }
 
-int
-hdd_image_load(int id)
+static int
+hdd_image_load_base(int id)
 {
     uint32_t sector_size = 512;
     uint32_t zero        = 0;
@@ -297,14 +368,15 @@ hdd_image_load(int id)
         memset(hdd[id].fn, 0, sizeof(hdd[id].fn));
         goto fail_raw;
     }
-    hdd_images[id].file = plat_fopen(fn, "rb+");
+    /* An overlaid image is never written to, so it may be shared. */
+    hdd_images[id].file = plat_fopen(fn, (hdd_image_overlay != HDD_OVERLAY_NONE) ? "rb" : "rb+");
     if (hdd_images[id].file == NULL) {
         /* Failed to open existing hard disk image */
         if (errno == ENOENT) {
             /* Failed because it does not exist,
                so try to create new file */
-            if (hdd[id].wp) {
-                hdd_image_log("A write-protected image must exist\n");
+            if (hdd[id].wp || (hdd_image_overlay != HDD_OVERLAY_NONE)) {
+                hdd_image_log("A write-protected or overlaid image must exist\n");
                 memset(hdd[id].fn, 0, sizeof(hdd[id].fn));
                 goto fail_raw;
             }
@@ -464,7 +536,7 @@ fail_raw:
         } else if (is_vhd[1]) {
             fclose(hdd_images[id].file);
             hdd_images[id].file = NULL;
-            hdd_images[id].vhd  = mvhd_open(fn, (bool) 0, &vhd_error);
+            hdd_images[id].vhd  = mvhd_open(fn, (bool) (hdd_image_overlay != HDD_OVERLAY_NONE), &vhd_error);
             if (hdd_images[id].vhd == NULL) {
                 if (vhd_error == MVHD_ERR_FILE)
                     fatal("hdd_image_load(): VHD: Error opening VHD file '%s': %s\n", fn, strerror(mvhd_errno));
@@ -497,7 +569,7 @@ fail_raw:
     if (fseeko64(hdd_images[id].file, 0, SEEK_END) == -1)
         fatal("hdd_image_load(): Error seeking to the end of file\n");
     s = ftello64(hdd_images[id].file);
-    if (s < (full_size + hdd_images[id].base))
+    if ((s < (full_size + hdd_images[id].base)) && (hdd_image_overlay == HDD_OVERLAY_NONE))
         ret = prepare_new_hard_disk(id, full_size);
     else {
         hdd_images[id].last_sector = (uint32_t) (full_size >> 9) - 1;
@@ -508,12 +580,49 @@ fail_raw:
     return ret;
 }
 
+/* Waits for the read in flight, if any, and drops its result. */
+static void
+hdd_image_async_wait(uint8_t id)
+{
+    hdd_image_async_t *async = hdd_images[id].async;
+
+    if (async == NULL)
+        return;
+
+    while (atomic_load(&async->state) == ASYNC_PENDING)
+        thread_wait_event(async->done, -1);
+    atomic_store(&async->state, ASYNC_IDLE);
+}
+
+static void
+hdd_image_async_close(uint8_t id)
+{
+    hdd_image_async_t *async = hdd_images[id].async;
+
+    if (async == NULL)
+        return;
+
+    hdd_image_async_wait(id);
+
+    async->run = 0;
+    thread_set_event(async->wake);
+    thread_wait(async->thread);
+    thread_destroy_event(async->wake);
+    thread_destroy_event(async->done);
+    free(async->buffer);
+    free(async);
+
+    hdd_images[id].async = NULL;
+}
+
 int
 hdd_image_seek(uint8_t id, uint32_t sector)
 {
     off64_t addr = sector;
     addr         = (uint64_t) sector << 9LL;
 
+    hdd_image_async_wait(id);
+
     hdd_images[id].pos = sector;
     if (hdd_images[id].type != HDD_IMAGE_VHD) {
         if (!hdd_images[id].file || (fseeko64(hdd_images[id].file, addr + hdd_images[id].base, SEEK_SET) == -1)) {
@@ -525,8 +634,8 @@ hdd_image_seek(uint8_t id, uint32_t sector)
     return 0;
 }
 
-int
-hdd_image_read(uint8_t id, uint32_t sector, uint32_t count, uint8_t *buffer)
+static int
+hdd_image_base_read(uint8_t id, uint32_t sector, uint32_t count, uint8_t *buffer)
 {
     int    non_transferred_sectors;
     size_t num_read;
@@ -552,6 +661,455 @@ hdd_image_read(uint8_t id, uint32_t sector, uint32_t count, uint8_t *buffer)
     return 0;
 }
 
+static int
+hdd_image_base_write(uint8_t id, uint32_t sector, uint32_t count, uint8_t *buffer)
+{
+    int    non_transferred_sectors;
+    size_t num_write;
+
+    if (hdd_images[id].type == HDD_IMAGE_VHD) {
+        hdd_images[id].vhd->error = 0;
+        non_transferred_sectors   = mvhd_write_sectors(hdd_images[id].vhd, sector, count, buffer);
+        hdd_images[id].pos        = sector + count - non_transferred_sectors - 1;
+        if (hdd_images[id].vhd->error)
+            return -1;
+    } else {
+        if (!hdd_images[id].file || (fseeko64(hdd_images[id].file, ((uint64_t) (sector) << 9LL) + hdd_images[id].base, SEEK_SET) == -1)) {
+            hdd_image_log("Hard disk image %i: Write error during seek\n", id);
+            return -1;
+        }
+
+        num_write          = fwrite(buffer, 512, count, hdd_images[id].file);
+        hdd_images[id].pos = sector + num_write;
+        fflush(hdd_images[id].file);
+        if (num_write < count)
+            return -1;
+    }
+
+    return 0;
+}
+
+/* FNV-1a over the first and last sectors of the base image, which hold
+   the partition table, boot sectors and any backup GPT. */
+static uint64_t
+hdd_image_overlay_base_hash(uint8_t id, uint32_t sectors)
+{
+    uint8_t *buf   = malloc(OVERLAY_HASH_SECS << 9);
+    uint32_t count = MIN(sectors, OVERLAY_HASH_SECS);
+    uint64_t hash  = 0xcbf29ce484222325ULL;
+
+    for (int i = 0; i < 2; i++) {
+        memset(buf, 0x00, OVERLAY_HASH_SECS << 9);
+        (void) hdd_image_base_read(id, i ? (sectors - count) : 0, count, buf);
+        for (uint32_t c = 0; c < (count << 9); c++) {
+            hash ^= buf[c];
+            hash *= 0x100000001b3ULL;
+        }
+    }
+
+    free(buf);
+    return hash;
+}
+
+static void
+hdd_image_overlay_open(uint8_t id)
+{
+    hdd_overlay_t       *overlay;
+    hdd_overlay_header_t header = { 0 };
+    uint8_t              header_sector[512] = { 0 };
+    uint64_t             base_hash;
+    char                 name[32];
+
+    overlay              = calloc(1, sizeof(hdd_overlay_t));
+    overlay->sectors     = hdd_images[id].last_sector + 1;
+    overlay->clusters    = (overlay->sectors + OVERLAY_CLUSTER_SECS - 1) >> OVERLAY_CLUSTER_SHIFT;
+    overlay->table_size  = ((overlay->clusters * sizeof(uint32_t)) + 511) & ~511;
+    overlay->data_offset = 512ULL + overlay->table_size;
+    overlay->table       = calloc(1, overlay->table_size);
+    base_hash            = hdd_image_overlay_base_hash(id, overlay->sectors);
+
+    sprintf(name, "hdd_%02i.ovl", id + 1);
+    path_append_filename(overlay->fn, usr_path, name);
+
+    if (hdd_image_overlay == HDD_OVERLAY_KEEP) {
+        overlay->file = plat_fopen(overlay->fn, "rb+");
+        if ((overlay->file != NULL) &&
+            ((fread(&header, 1, sizeof(header), overlay->file) != sizeof(header)) ||
+             memcmp(header.magic, OVERLAY_MAGIC, sizeof(header.magic)) ||
+             (header.version != OVERLAY_VERSION))) {
+            pclog("Hard disk image %i: '%s' is not a usable overlay, starting a new one\n", id, overlay->fn);
+            fclose(overlay->file);
+            overlay->file = NULL;
+        }
+
+        /* Never apply the guest's changes to a different base image, and
+           never throw them away either; leave it to the user. */
+        if ((overlay->file != NULL) &&
+            ((header.sectors != overlay->sectors) || (header.clusters != overlay->clusters) ||
+             (header.base_hash != base_hash)))
+            fatal("hdd_image_load(): Overlay '%s' was made for a different base image than '%s'\n",
+                  overlay->fn, hdd[id].fn);
+
+        if ((overlay->file != NULL) &&
+            ((fseeko64(overlay->file, 512, SEEK_SET) == -1) ||
+             (fread(overlay->table, 1, overlay->table_size, overlay->file) != overlay->table_size)))
+            fatal("hdd_image_load(): Unable to read overlay file '%s'\n", overlay->fn);
+
+        if (overlay->file != NULL) {
+            /* A cluster written without its table entry (the emulator died
+               in between) is past the highest entry and simply reused. */
+            for (uint32_t c = 0; c < overlay->clusters; c++)
+                overlay->allocated = MAX(overlay->allocated, overlay->table[c]);
+        }
+    }
+
+    if (overlay->file == NULL) {
+        overlay->file = plat_fopen(overlay->fn, "wb+");
+        if (overlay->file == NULL)
+            fatal("hdd_image_load(): Unable to create overlay file '%s'\n", overlay->fn);
+
+        memcpy(header.magic, OVERLAY_MAGIC, sizeof(header.magic));
+        header.version   = OVERLAY_VERSION;
+        header.sectors   = overlay->sectors;
+        header.clusters  = overlay->clusters;
+        header.reserved  = 0;
+        header.base_hash = base_hash;
+        memcpy(header_sector, &header, sizeof(header));
+        if ((fwrite(header_sector, 1, 512, overlay->file) != 512) ||
+            (fwrite(overlay->table, 1, overlay->table_size, overlay->file) != overlay->table_size))
+            fatal("hdd_image_load(): Unable to write overlay file '%s'\n", overlay->fn);
+        fflush(overlay->file);
+    }
+
+    hdd_image_log("Hard disk image %i: Writes go to overlay '%s', %u clusters in use\n",
+                  id, overlay->fn, overlay->allocated);
+
+    hdd_images[id].overlay = overlay;
+}
+
+static void
+hdd_image_overlay_close(uint8_t id)
+{
+    hdd_overlay_t *overlay = hdd_images[id].overlay;
+
+    if (overlay == NULL)
+        return;
+
+    fclose(overlay->file);
+    if (hdd_image_overlay == HDD_OVERLAY_DISCARD)
+        plat_remove(overlay->fn);
+
+    free(overlay->table);
+    free(overlay);
+
+    hdd_images[id].overlay = NULL;
+}
+
+static uint64_t
+hdd_image_overlay_offset(const hdd_overlay_t *overlay, uint32_t sector)
+{
+    uint64_t pos = overlay->table[sector >> OVERLAY_CLUSTER_SHIFT] - 1;
+
+    return overlay->data_offset + (pos << (OVERLAY_CLUSTER_SHIFT + 9)) +
+           ((uint64_t) (sector & (OVERLAY_CLUSTER_SECS - 1)) << 9);
+}
+
+static int
+hdd_image_overlay_read(uint8_t id, uint32_t sector, uint32_t count, uint8_t *buffer)
+{
+    const hdd_overlay_t *overlay = hdd_images[id].overlay;
+    uint32_t             n;
+    uint32_t             end;
+    int                  present;
+
+    while (count > 0) {
+        /* Split the request into runs that are all in the base image, or
+           all in the delta and contiguous in it. */
+        present = (sector < overlay->sectors) && overlay->table[sector >> OVERLAY_CLUSTER_SHIFT];
+        end     = sector;
+        do {
+            end = (end | (OVERLAY_CLUSTER_SECS - 1)) + 1;
+        } while ((end < (sector + count)) && (end < overlay->sectors) &&
+                 (present ? (overlay->table[end >> OVERLAY_CLUSTER_SHIFT] ==
+                             (overlay->table[(end - 1) >> OVERLAY_CLUSTER_SHIFT] + 1))
+                          : !overlay->table[end >> OVERLAY_CLUSTER_SHIFT]));
+        n = MIN(end - sector, count);
+
+        if (present) {
+            if ((fseeko64(overlay->file, hdd_image_overlay_offset(overlay, sector), SEEK_SET) == -1) ||
+                (fread(buffer, 512, n, overlay->file) != n)) {
+                hdd_image_log("Hard disk image %i: Overlay read error\n", id);
+                return -1;
+            }
+        } else if (hdd_image_base_read(id, sector, n, buffer) < 0)
+            return -1;
+
+        sector += n;
+        count -= n;
+        buffer += n << 9;
+    }
+
+    hdd_images[id].pos = sector;
+    return 0;
+}
+
+/* Gives a cluster its place at the end of the delta, filled with its
+   contents from the base image unless the guest overwrites all of it. */
+static int
+hdd_image_overlay_alloc(uint8_t id, uint32_t cluster, int fill)
+{
+    hdd_overlay_t *overlay = hdd_images[id].overlay;
+    uint8_t       *buf     = calloc(OVERLAY_CLUSTER_SECS, 512);
+    uint32_t       first   = cluster << OVERLAY_CLUSTER_SHIFT;
+    uint32_t       count   = MIN(overlay->sectors - first, OVERLAY_CLUSTER_SECS);
+    uint32_t       entry   = overlay->allocated + 1;
+    int            ret     = -1;
+
+    if ((!fill || (hdd_image_base_read(id, first, count, buf) >= 0)) &&
+        (fseeko64(overlay->file, overlay->data_offset + ((uint64_t) overlay->allocated << (OVERLAY_CLUSTER_SHIFT + 9)), SEEK_SET) != -1) &&
+        (fwrite(buf, 512, OVERLAY_CLUSTER_SECS, overlay->file) == OVERLAY_CLUSTER_SECS) &&
+        /* The cluster is in place before the table says so. */
+        (fseeko64(overlay->file, 512ULL + ((uint64_t) cluster * sizeof(uint32_t)), SEEK_SET) != -1) &&
+        (fwrite(&entry, sizeof(uint32_t), 1, overlay->file) == 1)) {
+        overlay->table[cluster] = entry;
+        overlay->allocated++;
+        ret = 0;
+    }
+
+    free(buf);
+    return ret;
+}
+
+static int
+hdd_image_overlay_write(uint8_t id, uint32_t sector, uint32_t count, uint8_t *buffer)
+{
+    hdd_overlay_t *overlay = hdd_images[id].overlay;
+    uint32_t       n;
+
+    if (sector >= overlay->sectors)
+        return -1;
+    if (count > (overlay->sectors - sector))
+        count = overlay->sectors - sector;
+
+    while (count > 0) {
+        n = MIN(OVERLAY_CLUSTER_SECS - (sector & (OVERLAY_CLUSTER_SECS - 1)), count);
+
+        if (!overlay->table[sector >> OVERLAY_CLUSTER_SHIFT] &&
+            (hdd_image_overlay_alloc(id, sector >> OVERLAY_CLUSTER_SHIFT, n != OVERLAY_CLUSTER_SECS) < 0)) {
+            hdd_image_log("Hard disk image %i: Overlay allocation error\n", id);
+            return -1;
+        }
+
+        if ((fseeko64(overlay->file, hdd_image_overlay_offset(overlay, sector), SEEK_SET) == -1) ||
+            (fwrite(buffer, 512, n, overlay->file) != n)) {
+            hdd_image_log("Hard disk image %i: Overlay write error\n", id);
+            return -1;
+        }
+
+        sector += n;
+        count -= n;
+        buffer += n << 9;
+    }
+    fflush(overlay->file);
+
+    hdd_images[id].pos = sector;
+    return 0;
+}
+
+static int
+hdd_image_overlay_zero(uint8_t id, uint32_t sector, uint32_t count)
+{
+    uint8_t *zero = calloc(128, 512);
+    uint32_t n;
+    int      ret = 0;
+
+    while ((count > 0) && (ret == 0)) {
+        n   = MIN(count, 128);
+        ret = hdd_image_overlay_write(id, sector, n, zero);
+        sector += n;
+        count -= n;
+    }
+
+    free(zero);
+    return ret;
+}
+
+static int
+hdd_image_backend_read(uint8_t id, uint32_t sector, uint32_t count, uint8_t *buffer)
+{
+    if (hdd_images[id].overlay != NULL)
+        return hdd_image_overlay_read(id, sector, count, buffer);
+
+    return hdd_image_base_read(id, sector, count, buffer);
+}
+
+static int
+hdd_image_backend_write(uint8_t id, uint32_t sector, uint32_t count, uint8_t *buffer)
+{
+    if (hdd_images[id].overlay != NULL)
+        return hdd_image_overlay_write(id, sector, count, buffer);
+
+    return hdd_image_base_write(id, sector, count, buffer);
+}
+
+/* The host-side block cache is set up on first access, once the image
+   size is known. */
+static hdd_image_cache_t *
+hdd_image_get_cache(uint8_t id)
+{
+    if (!hdd_images[id].cache_tried) {
+        hdd_images[id].cache_tried = 1;
+        hdd_images[id].cache       = hdd_image_cache_init(id, hdd_images[id].last_sector + 1,
+                                                          hdd_image_backend_read, hdd_image_backend_write);
+    }
+
+    return hdd_images[id].cache;
+}
+
+static void
+hdd_image_cache_free(uint8_t id)
+{
+    hdd_image_cache_close(hdd_images[id].cache);
+    hdd_images[id].cache       = NULL;
+    hdd_images[id].cache_tried = 0;
+}
+
+static int
+hdd_image_do_read(uint8_t id, uint32_t sector, uint32_t count, uint8_t *buffer)
+{
+    hdd_image_cache_t *cache = hdd_image_get_cache(id);
+
+    if (cache == NULL)
+        return hdd_image_backend_read(id, sector, count, buffer);
+
+    hdd_images[id].pos = sector + count;
+    return hdd_image_cache_read(cache, sector, count, buffer);
+}
+
+int
+hdd_image_read(uint8_t id, uint32_t sector, uint32_t count, uint8_t *buffer)
+{
+    hdd_image_async_wait(id);
+
+    return hdd_image_do_read(id, sector, count, buffer);
+}
+
+static void
+hdd_image_async_thread(void *priv)
+{
+    hdd_image_async_t *async = (hdd_image_async_t *) priv;
+
+    while (1) {
+        thread_wait_event(async->wake, -1);
+        thread_reset_event(async->wake);
+
+        if (!async->run)
+            break;
+
+        if (atomic_load(&async->state) == ASYNC_PENDING) {
+            async->ret = hdd_image_do_read(async->id, async->sector, async->count, async->buffer);
+            atomic_store(&async->state, ASYNC_DONE);
+            thread_set_event(async->done);
+        }
+    }
+}
+
+/* Starts reading count sectors in the background, for a controller to pick
+   up with hdd_image_read_finish() once its emulated transfer time is up.
+   The read lands in a buffer of our own, so a controller that abandons it
+   (reset, error) is free to reuse its sector buffer straight away. */
+void
+hdd_image_read_start(uint8_t id, uint32_t sector, uint32_t count)
+{
+    hdd_image_async_t *async;
+
+    if (!hdd_images[id].loaded)
+        return;
+
+    hdd_image_async_wait(id);
+
+    async = hdd_images[id].async;
+    if (async == NULL) {
+        async       = calloc(1, sizeof(hdd_image_async_t));
+        async->id   = id;
+        async->run  = 1;
+        async->wake = thread_create_event();
+        async->done = thread_create_event();
+        atomic_init(&async->state, ASYNC_IDLE);
+        async->thread        = thread_create(hdd_image_async_thread, async);
+        hdd_images[id].async = async;
+    }
+
+    if (async->buffer_size < count) {
+        free(async->buffer);
+        async->buffer      = malloc((size_t) count << 9);
+        async->buffer_size = count;
+    }
+
+    async->sector  = sector;
+    async->count   = count;
+    async->stalled = 0;
+    thread_reset_event(async->done);
+    atomic_store(&async->state, ASYNC_PENDING);
+    thread_set_event(async->wake);
+}
+
+/* Returns nonzero while a read started by hdd_image_read_start() is still
+   in flight; the controller should try again later rather than block. */
+int
+hdd_image_read_busy(uint8_t id)
+{
+    hdd_image_async_t *async = hdd_images[id].async;
+
+    if ((async == NULL) || (atomic_load(&async->state) != ASYNC_PENDING))
+        return 0;
+
+    /* Count each late read once, not every time the controller polls it. */
+    if (!async->stalled) {
+        async->stalled = 1;
+        perf_counters.hdd_read_stalls++;
+    }
+    return 1;
+}
+
+/* Completes a read: if one was started in the background covering these
+   sectors, copies them out and returns its result, otherwise reads them now. */
+int
+hdd_image_read_finish(uint8_t id, uint32_t sector, uint32_t count, uint8_t *buffer)
+{
+    hdd_image_async_t *async = hdd_images[id].async;
+
+    if ((async != NULL) && (atomic_load(&async->state) != ASYNC_IDLE) &&
+        (async->sector == sector) && (count <= async->count)) {
+        while (atomic_load(&async->state) == ASYNC_PENDING)
+            thread_wait_event(async->done, -1);
+        atomic_store(&async->state, ASYNC_IDLE);
+        if (async->ret >= 0)
+            memcpy(buffer, async->buffer, (size_t) count << 9);
+        perf_counters.hdd_async_reads++;
+        return async->ret;
+    }
+
+    return hdd_image_read(id, sector, count, buffer);
+}
+
+int
+hdd_image_load(int id)
+{
+    int ret;
+
+    hdd_image_async_close(id);
+    hdd_image_cache_free(id);
+    hdd_image_overlay_close(id);
+
+    ret = hdd_image_load_base(id);
+
+    if (hdd_images[id].loaded && (hdd_image_overlay != HDD_OVERLAY_NONE))
+        hdd_image_overlay_open(id);
+
+    return ret;
+}
+
 uint32_t
 hdd_image_get_last_sector(uint8_t id)
 {
@@ -584,29 +1142,16 @@ hdd_image_read_ex(uint8_t id, uint32_t sector, uint32_t count, uint8_t *buffer)
 int
 hdd_image_write(uint8_t id, uint32_t sector, uint32_t count, uint8_t *buffer)
 {
-    int    non_transferred_sectors;
-    size_t num_write;
+    hdd_image_cache_t *cache;
 
-    if (hdd_images[id].type == HDD_IMAGE_VHD) {
-        hdd_images[id].vhd->error = 0;
-        non_transferred_sectors   = mvhd_write_sectors(hdd_images[id].vhd, sector, count, buffer);
-        hdd_images[id].pos        = sector + count - non_transferred_sectors - 1;
-        if (hdd_images[id].vhd->error)
-            return -1;
-    } else {
-        if (!hdd_images[id].file || (fseeko64(hdd_images[id].file, ((uint64_t) (sector) << 9LL) + hdd_images[id].base, SEEK_SET) == -1)) {
-            hdd_image_log("Hard disk image %i: Write error during seek\n", id);
-            return -1;
-        }
+    hdd_image_async_wait(id);
 
-        num_write          = fwrite(buffer, 512, count, hdd_images[id].file);
-        hdd_images[id].pos = sector + num_write;
-        fflush(hdd_images[id].file);
-        if (num_write < count)
-            return -1;
-    }
+    cache = hdd_image_get_cache(id);
+    if (cache == NULL)
+        return hdd_image_backend_write(id, sector, count, buffer);
 
-    return 0;
+    hdd_images[id].pos = sector + count;
+    return hdd_image_cache_write(cache, sector, count, buffer);
 }
 
 int
@@ -629,6 +1174,14 @@ hdd_image_write_ex(uint8_t id, uint32_t sector, uint32_t count, uint8_t *buffer)
 int
 hdd_image_zero(uint8_t id, uint32_t sector, uint32_t count)
 {
+    hdd_image_async_wait(id);
+
+    if ((hdd_images[id].cache != NULL) && (hdd_image_cache_discard(hdd_images[id].cache, sector, count) < 0))
+        return -1;
+
+    if (hdd_images[id].overlay != NULL)
+        return hdd_image_overlay_zero(id, sector, count);
+
     if (hdd_images[id].type == HDD_IMAGE_VHD) {
         hdd_images[id].vhd->error   = 0;
         int non_transferred_sectors = mvhd_format_sectors(hdd_images[id].vhd, sector, count);
@@ -692,6 +1245,10 @@ hdd_image_unload(uint8_t id, UNUSED(int fn_preserve))
     if (strlen(hdd[id].fn) == 0)
         return;
 
+    hdd_image_async_close(id);
+    hdd_image_cache_free(id);
+    hdd_image_overlay_close(id);
+
     if (hdd_images[id].loaded) {
         if (hdd_images[id].file != NULL) {
             fclose(hdd_images[id].file);
@@ -716,6 +1273,10 @@ hdd_image_close(uint8_t id)
     if (!hdd_images[id].loaded)
         return;
 
+    hdd_image_async_close(id);
+    hdd_image_cache_free(id);
+    hdd_image_overlay_close(id);
+
     if (hdd_images[id].file != NULL) {
         fclose(hdd_images[id].file);
         hdd_images[id].file = NULL;
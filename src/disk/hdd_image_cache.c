@@ -0,0 +1,471 @@
+/*
+ * 86Box    A hypervisor and IBM PC system emulator that specializes in
+ *          running old operating systems and software designed for IBM
+ *          PC systems and compatibles from 1981 through fairly recent
+ *          system designs based on the PCI bus.
+ *
+ *          This file is part of the 86Box distribution.
+ *
+ *          Host-side block cache for hard disk images.
+ *
+ *          Sits between hdd_image and the image backends, so every
+ *          controller goes through it. The image is cached in 64 KB
+ *          blocks with LRU replacement; a miss in a sequential run
+ *          fetches several blocks with a single backend read. Writes
+ *          either go straight through to the image, updating cached
+ *          blocks on the way, or stay in the cache until the block is
+ *          evicted or the image is closed.
+ *
+ *
+ *
+ *          Copyright 2026 The 86Box development team
+ */
+#include <inttypes.h>
+#include <stdarg.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <wchar.h>
+#define HAVE_STDARG_H
+#include <86box/86box.h>
+#include <86box/hdd.h>
+#include <86box/perf.h>
+
+#define CACHE_BLOCK_SHIFT   7 /* 128 sectors */
+#define CACHE_BLOCK_SECTORS (1 << CACHE_BLOCK_SHIFT)
+#define CACHE_BLOCK_SIZE    (CACHE_BLOCK_SECTORS * 512)
+#define CACHE_READ_AHEAD    4 /* blocks fetched at once on a sequential miss */
+#define CACHE_NONE          0xffffffff
+
+typedef struct cache_block_t {
+    uint32_t block; /* block number in the image, CACHE_NONE if free */
+    uint32_t sectors; /* less than a full block at the end of the image */
+    uint32_t hash_next;
+    uint32_t lru_prev;
+    uint32_t lru_next;
+    uint8_t  dirty;
+    uint8_t *data;
+} cache_block_t;
+
+struct hdd_image_cache_t {
+    uint8_t  id;
+    int      write_back;
+    uint32_t image_sectors;
+    uint32_t next_sector; /* where a sequential read would continue */
+
+    uint32_t       num_blocks;
+    uint32_t       hash_mask;
+    uint32_t      *hash;
+    cache_block_t *blocks;
+    uint8_t       *data;
+    uint8_t       *scratch;
+    uint32_t       lru_head; /* most recently used */
+    uint32_t       lru_tail;
+
+    hdd_image_cache_io_t read;
+    hdd_image_cache_io_t write;
+
+    uint64_t hits;
+    uint64_t misses;
+    uint64_t bytes_saved;
+};
+
+int hdd_image_cache_size       = 0; /* (C) host-side cache per image in MB, 0 = off */
+int hdd_image_cache_write_back = 0; /* (C) keep writes in the cache until eviction */
+
+#ifdef ENABLE_HDD_IMAGE_CACHE_LOG
+int hdd_image_cache_do_log = ENABLE_HDD_IMAGE_CACHE_LOG;
+
+static void
+hdd_image_cache_log(const char *fmt, ...)
+{
+    va_list ap;
+
+    if (hdd_image_cache_do_log) {
+        va_start(ap, fmt);
+        pclog_ex(fmt, ap);
+        va_end(ap);
+    }
+}
+#else
+#    define hdd_image_cache_log(fmt, ...)
+#endif
+
+static uint32_t
+cache_find(const hdd_image_cache_t *cache, uint32_t block)
+{
+    uint32_t i = cache->hash[block & cache->hash_mask];
+
+    while ((i != CACHE_NONE) && (cache->blocks[i].block != block))
+        i = cache->blocks[i].hash_next;
+
+    return i;
+}
+
+static void
+cache_lru_unlink(hdd_image_cache_t *cache, uint32_t i)
+{
+    cache_block_t *b = &cache->blocks[i];
+
+    if (b->lru_prev != CACHE_NONE)
+        cache->blocks[b->lru_prev].lru_next = b->lru_next;
+    else
+        cache->lru_head = b->lru_next;
+
+    if (b->lru_next != CACHE_NONE)
+        cache->blocks[b->lru_next].lru_prev = b->lru_prev;
+    else
+        cache->lru_tail = b->lru_prev;
+}
+
+static void
+cache_touch(hdd_image_cache_t *cache, uint32_t i)
+{
+    cache_block_t *b = &cache->blocks[i];
+
+    if (cache->lru_head == i)
+        return;
+
+    cache_lru_unlink(cache, i);
+
+    b->lru_prev = CACHE_NONE;
+    b->lru_next = cache->lru_head;
+    cache->blocks[cache->lru_head].lru_prev = i;
+    cache->lru_head = i;
+}
+
+/* A block stays dirty until it has actually been written, so a failed
+   write is tried again by the next eviction or flush. */
+static int
+cache_write_back(hdd_image_cache_t *cache, uint32_t i)
+{
+    cache_block_t *b = &cache->blocks[i];
+
+    if (!b->dirty)
+        return 0;
+
+    if (cache->write(cache->id, b->block << CACHE_BLOCK_SHIFT, b->sectors, b->data) < 0)
+        return -1;
+
+    b->dirty = 0;
+    return 0;
+}
+
+static void
+cache_unhash(hdd_image_cache_t *cache, uint32_t i)
+{
+    cache_block_t *b = &cache->blocks[i];
+    uint32_t      *p = &cache->hash[b->block & cache->hash_mask];
+
+    while (*p != i)
+        p = &cache->blocks[*p].hash_next;
+    *p = b->hash_next;
+
+    b->block = CACHE_NONE;
+    b->dirty = 0;
+}
+
+/* Frees a block and moves it to the tail, so it is the next one reused. */
+static void
+cache_drop(hdd_image_cache_t *cache, uint32_t i)
+{
+    cache_block_t *b = &cache->blocks[i];
+
+    cache_unhash(cache, i);
+
+    if (cache->lru_tail == i)
+        return;
+
+    cache_lru_unlink(cache, i);
+
+    b->lru_next = CACHE_NONE;
+    b->lru_prev = cache->lru_tail;
+    cache->blocks[cache->lru_tail].lru_next = i;
+    cache->lru_tail = i;
+}
+
+/* Takes the least recently used block and assigns it to the given block
+   number, writing back what it held first. A block that cannot be written
+   back keeps its data and moves to the head, to be tried again later; if
+   none can be freed there is no slot and -1 is returned. */
+static int
+cache_alloc(hdd_image_cache_t *cache, uint32_t block, uint32_t *slot)
+{
+    uint32_t       i     = cache->lru_tail;
+    uint32_t       first = block << CACHE_BLOCK_SHIFT;
+    uint32_t       tries = 0;
+    cache_block_t *b;
+
+    while ((cache->blocks[i].block != CACHE_NONE) && (cache_write_back(cache, i) < 0)) {
+        hdd_image_cache_log("Hard disk image %i: Error writing back block %u\n", cache->id, cache->blocks[i].block);
+        if (++tries == cache->num_blocks) {
+            *slot = CACHE_NONE;
+            return -1;
+        }
+        cache_touch(cache, i);
+        i = cache->lru_tail;
+    }
+
+    b = &cache->blocks[i];
+    if (b->block != CACHE_NONE)
+        cache_unhash(cache, i);
+
+    b->block     = block;
+    b->sectors   = MIN(CACHE_BLOCK_SECTORS, cache->image_sectors - first);
+    b->hash_next = cache->hash[block & cache->hash_mask];
+    cache->hash[block & cache->hash_mask] = i;
+    cache_touch(cache, i);
+
+    *slot = i;
+    return 0;
+}
+
+/* Reads up to count blocks starting at block from the image with a single
+   backend call, stopping at the first one already cached or at the end of
+   the image. */
+static int
+cache_fill(hdd_image_cache_t *cache, uint32_t block, uint32_t count)
+{
+    uint32_t first = block << CACHE_BLOCK_SHIFT;
+    uint32_t sectors;
+    uint32_t n = 1;
+    uint32_t i;
+
+    while ((n < count) && (((block + n) << CACHE_BLOCK_SHIFT) < cache->image_sectors) &&
+           (cache_find(cache, block + n) == CACHE_NONE))
+        n++;
+
+    sectors = MIN(n << CACHE_BLOCK_SHIFT, cache->image_sectors - first);
+    if (cache->read(cache->id, first, sectors, cache->scratch) < 0)
+        return -1;
+
+    if (n > 1)
+        perf_counters.hdd_cache_read_ahead += n - 1;
+
+    /* Fill the furthest block first, so the one asked for ends up the most
+       recently used. */
+    while (n--) {
+        if (cache_alloc(cache, block + n, &i) < 0)
+            return -1;
+        memcpy(cache->blocks[i].data, &cache->scratch[n * CACHE_BLOCK_SIZE], cache->blocks[i].sectors * 512);
+    }
+
+    return 0;
+}
+
+hdd_image_cache_t *
+hdd_image_cache_init(uint8_t id, uint32_t sectors, hdd_image_cache_io_t read, hdd_image_cache_io_t write)
+{
+    hdd_image_cache_t *cache;
+    uint32_t           num_blocks;
+    uint32_t           hash_size = 1;
+
+    if ((hdd_image_cache_size <= 0) || (sectors == 0))
+        return NULL;
+
+    num_blocks = (uint32_t) (((uint64_t) hdd_image_cache_size << 20) / CACHE_BLOCK_SIZE);
+    if (num_blocks < CACHE_READ_AHEAD)
+        num_blocks = CACHE_READ_AHEAD;
+    while (hash_size < num_blocks)
+        hash_size <<= 1;
+
+    cache                = calloc(1, sizeof(hdd_image_cache_t));
+    cache->id            = id;
+    cache->write_back    = hdd_image_cache_write_back;
+    cache->image_sectors = sectors;
+    cache->next_sector   = CACHE_NONE;
+    cache->num_blocks    = num_blocks;
+    cache->hash_mask     = hash_size - 1;
+    cache->hash          = malloc(hash_size * sizeof(uint32_t));
+    cache->blocks        = calloc(num_blocks, sizeof(cache_block_t));
+    cache->data          = malloc((size_t) num_blocks * CACHE_BLOCK_SIZE);
+    cache->scratch       = malloc(CACHE_READ_AHEAD * CACHE_BLOCK_SIZE);
+    cache->read          = read;
+    cache->write         = write;
+
+    if ((cache->hash == NULL) || (cache->blocks == NULL) || (cache->data == NULL) || (cache->scratch == NULL)) {
+        hdd_image_cache_log("Hard disk image %i: Unable to allocate a %i MB cache\n", id, hdd_image_cache_size);
+        free(cache->hash);
+        free(cache->blocks);
+        free(cache->data);
+        free(cache->scratch);
+        free(cache);
+        return NULL;
+    }
+
+    memset(cache->hash, 0xff, hash_size * sizeof(uint32_t));
+    for (uint32_t i = 0; i < num_blocks; i++) {
+        cache->blocks[i].block    = CACHE_NONE;
+        cache->blocks[i].data     = &cache->data[(size_t) i * CACHE_BLOCK_SIZE];
+        cache->blocks[i].lru_prev = i ? (i - 1) : CACHE_NONE;
+        cache->blocks[i].lru_next = (i < (num_blocks - 1)) ? (i + 1) : CACHE_NONE;
+    }
+    cache->lru_head = 0;
+    cache->lru_tail = num_blocks - 1;
+
+    hdd_image_cache_log("Hard disk image %i: %u KB %s cache\n", id, (num_blocks * CACHE_BLOCK_SIZE) >> 10,
+                        cache->write_back ? "write-back" : "write-through");
+
+    return cache;
+}
+
+int
+hdd_image_cache_flush(hdd_image_cache_t *cache)
+{
+    int ret = 0;
+
+    for (uint32_t i = 0; i < cache->num_blocks; i++) {
+        if ((cache->blocks[i].block != CACHE_NONE) && (cache_write_back(cache, i) < 0))
+            ret = -1;
+    }
+
+    return ret;
+}
+
+void
+hdd_image_cache_close(hdd_image_cache_t *cache)
+{
+    if (cache == NULL)
+        return;
+
+    if (hdd_image_cache_flush(cache) < 0)
+        hdd_image_cache_log("Hard disk image %i: Error writing back the cache\n", cache->id);
+
+    hdd_image_cache_log("Hard disk image %i: %" PRIu64 " cache hits, %" PRIu64 " misses, %" PRIu64 " KB not read\n",
+                        cache->id, cache->hits, cache->misses, cache->bytes_saved >> 10);
+
+    free(cache->hash);
+    free(cache->blocks);
+    free(cache->data);
+    free(cache->scratch);
+    free(cache);
+}
+
+int
+hdd_image_cache_read(hdd_image_cache_t *cache, uint32_t sector, uint32_t count, uint8_t *buffer)
+{
+    uint32_t       ra = (sector == cache->next_sector) ? CACHE_READ_AHEAD : 1;
+    uint32_t       block;
+    uint32_t       offset;
+    uint32_t       n;
+    uint32_t       i;
+    cache_block_t *b;
+
+    cache->next_sector = sector + count;
+
+    while (count > 0) {
+        if (sector >= cache->image_sectors) {
+            /* Past the end of the image, read nothing. */
+            memset(buffer, 0x00, count * 512);
+            break;
+        }
+
+        block  = sector >> CACHE_BLOCK_SHIFT;
+        offset = sector & (CACHE_BLOCK_SECTORS - 1);
+        n      = MIN(count, CACHE_BLOCK_SECTORS - offset);
+
+        i = cache_find(cache, block);
+        if (i == CACHE_NONE) {
+            cache->misses++;
+            perf_counters.hdd_cache_misses++;
+            if (cache_fill(cache, block, ra) < 0)
+                return -1;
+            i = cache_find(cache, block);
+        } else {
+            cache->hits++;
+            cache->bytes_saved += n * 512;
+            perf_counters.hdd_cache_hits++;
+            perf_counters.hdd_cache_bytes_saved += n * 512;
+            cache_touch(cache, i);
+        }
+
+        b = &cache->blocks[i];
+        if ((offset + n) > b->sectors) {
+            memcpy(buffer, &b->data[offset * 512], (b->sectors - offset) * 512);
+            memset(&buffer[(b->sectors - offset) * 512], 0x00, (offset + n - b->sectors) * 512);
+        } else
+            memcpy(buffer, &b->data[offset * 512], n * 512);
+
+        sector += n;
+        count -= n;
+        buffer += n * 512;
+    }
+
+    return 0;
+}
+
+int
+hdd_image_cache_write(hdd_image_cache_t *cache, uint32_t sector, uint32_t count, uint8_t *buffer)
+{
+    uint32_t       block;
+    uint32_t       offset;
+    uint32_t       n;
+    uint32_t       i;
+    cache_block_t *b;
+    int            ret = 0;
+
+    if (!cache->write_back && (cache->write(cache->id, sector, count, buffer) < 0))
+        return -1;
+
+    while ((count > 0) && (sector < cache->image_sectors)) {
+        block  = sector >> CACHE_BLOCK_SHIFT;
+        offset = sector & (CACHE_BLOCK_SECTORS - 1);
+        n      = MIN(count, CACHE_BLOCK_SECTORS - offset);
+
+        i = cache_find(cache, block);
+        if ((i == CACHE_NONE) && cache->write_back) {
+            /* Only read the block in if the write does not cover all of it. */
+            if ((offset == 0) && (n >= MIN(CACHE_BLOCK_SECTORS, cache->image_sectors - sector)))
+                cache_alloc(cache, block, &i);
+            else if (cache_fill(cache, block, 1) == 0)
+                i = cache_find(cache, block);
+
+            /* No block to be had, write this part straight through. */
+            if ((i == CACHE_NONE) &&
+                (cache->write(cache->id, sector, MIN(n, cache->image_sectors - sector), buffer) < 0))
+                ret = -1;
+        }
+
+        if (i != CACHE_NONE) {
+            b = &cache->blocks[i];
+            n = MIN(n, b->sectors - offset);
+            memcpy(&b->data[offset * 512], buffer, n * 512);
+            if (cache->write_back) {
+                b->dirty = 1;
+                cache_touch(cache, i);
+            }
+        }
+
+        sector += n;
+        count -= n;
+        buffer += n * 512;
+    }
+
+    return ret;
+}
+
+/* Writes back and forgets every block the given range touches, for
+   operations that change the image behind the cache's back. */
+int
+hdd_image_cache_discard(hdd_image_cache_t *cache, uint32_t sector, uint32_t count)
+{
+    uint32_t first = sector >> CACHE_BLOCK_SHIFT;
+    uint32_t last  = ((uint64_t) sector + count - 1) >> CACHE_BLOCK_SHIFT;
+    int      ret   = 0;
+
+    if (count == 0)
+        return 0;
+
+    for (uint32_t i = 0; i < cache->num_blocks; i++) {
+        if ((cache->blocks[i].block == CACHE_NONE) ||
+            (cache->blocks[i].block < first) || (cache->blocks[i].block > last))
+            continue;
+
+        if (cache_write_back(cache, i) < 0)
+            ret = -1;
+        cache_drop(cache, i);
+    }
+
+    return ret;
+}
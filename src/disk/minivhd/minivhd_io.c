@@ -236,6 +236,92 @@ mvhd_fixed_read(MVHDMeta *vhdm, uint32_t offset, int num_sectors, void *out_buff
     return truncated_sectors;
 }
 
+/**
+ * \brief Find a run of sectors with the same bitmap state
+ *
+ * Whole bytes and 64-bit words are skipped at once where they are aligned.
+ *
+ * \param [in] bitmap The sector bitmap of the block
+ * \param [in] sib The sector in the block the run starts at
+ * \param [in] max_sectors The maximum length of the run
+ * \param [out] present Whether the sectors of the run are present in the block
+ *
+ * \return The number of sectors in the run
+ */
+static int
+bitmap_run(const uint8_t *bitmap, int sib, int max_sectors, bool *present)
+{
+    uint64_t word_fill;
+    uint64_t word;
+    uint8_t  byte_fill;
+    int      n = 1;
+    int      k;
+
+    *present  = VHD_TESTBIT(bitmap, sib) != 0;
+    byte_fill = *present ? 0xff : 0x00;
+    word_fill = *present ? 0xffffffffffffffffULL : 0ULL;
+
+    while (n < max_sectors) {
+        k = sib + n;
+        if (!(k & 63) && ((n + 64) <= max_sectors)) {
+            memcpy(&word, &bitmap[k >> 3], sizeof word);
+            if (word == word_fill) {
+                n += 64;
+                continue;
+            }
+        }
+        if (!(k & 7) && ((n + 8) <= max_sectors) && (bitmap[k >> 3] == byte_fill)) {
+            n += 8;
+            continue;
+        }
+        if ((VHD_TESTBIT(bitmap, k) != 0) != *present)
+            break;
+        n++;
+    }
+
+    return n;
+}
+
+/**
+ * \brief Read a run of present sectors from a block with a single fread
+ *
+ * \param [in] vhdm MiniVHD data structure
+ * \param [in] blk The block to read from
+ * \param [in] sib The first sector in the block to read
+ * \param [in] num_sectors The number of sectors to read
+ * \param [out] buff Where to place the sectors
+ */
+static void
+read_block_run(MVHDMeta *vhdm, int blk, int sib, int num_sectors, uint8_t *buff)
+{
+    int64_t addr = (((int64_t) vhdm->block_offset[blk]) + vhdm->bitmap.sector_count + sib) * MVHD_SECTOR_SIZE;
+
+    if (mvhd_fseeko64(vhdm->f, addr, SEEK_SET) == -1)
+        vhdm->error = 1;
+    if (!fread(buff, (size_t) num_sectors * MVHD_SECTOR_SIZE, 1, vhdm->f) && !feof(vhdm->f))
+        vhdm->error = 1;
+}
+
+/**
+ * \brief Read sectors that are not present in a differencing VHD from its parent
+ *
+ * \param [in] vhdm MiniVHD data structure
+ * \param [in] offset The first sector to read
+ * \param [in] num_sectors The number of sectors to read
+ * \param [out] buff Where to place the sectors
+ */
+static void
+read_parent_run(MVHDMeta *vhdm, uint32_t offset, int num_sectors, uint8_t *buff)
+{
+    MVHDMeta *parent = vhdm->parent;
+
+    parent->read_sectors(parent, offset, num_sectors, buff);
+    if (parent->error) {
+        parent->error = 0;
+        vhdm->error = 1;
+    }
+}
+
 int
 mvhd_sparse_read(MVHDMeta *vhdm, uint32_t offset, int num_sectors, void *out_buff)
 {
@@ -246,39 +332,33 @@ mvhd_sparse_read(MVHDMeta *vhdm, uint32_t offset, int num_sectors, void *out_buf
     check_sectors(offset, num_sectors, total_sectors, &transfer_sectors, &truncated_sectors);
 
     uint8_t* buff = (uint8_t*)out_buff;
-    int64_t addr = 0ULL;
-    uint32_t s = 0;
-    uint32_t ls = 0;
+    uint32_t s = offset;
+    uint32_t ls = offset + transfer_sectors;
     int blk = 0;
-    int prev_blk = -1;
     int sib = 0;
-    ls = offset + transfer_sectors;
+    int run = 0;
+    bool present;
 
-    for (s = offset; s < ls; s++) {
+    while (s < ls) {
         blk = s / vhdm->sect_per_block;
         sib = s % vhdm->sect_per_block;
-        if (blk != prev_blk) {
-            prev_blk = blk;
-            if (vhdm->bitmap.curr_block != blk) {
+        run = MIN(ls - s, (uint32_t) (vhdm->sect_per_block - sib));
+
+        if (vhdm->block_offset[blk] == MVHD_SPARSE_BLK)
+            present = false;
+        else {
+            if (vhdm->bitmap.curr_block != blk)
                 read_sect_bitmap(vhdm, blk);
-                if (mvhd_fseeko64(vhdm->f, (uint64_t)sib * MVHD_SECTOR_SIZE, SEEK_CUR) == -1)
-                    vhdm->error = 1;
-            } else {
-                addr = (((int64_t) vhdm->block_offset[blk]) + vhdm->bitmap.sector_count + sib) *
-                       MVHD_SECTOR_SIZE;
-                if (mvhd_fseeko64(vhdm->f, addr, SEEK_SET) == -1)
-                    vhdm->error = 1;
-            }
+            run = bitmap_run(vhdm->bitmap.curr_bitmap, sib, run, &present);
         }
 
-        if (VHD_TESTBIT(vhdm->bitmap.curr_bitmap, sib)) {
-            if (!fread(buff, MVHD_SECTOR_SIZE, 1, vhdm->f) && !feof(vhdm->f))
-                vhdm->error = 1;
-        } else {
-            memset(buff, 0, MVHD_SECTOR_SIZE);
-            mvhd_fseeko64(vhdm->f, MVHD_SECTOR_SIZE, SEEK_CUR);
-        }
-        buff += MVHD_SECTOR_SIZE;
+        if (present)
+            read_block_run(vhdm, blk, sib, run, buff);
+        else
+            memset(buff, 0, (size_t) run * MVHD_SECTOR_SIZE);
+
+        s += run;
+        buff += (size_t) run * MVHD_SECTOR_SIZE;
     }
 
     return truncated_sectors;
@@ -294,39 +374,37 @@ mvhd_diff_read(MVHDMeta *vhdm, uint32_t offset, int num_sectors, void *out_buff)
     check_sectors(offset, num_sectors, total_sectors, &transfer_sectors, &truncated_sectors);
 
     uint8_t *buff = (uint8_t*)out_buff;
-    MVHDMeta *curr_vhdm = vhdm;
-    uint32_t s = 0;
-    uint32_t ls = 0;
+    uint32_t s = offset;
+    uint32_t ls = offset + transfer_sectors;
     int blk = 0;
     int sib = 0;
-    ls = offset + transfer_sectors;
+    int run = 0;
+    bool present;
+
+    /* Sectors present in this image are read from it a run at a time, every
+       run that is not is handed to the parent in one go, so the chain is only
+       walked once per run rather than once per sector. A block that was never
+       allocated here goes to the parent whole, without reading its bitmap. */
+    while (s < ls) {
+        blk = s / vhdm->sect_per_block;
+        sib = s % vhdm->sect_per_block;
+        run = MIN(ls - s, (uint32_t) (vhdm->sect_per_block - sib));
 
-    for (s = offset; s < ls; s++) {
-        while (curr_vhdm->footer.disk_type == MVHD_TYPE_DIFF) {
-            blk = s / curr_vhdm->sect_per_block;
-            sib = s % curr_vhdm->sect_per_block;
-            if (curr_vhdm->bitmap.curr_block != blk) {
-                read_sect_bitmap(curr_vhdm, blk);
-            }
-            if (!VHD_TESTBIT(curr_vhdm->bitmap.curr_bitmap, sib)) {
-                curr_vhdm = curr_vhdm->parent;
-            } else { break; }
+        if (vhdm->block_offset[blk] == MVHD_SPARSE_BLK)
+            present = false;
+        else {
+            if (vhdm->bitmap.curr_block != blk)
+                read_sect_bitmap(vhdm, blk);
+            run = bitmap_run(vhdm->bitmap.curr_bitmap, sib, run, &present);
         }
 
-        /* We handle actual sector reading using the fixed or sparse functions,
-           as a differencing VHD is also a sparse VHD */
-        if ((curr_vhdm->footer.disk_type == MVHD_TYPE_DIFF) ||
-            (curr_vhdm->footer.disk_type == MVHD_TYPE_DYNAMIC))
-            mvhd_sparse_read(curr_vhdm, s, 1, buff);
+        if (present)
+            read_block_run(vhdm, blk, sib, run, buff);
         else
-            mvhd_fixed_read(curr_vhdm, s, 1, buff);
-        if (curr_vhdm->error) {
-            curr_vhdm->error = 0;
-            vhdm->error = 1;
-        }
+            read_parent_run(vhdm, s, run, buff);
 
-        curr_vhdm = vhdm;
-        buff += MVHD_SECTOR_SIZE;
+        s += run;
+        buff += (size_t) run * MVHD_SECTOR_SIZE;
     }
 
     return truncated_sectors;
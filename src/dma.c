@@ -33,6 +33,8 @@
 #include <86box/io.h>
 #include <86box/pic.h>
 #include <86box/dma.h>
+#include <86box/timer.h>
+#include <86box/snapshot.h>
 #include <86box/plat_unused.h>
 
 dma_t   dma[8];
@@ -1915,3 +1917,45 @@ dma_bm_write(uint32_t PhysAddress, const uint8_t *DataWrite, uint32_t TotalSize,
     if (dma_at)
         mem_invalidate_range(PhysAddress, PhysAddress + TotalSize - 1);
 }
+
+void
+dma_save_state(snapshot_t *s)
+{
+    snapshot_write_var(s, dma);
+    snapshot_write_var(s, dma_e);
+    snapshot_write_var(s, dma_m);
+    snapshot_write_var(s, dmaregs);
+    snapshot_write_var(s, dma_wp);
+    snapshot_write_var(s, dma_stat);
+    snapshot_write_var(s, dma_stat_rq);
+    snapshot_write_var(s, dma_stat_rq_pc);
+    snapshot_write_var(s, dma_stat_adv_pend);
+    snapshot_write_var(s, dma_command);
+    snapshot_write_var(s, dma_req_is_soft);
+    snapshot_write_var(s, dma_advanced);
+    snapshot_write_var(s, dma_at);
+    snapshot_write_var(s, dma_sg_base);
+    snapshot_write_var(s, dma_mask);
+    snapshot_write_var(s, dma_ps2);
+}
+
+void
+dma_load_state(snapshot_t *s)
+{
+    snapshot_read_var(s, dma);
+    snapshot_read_var(s, dma_e);
+    snapshot_read_var(s, dma_m);
+    snapshot_read_var(s, dmaregs);
+    snapshot_read_var(s, dma_wp);
+    snapshot_read_var(s, dma_stat);
+    snapshot_read_var(s, dma_stat_rq);
+    snapshot_read_var(s, dma_stat_rq_pc);
+    snapshot_read_var(s, dma_stat_adv_pend);
+    snapshot_read_var(s, dma_command);
+    snapshot_read_var(s, dma_req_is_soft);
+    snapshot_read_var(s, dma_advanced);
+    snapshot_read_var(s, dma_at);
+    snapshot_read_var(s, dma_sg_base);
+    snapshot_read_var(s, dma_mask);
+    snapshot_read_var(s, dma_ps2);
+}
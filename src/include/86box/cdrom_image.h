@@ -30,9 +30,14 @@ typedef struct track_file_t {
     void *priv;
     void *log;
 
+    uint8_t *map; /* Read-only mapping of the whole file, if enabled and the host allows it. */
+    uint64_t map_size;
+
     int motorola;
 } track_file_t;
 
+extern int cdrom_image_mmap;
+
 extern void *        image_open(cdrom_t *dev, const char *path);
 
 #endif /*CDROM_IMAGE_H*/
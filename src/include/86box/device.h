@@ -157,6 +157,8 @@ typedef struct _device_config_ {
     const device_config_bios_t       bios[32];
 } device_config_t;
 
+struct snapshot_t;
+
 typedef struct _device_ {
     const char *name;
     const char *internal_name;
@@ -174,6 +176,11 @@ typedef struct _device_ {
     void (*force_redraw)(void *priv);
 
     const device_config_t *config;
+
+    /* Save state hooks, see snapshot.h. A device with an init function but
+       without these makes the machine unsaveable. */
+    void (*save_state)(void *priv, struct snapshot_t *s);
+    void (*load_state)(void *priv, struct snapshot_t *s);
 } device_t;
 
 typedef struct device_context_t {
@@ -208,6 +215,9 @@ extern void *device_get_priv(const device_t *dev);
 extern int   device_available(const device_t *dev);
 extern void  device_speed_changed(void);
 extern void  device_force_redraw(void);
+extern const device_t *device_find_unsaveable(void);
+extern void  device_save_state_all(struct snapshot_t *s);
+extern void  device_load_state_all(struct snapshot_t *s);
 extern void  device_get_name(const device_t *dev, int bus, char *name);
 extern int   device_has_config(const device_t *dev);
 
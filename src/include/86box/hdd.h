@@ -84,6 +84,13 @@ enum {
     HDD_OP_WRITE = 3
 };
 
+/* Copy-on-write overlay modes. */
+enum {
+    HDD_OVERLAY_NONE    = 0,
+    HDD_OVERLAY_KEEP    = 1, /* delta file kept across runs */
+    HDD_OVERLAY_DISCARD = 2  /* delta file deleted when the image is closed */
+};
+
 #define HDD_MAX_ZONES     16
 #define HDD_MAX_CACHE_SEG 16
 
@@ -197,9 +204,17 @@ typedef struct hard_disk_t {
     double             cyl_switch_usec;
 } hard_disk_t;
 
+typedef struct hdd_image_cache_t hdd_image_cache_t;
+
+typedef int (*hdd_image_cache_io_t)(uint8_t id, uint32_t sector, uint32_t count, uint8_t *buffer);
+
 extern hard_disk_t  hdd[HDD_NUM];
 extern unsigned int hdd_table[128][3];
 
+extern int hdd_image_cache_size;
+extern int hdd_image_cache_write_back;
+extern int hdd_image_overlay;
+
 extern int   hdd_init(void);
 extern int   hdd_string_to_bus(char *str, int cdrom);
 extern char *hdd_bus_to_string(int bus, int cdrom);
@@ -209,6 +224,9 @@ extern void     hdd_image_init(void);
 extern int      hdd_image_load(int id);
 extern int      hdd_image_seek(uint8_t id, uint32_t sector);
 extern int      hdd_image_read(uint8_t id, uint32_t sector, uint32_t count, uint8_t *buffer);
+extern void     hdd_image_read_start(uint8_t id, uint32_t sector, uint32_t count);
+extern int      hdd_image_read_busy(uint8_t id);
+extern int      hdd_image_read_finish(uint8_t id, uint32_t sector, uint32_t count, uint8_t *buffer);
 extern int      hdd_image_read_ex(uint8_t id, uint32_t sector, uint32_t count, uint8_t *buffer);
 extern int      hdd_image_write(uint8_t id, uint32_t sector, uint32_t count, uint8_t *buffer);
 extern int      hdd_image_write_ex(uint8_t id, uint32_t sector, uint32_t count, uint8_t *buffer);
@@ -221,6 +239,13 @@ extern void     hdd_image_unload(uint8_t id, int fn_preserve);
 extern void     hdd_image_close(uint8_t id);
 extern void     hdd_image_calc_chs(uint32_t *c, uint32_t *h, uint32_t *s, uint32_t size);
 
+extern hdd_image_cache_t *hdd_image_cache_init(uint8_t id, uint32_t sectors, hdd_image_cache_io_t read, hdd_image_cache_io_t write);
+extern void               hdd_image_cache_close(hdd_image_cache_t *cache);
+extern int                hdd_image_cache_read(hdd_image_cache_t *cache, uint32_t sector, uint32_t count, uint8_t *buffer);
+extern int                hdd_image_cache_write(hdd_image_cache_t *cache, uint32_t sector, uint32_t count, uint8_t *buffer);
+extern int                hdd_image_cache_flush(hdd_image_cache_t *cache);
+extern int                hdd_image_cache_discard(hdd_image_cache_t *cache, uint32_t sector, uint32_t count);
+
 extern int image_is_hdi(const char *s);
 extern int image_is_hdx(const char *s, int check_signature);
 extern int image_is_vhd(const char *s, int check_signature);
@@ -0,0 +1,85 @@
+/*
+ * 86Box    A hypervisor and IBM PC system emulator that specializes in
+ *          running old operating systems and software designed for IBM
+ *          PC systems and compatibles from 1981 through fairly recent
+ *          system designs based on the PCI bus.
+ *
+ *          This file is part of the 86Box distribution.
+ *
+ *          Definitions for the performance counters and the headless
+ *          benchmark mode.
+ */
+#ifndef EMU_PERF_H
+#define EMU_PERF_H
+
+#define PERF_THREADS_MAX 16
+
+/* Counters are only ever bumped by the thread that owns the event, so
+   plain increments are good enough; the report is taken from the CPU
+   thread once the run is over. */
+typedef struct perf_counters_t {
+    uint64_t emu_slices; /* 10 ms pc_run() slices executed */
+    uint64_t timer_callbacks;
+    uint64_t io_reads;
+    uint64_t io_writes;
+    uint64_t mmio_reads;
+    uint64_t mmio_writes;
+    uint64_t blocks_compiled;
+    uint64_t blocks_invalidated;
+    uint64_t blocks_chained;    /* entered through a block link */
+    uint64_t blocks_dispatched; /* entered through the hash lookup */
+    uint64_t flag_writes_elided;
+    uint64_t blocks_missed;  /* no compiled code for the block, new block started */
+    uint64_t blocks_evicted; /* deleted to make room in the code cache */
+    uint64_t blocks_prewarmed; /* compiled straight away from the translation cache */
+    uint64_t video_lines_copied;  /* frame lines handed to the renderers */
+    uint64_t video_lines_skipped; /* frame lines left alone as unchanged */
+    uint64_t video_blit_wait_us;   /* emulation thread blocked on the blit thread */
+    uint64_t video_frames_dropped; /* replaced before the blit thread got to them */
+    uint64_t vnc_tiles_sent;       /* marked modified for the VNC clients */
+    uint64_t vnc_tiles_skipped;    /* on a changed line, but identical to what the clients have */
+    uint64_t hdd_async_reads;      /* disk reads done ahead of the emulated transfer */
+    uint64_t hdd_read_stalls;      /* controller held off because the host read was late */
+    uint64_t hdd_cache_hits;       /* disk image block found in the host-side cache */
+    uint64_t hdd_cache_misses;
+    uint64_t hdd_cache_bytes_saved; /* served from the cache instead of the image */
+    uint64_t hdd_cache_read_ahead;  /* extra blocks fetched on sequential misses */
+    uint64_t voodoo_tex_hits;
+    uint64_t voodoo_tex_misses;      /* texture decoded into the cache */
+    uint64_t voodoo_tex_evicted;     /* valid entry reused for another texture */
+    uint64_t voodoo_tex_invalidated; /* dropped after a write to texture memory */
+} perf_counters_t;
+
+extern perf_counters_t perf_counters;
+
+/* Benchmark mode, set up from the command line. */
+extern int      perf_bench_enabled;
+extern uint32_t perf_bench_secs;         /* 0 = run until the guest ends it */
+extern char     perf_bench_report[1024]; /* empty = write to stdout */
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+extern void perf_reset(void);
+
+/* Called by a thread to have its CPU time included in the report. */
+extern void perf_thread_register(const char *name);
+
+/* Benchmark control, called from the platform CPU thread loop. */
+extern void perf_bench_start(void);
+extern int  perf_bench_done(void);
+extern void perf_bench_finish(void);
+
+/* A guest trigger (e.g. the unit tester's exit command) ends the run at
+   the end of the current slice, with the given process exit code. */
+extern void perf_bench_stop(int exit_code);
+
+/* What the platform main() returns once the benchmark has shut down. */
+extern int perf_bench_get_exit_code(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /*EMU_PERF_H*/
@@ -151,8 +151,13 @@ extern int      plat_dir_check(char *path);
 extern int      plat_dir_create(char *path);
 extern void    *plat_mmap(size_t size, uint8_t executable);
 extern void     plat_munmap(void *ptr, size_t size);
+extern void    *plat_mmap_ram(size_t size, const char *path);
+extern void     plat_munmap_ram(void *ptr, size_t size);
+extern void    *plat_mmap_file(FILE *fp, uint64_t size);
+extern void     plat_munmap_file(void *ptr, uint64_t size);
 extern uint64_t plat_timer_read(void);
 extern uint32_t plat_get_ticks(void);
+extern uint64_t plat_get_micro_ticks(void);
 extern void     plat_delay_ms(uint32_t count);
 extern void     plat_pause(int p);
 extern void     plat_mouse_capture(int on);
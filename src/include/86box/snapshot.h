@@ -0,0 +1,70 @@
+/*
+ * 86Box    A hypervisor and IBM PC system emulator that specializes in
+ *          running old operating systems and software designed for IBM
+ *          PC systems and compatibles from 1981 through fairly recent
+ *          system designs based on the PCI bus.
+ *
+ *          This file is part of the 86Box distribution.
+ *
+ *          Definitions for the machine state snapshot (save state) module.
+ */
+#ifndef EMU_SNAPSHOT_H
+#define EMU_SNAPSHOT_H
+
+#define SNAPSHOT_MAGIC   "86BoxSNP"
+#define SNAPSHOT_VERSION 1
+
+/* Section tags are four ASCII characters. */
+#define SNAPSHOT_TAG(a, b, c, d) ((uint32_t) (a) | ((uint32_t) (b) << 8) | \
+                                  ((uint32_t) (c) << 16) | ((uint32_t) (d) << 24))
+
+typedef struct snapshot_t snapshot_t;
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Save/restore the whole machine, returns 0 on success. */
+extern int  snapshot_save(const char *fn);
+extern int  snapshot_load(const char *fn);
+
+/* Returns non-zero if every device of the running machine can be saved. */
+extern int  snapshot_supported(void);
+
+/* Section framing. Every section is a tag, an instance number and a byte
+   length, so that a reader can skip or verify it. */
+extern void snapshot_begin_section(snapshot_t *s, uint32_t tag, uint32_t inst);
+extern void snapshot_end_section(snapshot_t *s);
+extern int  snapshot_enter_section(snapshot_t *s, uint32_t tag, uint32_t inst);
+extern void snapshot_leave_section(snapshot_t *s);
+
+/* Raw data. Once an error has occurred, all further reads and writes are
+   ignored and snapshot_error() returns non-zero. */
+extern void snapshot_write(snapshot_t *s, const void *data, size_t size);
+extern void snapshot_read(snapshot_t *s, void *data, size_t size);
+extern int  snapshot_error(snapshot_t *s);
+extern void snapshot_set_error(snapshot_t *s);
+
+/* Timers are stored as their 32:32 timestamp, period and enable state; the
+   callback and private pointers are left alone on restore. */
+extern void snapshot_write_timer(snapshot_t *s, const pc_timer_t *timer);
+extern void snapshot_read_timer(snapshot_t *s, pc_timer_t *timer);
+
+#define snapshot_write_var(s, v) snapshot_write((s), &(v), sizeof(v))
+#define snapshot_read_var(s, v)  snapshot_read((s), &(v), sizeof(v))
+
+/* Per-module state, called by snapshot_save()/snapshot_load(). */
+extern void cpu_save_state(snapshot_t *s);
+extern void cpu_load_state(snapshot_t *s);
+extern void mem_save_state(snapshot_t *s);
+extern void mem_load_state(snapshot_t *s);
+extern void pic_save_state(snapshot_t *s);
+extern void pic_load_state(snapshot_t *s);
+extern void dma_save_state(snapshot_t *s);
+extern void dma_load_state(snapshot_t *s);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /*EMU_SNAPSHOT_H*/
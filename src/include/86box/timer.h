@@ -50,8 +50,8 @@ typedef struct pc_timer_t {
     void (*callback)(void *priv);
     void *priv;
 
-    struct pc_timer_t *prev;
-    struct pc_timer_t *next;
+    uint32_t heap_idx; /* Position in the timer heap, 0 if not queued. */
+    uint32_t seq;      /* Enable order, used to break timestamp ties. */
 } pc_timer_t;
 
 #ifdef __cplusplus
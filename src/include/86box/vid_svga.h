@@ -315,6 +315,16 @@ typedef struct svga_t {
       card should not attempt to display anything. */
     void       (*render_override)(void *priv);
     void *     priv_parent;
+
+    /* Scanline render worker, if svga_render_thread is enabled. */
+    struct svga_render_worker_t *render_worker;
+    /* Bumped by anything that changes what the renderers read, other
+       than svga_poll() itself; the worker then takes a new copy. */
+    uint32_t render_gen;
+
+    /* Lines of the target buffer redrawn since the last blit; must stay
+       the last member, line snapshots for the render worker stop here. */
+    uint8_t dirty_lines[2048];
 } svga_t;
 
 extern void     ibm8514_set_poll(svga_t *svga);
@@ -464,6 +474,7 @@ extern uint8_t tkd8001_ramdac_in(uint16_t addr, void *priv, svga_t *svga);
 extern void     tvp3026_ramdac_out(uint16_t addr, int rs2, int rs3, uint8_t val, void *priv, svga_t *svga);
 extern uint8_t  tvp3026_ramdac_in(uint16_t addr, int rs2, int rs3, void *priv, svga_t *svga);
 extern uint32_t tvp3026_conv_16to32(svga_t* svga, uint16_t color, uint8_t bpp);
+extern uint32_t svga_conv_16to32(svga_t *svga, uint16_t color, uint8_t bpp);
 extern void     tvp3026_recalctimings(void *priv, svga_t *svga);
 extern void     tvp3026_hwcursor_draw(svga_t *svga, int displine);
 extern float    tvp3026_getclock(int clock, void *priv);
@@ -89,4 +89,11 @@ extern void ibm8514_render_RGBA8888(svga_t *svga);
 
 extern void (*svga_render)(svga_t *svga);
 
+extern void svga_render_span_init(void);
+extern void svga_render_span_8bpp(svga_t *svga, uint32_t *p, uint32_t ma, int n);
+extern void svga_render_span_16bpp(svga_t *svga, uint32_t *p, uint32_t ma, int n, uint8_t bpp);
+extern void svga_render_span_24bpp(svga_t *svga, uint32_t *p, uint32_t ma, int n);
+extern void svga_render_span_32bpp(svga_t *svga, uint32_t *p, uint32_t ma, int n);
+extern void svga_render_span_double(uint32_t *p, int n);
+
 #endif /*VID_SVGA_RENDER_H*/
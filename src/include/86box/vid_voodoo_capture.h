@@ -0,0 +1,120 @@
+/*
+ * 86Box    A hypervisor and IBM PC system emulator that specializes in
+ *          running old operating systems and software designed for IBM
+ *          PC systems and compatibles from 1981 through fairly recent
+ *          system designs based on the PCI bus.
+ *
+ *          This file is part of the 86Box distribution.
+ *
+ *          Voodoo Graphics, 2, Banshee, 3 command stream capture and replay.
+ *
+ *
+ *
+ *          Copyright 2026 The 86Box development team
+ */
+
+#ifndef VIDEO_VOODOO_CAPTURE_H
+#define VIDEO_VOODOO_CAPTURE_H
+
+/*A capture file is a voodoo_capture_header_t followed by little-endian
+  (addr_type, val) pairs, in the order the FIFO thread executes them.
+
+  Records with a FIFO_* type in the top byte are FIFO entries exactly as
+  voodoo_fifo_thread() consumed them. The capture-only types are:
+
+  VOODOO_CAPTURE_CMDFIFO   - word fetched from CMDFIFO 1 (low bits: read pointer)
+  VOODOO_CAPTURE_CMDFIFO_2 - word fetched from CMDFIFO 2 (Banshee/Voodoo 3)
+  VOODOO_CAPTURE_STATE     - register written outside the FIFO (low bits: id)
+  VOODOO_CAPTURE_STAT      - per-frame statistic (low bits: id)
+  VOODOO_CAPTURE_FRAME     - swap, val is a checksum of the draw buffer
+
+  A STATE record for every id follows the header, then one is written each
+  time the CPU writes one of those registers, at that point in the stream.
+  STAT records precede their FRAME record. Times are plat_timer_read()
+  units.*/
+
+#define VOODOO_CAPTURE_MAGIC   0x50414356 /*"VCAP"*/
+#define VOODOO_CAPTURE_VERSION 1
+
+enum {
+    VOODOO_CAPTURE_CMDFIFO   = (0x10 << 24),
+    VOODOO_CAPTURE_CMDFIFO_2 = (0x11 << 24),
+    VOODOO_CAPTURE_STATE     = (0x12 << 24),
+    VOODOO_CAPTURE_STAT      = (0x13 << 24),
+    VOODOO_CAPTURE_FRAME     = (0x14 << 24)
+};
+
+enum {
+    VOODOO_CAPTURE_STATE_FBIINIT0   = 0, /*fbiInit0-7 are consecutive*/
+    VOODOO_CAPTURE_STATE_INITENABLE = 8,
+    VOODOO_CAPTURE_STATE_H_DISP,
+    VOODOO_CAPTURE_STATE_V_DISP,
+    VOODOO_CAPTURE_STATE_Y_ORIGIN_SWAP,
+    VOODOO_CAPTURE_STATE_COUNT
+};
+
+enum {
+    VOODOO_CAPTURE_STAT_TRIANGLES = 0,
+    VOODOO_CAPTURE_STAT_PIXELS,
+    VOODOO_CAPTURE_STAT_TEXELS,
+    VOODOO_CAPTURE_STAT_FIFO_TIME,
+    VOODOO_CAPTURE_STAT_RENDER_TIME,
+    VOODOO_CAPTURE_STAT_COUNT
+};
+
+typedef struct voodoo_capture_header_t {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t type;
+    uint32_t fb_mask;
+    uint32_t texture_mask;
+    uint32_t dual_tmus;
+} voodoo_capture_header_t;
+
+/*One frame as read back by voodoo_capture_read()*/
+typedef struct voodoo_capture_frame_t {
+    uint32_t records; /*FIFO and CMDFIFO records executed during the frame*/
+    uint32_t stat[VOODOO_CAPTURE_STAT_COUNT];
+    uint32_t checksum;
+} voodoo_capture_frame_t;
+
+int      voodoo_capture_read(const char *fn, voodoo_capture_header_t *header,
+                             void (*frame_func)(void *priv, const voodoo_capture_frame_t *frame), void *priv);
+uint32_t voodoo_capture_checksum(voodoo_t *voodoo);
+
+void voodoo_capture_open(voodoo_t *voodoo);
+void voodoo_capture_close(voodoo_t *voodoo);
+void voodoo_capture_write(voodoo_t *voodoo, uint32_t addr_type, uint32_t val);
+void voodoo_capture_end_frame(voodoo_t *voodoo);
+
+void     voodoo_replay_open(voodoo_t *voodoo);
+void     voodoo_replay_close(voodoo_t *voodoo);
+int      voodoo_replay_cmdfifo_pending(voodoo_t *voodoo, int fifo);
+uint32_t voodoo_replay_cmdfifo_get(voodoo_t *voodoo, int fifo);
+void     voodoo_replay_end_frame(voodoo_t *voodoo);
+
+static __inline void
+voodoo_capture(voodoo_t *voodoo, uint32_t addr_type, uint32_t val)
+{
+    if (voodoo->capture)
+        voodoo_capture_write(voodoo, addr_type, val);
+}
+
+/*Called by the CPU thread right after it writes one of the STATE registers*/
+static __inline void
+voodoo_capture_state(voodoo_t *voodoo, int id, uint32_t val)
+{
+    if (voodoo->capture)
+        voodoo_capture_write(voodoo, VOODOO_CAPTURE_STATE | id, val);
+}
+
+static __inline void
+voodoo_capture_frame(voodoo_t *voodoo)
+{
+    if (voodoo->capture)
+        voodoo_capture_end_frame(voodoo);
+    if (voodoo->replay)
+        voodoo_replay_end_frame(voodoo);
+}
+
+#endif /*VIDEO_VOODOO_CAPTURE_H*/
@@ -0,0 +1,762 @@
+/*Registers :
+
+  alphaMode
+  fbzMode & 0x1f3fff
+  fbzColorPath
+
+  AArch64 pixel pipeline. Only untextured, unfogged, unblended spans into
+  linear buffers are generated; voodoo_get_block() returns NULL for anything
+  else and the caller falls back to the C path.
+
+  Register usage in generated code :
+
+  X0  - state             X1  - params
+  W2  - x                 W3  - dither row offset
+  W4  - x2                W5-W9 - ir, ig, ib, ia, z
+  X10 - w                 X11 - fb_mem
+  X12 - aux_mem           W13 - pixel count
+  W14-W17 - scratch       X16 - also used for out of range offsets
+  W19 - new_depth         W20 - alocal
+  W21 - aother            W22-W25 - src_r, src_g, src_b, src_a
+  X26 - dither_rb         X27 - dither_g
+  W28 - 0xff
+*/
+
+#ifndef VIDEO_VOODOO_CODEGEN_ARM64_H
+#define VIDEO_VOODOO_CODEGEN_ARM64_H
+
+#if defined __APPLE__
+#    include <pthread.h>
+#endif
+#ifdef _MSC_VER
+#    include <windows.h>
+#endif
+
+#define BLOCK_NUM  8
+#define BLOCK_MASK (BLOCK_NUM - 1)
+#define BLOCK_SIZE 8192
+
+#define LOD_MASK   (LOD_TMIRROR_S | LOD_TMIRROR_T)
+
+typedef struct voodoo_arm64_data_t {
+    uint32_t code_block[BLOCK_SIZE / 4];
+    int      xdir;
+    uint32_t alphaMode;
+    uint32_t fbzMode;
+    uint32_t fogMode;
+    uint32_t fbzColorPath;
+    uint32_t textureMode[2];
+    uint32_t tLOD[2];
+    uint32_t trexInit1;
+    int      is_tiled;
+} voodoo_arm64_data_t;
+
+static int last_block[VOODOO_MAX_RENDER_THREADS]          = { 0 };
+static int next_block_to_write[VOODOO_MAX_RENDER_THREADS] = { 0 };
+
+enum {
+    REG_STATE   = 0,
+    REG_PARAMS  = 1,
+    REG_X       = 2,
+    REG_DITHY   = 3,
+    REG_X2      = 4,
+    REG_IR      = 5,
+    REG_IG      = 6,
+    REG_IB      = 7,
+    REG_IA      = 8,
+    REG_Z       = 9,
+    REG_W       = 10,
+    REG_FB      = 11,
+    REG_AUX     = 12,
+    REG_COUNT   = 13,
+    REG_T0      = 14,
+    REG_T1      = 15,
+    REG_T2      = 16,
+    REG_T3      = 17,
+    REG_DEPTH   = 19,
+    REG_ALOCAL  = 20,
+    REG_AOTHER  = 21,
+    REG_SRC_R   = 22,
+    REG_SRC_G   = 23,
+    REG_SRC_B   = 24,
+    REG_SRC_A   = 25,
+    REG_DITH_RB = 26,
+    REG_DITH_G  = 27,
+    REG_FF      = 28,
+    REG_ZR      = 31
+};
+
+enum {
+    COND_EQ = 0x0,
+    COND_NE = 0x1,
+    COND_LT = 0xb,
+    COND_GT = 0xc,
+    COND_LE = 0xd,
+    COND_GE = 0xa
+};
+
+typedef struct arm64_block_t {
+    uint32_t *code;
+    int       pos;
+} arm64_block_t;
+
+#define addinst(val)                   \
+    do {                               \
+        blk->code[blk->pos++] = val;   \
+    } while (0)
+
+/*Data processing*/
+static void
+arm64_movz(arm64_block_t *blk, int dst, uint16_t imm, int hw)
+{
+    addinst(0x52800000 | (hw << 21) | (imm << 5) | dst); /*MOVZ Wd, #imm, LSL #hw*16*/
+}
+static void
+arm64_mov_imm64(arm64_block_t *blk, int dst, uint64_t imm)
+{
+    addinst(0xd2800000 | ((imm & 0xffff) << 5) | dst); /*MOVZ Xd, #imm*/
+    for (int hw = 1; hw < 4; hw++) {
+        if ((imm >> (hw * 16)) & 0xffff)
+            addinst(0xf2800000 | (hw << 21) | (((imm >> (hw * 16)) & 0xffff) << 5) | dst); /*MOVK Xd, #imm, LSL #hw*16*/
+    }
+}
+static void
+arm64_mov(arm64_block_t *blk, int dst, int src)
+{
+    addinst(0x2a0003e0 | (src << 16) | dst); /*MOV Wd, Wm*/
+}
+static void
+arm64_add(arm64_block_t *blk, int dst, int src_n, int src_m)
+{
+    addinst(0x0b000000 | (src_m << 16) | (src_n << 5) | dst); /*ADD Wd, Wn, Wm*/
+}
+static void
+arm64_sub(arm64_block_t *blk, int dst, int src_n, int src_m)
+{
+    addinst(0x4b000000 | (src_m << 16) | (src_n << 5) | dst); /*SUB Wd, Wn, Wm*/
+}
+static void
+arm64_add_x(arm64_block_t *blk, int dst, int src_n, int src_m)
+{
+    addinst(0x8b000000 | (src_m << 16) | (src_n << 5) | dst); /*ADD Xd, Xn, Xm*/
+}
+static void
+arm64_sub_x(arm64_block_t *blk, int dst, int src_n, int src_m)
+{
+    addinst(0xcb000000 | (src_m << 16) | (src_n << 5) | dst); /*SUB Xd, Xn, Xm*/
+}
+static void
+arm64_add_imm(arm64_block_t *blk, int dst, int src, int imm)
+{
+    addinst(0x11000000 | (imm << 10) | (src << 5) | dst); /*ADD Wd, Wn, #imm*/
+}
+static void
+arm64_sub_imm(arm64_block_t *blk, int dst, int src, int imm)
+{
+    addinst(0x51000000 | (imm << 10) | (src << 5) | dst); /*SUB Wd, Wn, #imm*/
+}
+static void
+arm64_cmp(arm64_block_t *blk, int src_n, int src_m)
+{
+    addinst(0x6b00001f | (src_m << 16) | (src_n << 5)); /*CMP Wn, Wm*/
+}
+static void
+arm64_cmp_imm(arm64_block_t *blk, int src, int imm)
+{
+    addinst(0x7100001f | (imm << 10) | (src << 5)); /*CMP Wn, #imm*/
+}
+static void
+arm64_csel(arm64_block_t *blk, int dst, int src_n, int src_m, int cond)
+{
+    addinst(0x1a800000 | (src_m << 16) | (cond << 12) | (src_n << 5) | dst); /*CSEL Wd, Wn, Wm, cond*/
+}
+static void
+arm64_asr_imm(arm64_block_t *blk, int dst, int src, int shift)
+{
+    addinst(0x13007c00 | (shift << 16) | (src << 5) | dst); /*ASR Wd, Wn, #shift*/
+}
+static void
+arm64_lsr_imm(arm64_block_t *blk, int dst, int src, int shift)
+{
+    addinst(0x53007c00 | (shift << 16) | (src << 5) | dst); /*LSR Wd, Wn, #shift*/
+}
+static void
+arm64_lsl_imm(arm64_block_t *blk, int dst, int src, int shift)
+{
+    addinst(0x53000000 | (((32 - shift) & 31) << 16) | ((31 - shift) << 10) | (src << 5) | dst); /*LSL Wd, Wn, #shift*/
+}
+static void
+arm64_lsr_imm_x(arm64_block_t *blk, int dst, int src, int shift)
+{
+    addinst(0xd340fc00 | (shift << 16) | (src << 5) | dst); /*LSR Xd, Xn, #shift*/
+}
+static void
+arm64_lsrv(arm64_block_t *blk, int dst, int src_n, int src_m)
+{
+    addinst(0x1ac02400 | (src_m << 16) | (src_n << 5) | dst); /*LSR Wd, Wn, Wm*/
+}
+static void
+arm64_mul(arm64_block_t *blk, int dst, int src_n, int src_m)
+{
+    addinst(0x1b007c00 | (src_m << 16) | (src_n << 5) | dst); /*MUL Wd, Wn, Wm*/
+}
+static void
+arm64_clz(arm64_block_t *blk, int dst, int src)
+{
+    addinst(0x5ac01000 | (src << 5) | dst); /*CLZ Wd, Wn*/
+}
+static void
+arm64_mvn(arm64_block_t *blk, int dst, int src)
+{
+    addinst(0x2a2003e0 | (src << 16) | dst); /*MVN Wd, Wm*/
+}
+/*AND with a mask of the low 'bits' bits*/
+static void
+arm64_and_mask(arm64_block_t *blk, int dst, int src, int bits)
+{
+    addinst(0x12000000 | ((bits - 1) << 10) | (src << 5) | dst); /*AND Wd, Wn, #((1 << bits) - 1)*/
+}
+static void
+arm64_eor_ff(arm64_block_t *blk, int dst, int src)
+{
+    addinst(0x52001c00 | (src << 5) | dst); /*EOR Wd, Wn, #0xff*/
+}
+static void
+arm64_orr(arm64_block_t *blk, int dst, int src_n, int src_m, int lsl)
+{
+    addinst(0x2a000000 | (src_m << 16) | (lsl << 10) | (src_n << 5) | dst); /*ORR Wd, Wn, Wm, LSL #lsl*/
+}
+static void
+arm64_add_x_uxtw(arm64_block_t *blk, int dst, int src_n, int src_m, int lsl)
+{
+    addinst(0x8b204000 | (src_m << 16) | (lsl << 10) | (src_n << 5) | dst); /*ADD Xd, Xn, Wm, UXTW #lsl*/
+}
+
+/*Loads and stores*/
+static void
+arm64_ldr_offset(arm64_block_t *blk, uint32_t opcode_imm, uint32_t opcode_reg, int size_shift, int dst, int base, uintptr_t offset)
+{
+    if (!(offset & ((1 << size_shift) - 1)) && (offset >> size_shift) < 4096)
+        addinst(opcode_imm | ((offset >> size_shift) << 10) | (base << 5) | dst);
+    else {
+        arm64_mov_imm64(blk, REG_T2, offset);
+        addinst(opcode_reg | (REG_T2 << 16) | (base << 5) | dst);
+    }
+}
+static void
+arm64_ldrb(arm64_block_t *blk, int dst, int base, uintptr_t offset)
+{
+    arm64_ldr_offset(blk, 0x39400000, 0x38606800, 0, dst, base, offset); /*LDRB Wt, [Xn, #offset]*/
+}
+static void
+arm64_ldrh(arm64_block_t *blk, int dst, int base, uintptr_t offset)
+{
+    arm64_ldr_offset(blk, 0x79400000, 0x78606800, 1, dst, base, offset); /*LDRH Wt, [Xn, #offset]*/
+}
+static void
+arm64_ldrsh(arm64_block_t *blk, int dst, int base, uintptr_t offset)
+{
+    arm64_ldr_offset(blk, 0x79c00000, 0x78e06800, 1, dst, base, offset); /*LDRSH Wt, [Xn, #offset]*/
+}
+static void
+arm64_ldr(arm64_block_t *blk, int dst, int base, uintptr_t offset)
+{
+    arm64_ldr_offset(blk, 0xb9400000, 0xb8606800, 2, dst, base, offset); /*LDR Wt, [Xn, #offset]*/
+}
+static void
+arm64_str(arm64_block_t *blk, int src, int base, uintptr_t offset)
+{
+    arm64_ldr_offset(blk, 0xb9000000, 0xb8206800, 2, src, base, offset); /*STR Wt, [Xn, #offset]*/
+}
+static void
+arm64_ldr_x(arm64_block_t *blk, int dst, int base, uintptr_t offset)
+{
+    arm64_ldr_offset(blk, 0xf9400000, 0xf8606800, 3, dst, base, offset); /*LDR Xt, [Xn, #offset]*/
+}
+static void
+arm64_ldrb_reg(arm64_block_t *blk, int dst, int base, int index)
+{
+    addinst(0x38604800 | (index << 16) | (base << 5) | dst); /*LDRB Wt, [Xn, Wm, UXTW]*/
+}
+static void
+arm64_ldrh_x(arm64_block_t *blk, int dst, int base)
+{
+    addinst(0x7860d800 | (REG_X << 16) | (base << 5) | dst); /*LDRH Wt, [Xn, W2, SXTW #1]*/
+}
+static void
+arm64_strh_x(arm64_block_t *blk, int src, int base)
+{
+    addinst(0x7820d800 | (REG_X << 16) | (base << 5) | src); /*STRH Wt, [Xn, W2, SXTW #1]*/
+}
+
+/*Branches. Forward branches are emitted with a zero offset and patched once
+  the target is known*/
+static int
+arm64_b(arm64_block_t *blk)
+{
+    addinst(0x14000000); /*B*/
+    return blk->pos - 1;
+}
+static int
+arm64_b_cond(arm64_block_t *blk, int cond)
+{
+    addinst(0x54000000 | cond); /*B.cond*/
+    return blk->pos - 1;
+}
+static int
+arm64_cbz(arm64_block_t *blk, int src)
+{
+    addinst(0x34000000 | src); /*CBZ Wt*/
+    return blk->pos - 1;
+}
+static int
+arm64_cbnz(arm64_block_t *blk, int src)
+{
+    addinst(0x35000000 | src); /*CBNZ Wt*/
+    return blk->pos - 1;
+}
+static void
+arm64_patch(arm64_block_t *blk, int branch_pos, int target)
+{
+    int offset = target - branch_pos;
+
+    if ((blk->code[branch_pos] & 0xfc000000) == 0x14000000)
+        blk->code[branch_pos] |= offset & 0x3ffffff;
+    else
+        blk->code[branch_pos] |= (offset & 0x7ffff) << 5;
+}
+
+/*dst = CLAMP(src >> shift)*/
+static void
+arm64_clamp8(arm64_block_t *blk, int dst, int src, int shift)
+{
+    if (shift)
+        arm64_asr_imm(blk, dst, src, shift);
+    else if (dst != src)
+        arm64_mov(blk, dst, src);
+    arm64_cmp_imm(blk, dst, 0);
+    arm64_csel(blk, dst, REG_ZR, dst, COND_LT);
+    arm64_cmp_imm(blk, dst, 0xff);
+    arm64_csel(blk, dst, REG_FF, dst, COND_GT);
+}
+/*dst = CLAMP16(dst)*/
+static void
+arm64_clamp16(arm64_block_t *blk, int dst)
+{
+    arm64_cmp_imm(blk, dst, 0);
+    arm64_csel(blk, dst, REG_ZR, dst, COND_LT);
+    arm64_movz(blk, REG_T2, 0xffff, 0);
+    arm64_cmp(blk, dst, REG_T2);
+    arm64_csel(blk, dst, REG_T2, dst, COND_GT);
+}
+
+/*Colour combine for one of R/G/B. byte selects the colour0/colour1 byte for
+  this channel, iter the matching iterator*/
+static void
+voodoo_arm64_combine_rgb(arm64_block_t *blk, voodoo_params_t *params, int dst, int iter, int byte)
+{
+    /*Texturing is disabled, so tex_a is zero and the local select override
+      always picks iterated RGB*/
+    if (cc_localselect && !cc_localselect_override)
+        arm64_ldrb(blk, REG_T0, REG_PARAMS, offsetof(voodoo_params_t, color0) + byte);
+    else
+        arm64_clamp8(blk, REG_T0, iter, 12);
+
+    if (cc_zero_other)
+        arm64_movz(blk, dst, 0, 0);
+    else
+        switch (_rgb_sel) {
+            case CC_LOCALSELECT_ITER_RGB:
+                arm64_clamp8(blk, dst, iter, 12);
+                break;
+            case CC_LOCALSELECT_COLOR1:
+                arm64_ldrb(blk, dst, REG_PARAMS, offsetof(voodoo_params_t, color1) + byte);
+                break;
+            default: /*TREX output and LFB are both zero here*/
+                arm64_movz(blk, dst, 0, 0);
+                break;
+        }
+
+    if (cc_sub_clocal)
+        arm64_sub(blk, dst, dst, REG_T0);
+
+    switch (cc_mselect) {
+        case CC_MSELECT_CLOCAL:
+            arm64_mov(blk, REG_T1, REG_T0);
+            break;
+        case CC_MSELECT_AOTHER:
+            arm64_mov(blk, REG_T1, REG_AOTHER);
+            break;
+        case CC_MSELECT_ALOCAL:
+            arm64_mov(blk, REG_T1, REG_ALOCAL);
+            break;
+        default: /*Zero, texture alpha and texture RGB are all zero here*/
+            arm64_movz(blk, REG_T1, 0, 0);
+            break;
+    }
+    if (!cc_reverse_blend)
+        arm64_eor_ff(blk, REG_T1, REG_T1);
+    arm64_add_imm(blk, REG_T1, REG_T1, 1);
+
+    arm64_mul(blk, dst, dst, REG_T1);
+    arm64_asr_imm(blk, dst, dst, 8);
+
+    if (cc_add == CC_ADD_CLOCAL)
+        arm64_add(blk, dst, dst, REG_T0);
+    else if (cc_add == CC_ADD_ALOCAL)
+        arm64_add(blk, dst, dst, REG_ALOCAL);
+
+    arm64_clamp8(blk, dst, dst, 0);
+    if (cc_invert_output)
+        arm64_eor_ff(blk, dst, dst);
+}
+
+static inline int
+voodoo_generate(uint32_t *code_block, voodoo_t *voodoo, voodoo_params_t *params, voodoo_state_t *state, int depthop)
+{
+    int skip_pos[4];
+    int skip_count = 0;
+    int loop_pos;
+    int done_pos;
+    arm64_block_t  block = { .code = code_block, .pos = 0 };
+    arm64_block_t *blk   = &block;
+
+    addinst(0xa9bf53f3); /*STP X19, X20, [SP, #-16]!*/
+    addinst(0xa9bf5bf5); /*STP X21, X22, [SP, #-16]!*/
+    addinst(0xa9bf63f7); /*STP X23, X24, [SP, #-16]!*/
+    addinst(0xa9bf6bf9); /*STP X25, X26, [SP, #-16]!*/
+    addinst(0xa9bf73fb); /*STP X27, X28, [SP, #-16]!*/
+
+    arm64_ldr(blk, REG_X2, REG_STATE, offsetof(voodoo_state_t, x2));
+    arm64_ldr(blk, REG_IR, REG_STATE, offsetof(voodoo_state_t, ir));
+    arm64_ldr(blk, REG_IG, REG_STATE, offsetof(voodoo_state_t, ig));
+    arm64_ldr(blk, REG_IB, REG_STATE, offsetof(voodoo_state_t, ib));
+    arm64_ldr(blk, REG_IA, REG_STATE, offsetof(voodoo_state_t, ia));
+    arm64_ldr(blk, REG_Z, REG_STATE, offsetof(voodoo_state_t, z));
+    arm64_ldr_x(blk, REG_W, REG_STATE, offsetof(voodoo_state_t, w));
+    arm64_ldr_x(blk, REG_FB, REG_STATE, offsetof(voodoo_state_t, fb_mem));
+    arm64_ldr_x(blk, REG_AUX, REG_STATE, offsetof(voodoo_state_t, aux_mem));
+    arm64_movz(blk, REG_COUNT, 0, 0);
+    arm64_movz(blk, REG_FF, 0xff, 0);
+
+    if (dither) {
+        /*Row within the dither matrix is constant for the span*/
+        if (dither2x2) {
+            arm64_and_mask(blk, REG_DITHY, REG_DITHY, 1);
+            arm64_lsl_imm(blk, REG_DITHY, REG_DITHY, 1);
+            arm64_mov_imm64(blk, REG_DITH_RB, (uintptr_t) dither_rb2x2);
+            arm64_mov_imm64(blk, REG_DITH_G, (uintptr_t) dither_g2x2);
+        } else {
+            arm64_and_mask(blk, REG_DITHY, REG_DITHY, 2);
+            arm64_lsl_imm(blk, REG_DITHY, REG_DITHY, 2);
+            arm64_mov_imm64(blk, REG_DITH_RB, (uintptr_t) dither_rb);
+            arm64_mov_imm64(blk, REG_DITH_G, (uintptr_t) dither_g);
+        }
+    }
+
+    loop_pos = blk->pos;
+
+    arm64_add_imm(blk, REG_COUNT, REG_COUNT, 1);
+
+    if (params->fbzMode & FBZ_DEPTH_ENABLE) {
+        if (params->fbzMode & FBZ_W_BUFFER) {
+            int zero_pos;
+            int max_pos;
+
+            arm64_lsr_imm_x(blk, REG_T0, REG_W, 32);
+            arm64_and_mask(blk, REG_T0, REG_T0, 16);
+            arm64_movz(blk, REG_DEPTH, 0, 0);
+            zero_pos = arm64_cbnz(blk, REG_T0);
+            arm64_lsr_imm(blk, REG_T1, REG_W, 16);
+            arm64_movz(blk, REG_DEPTH, 0xf001, 0);
+            max_pos = arm64_cbz(blk, REG_T1);
+            arm64_clz(blk, REG_T2, REG_T1);
+            arm64_sub_imm(blk, REG_T2, REG_T2, 16); /*exp = fls((uint16_t) (w >> 16))*/
+            arm64_movz(blk, REG_T3, 19, 0);
+            arm64_sub(blk, REG_T3, REG_T3, REG_T2);
+            arm64_mvn(blk, REG_T1, REG_W);
+            arm64_lsrv(blk, REG_T1, REG_T1, REG_T3);
+            arm64_and_mask(blk, REG_T1, REG_T1, 12); /*mant*/
+            arm64_lsl_imm(blk, REG_DEPTH, REG_T2, 12);
+            arm64_add(blk, REG_DEPTH, REG_DEPTH, REG_T1);
+            arm64_add_imm(blk, REG_DEPTH, REG_DEPTH, 1);
+            arm64_movz(blk, REG_T3, 0xffff, 0);
+            arm64_cmp(blk, REG_DEPTH, REG_T3);
+            arm64_csel(blk, REG_DEPTH, REG_T3, REG_DEPTH, COND_GT);
+            arm64_patch(blk, zero_pos, blk->pos);
+            arm64_patch(blk, max_pos, blk->pos);
+        } else {
+            arm64_asr_imm(blk, REG_DEPTH, REG_Z, 12);
+            arm64_clamp16(blk, REG_DEPTH);
+        }
+
+        if (params->fbzMode & FBZ_DEPTH_BIAS) {
+            arm64_ldrsh(blk, REG_T0, REG_PARAMS, offsetof(voodoo_params_t, zaColor));
+            arm64_add(blk, REG_DEPTH, REG_DEPTH, REG_T0);
+            arm64_clamp16(blk, REG_DEPTH);
+        }
+
+        if (depthop == DEPTHOP_NEVER)
+            skip_pos[skip_count++] = arm64_b(blk);
+        else if (depthop != DEPTHOP_ALWAYS) {
+            static const int fail_cond[8] = {
+                [DEPTHOP_LESSTHAN]         = COND_GE,
+                [DEPTHOP_EQUAL]            = COND_NE,
+                [DEPTHOP_LESSTHANEQUAL]    = COND_GT,
+                [DEPTHOP_GREATERTHAN]      = COND_LE,
+                [DEPTHOP_NOTEQUAL]         = COND_EQ,
+                [DEPTHOP_GREATERTHANEQUAL] = COND_LT
+            };
+            int comp = REG_DEPTH;
+
+            arm64_ldrh_x(blk, REG_T1, REG_AUX);
+            if (params->fbzMode & FBZ_DEPTH_SOURCE) {
+                arm64_ldrh(blk, REG_T0, REG_PARAMS, offsetof(voodoo_params_t, zaColor));
+                comp = REG_T0;
+            }
+            arm64_cmp(blk, comp, REG_T1);
+            skip_pos[skip_count++] = arm64_b_cond(blk, fail_cond[depthop]);
+        }
+    }
+
+    switch (cca_localselect) {
+        case CCA_LOCALSELECT_ITER_A:
+            arm64_clamp8(blk, REG_ALOCAL, REG_IA, 12);
+            break;
+        case CCA_LOCALSELECT_COLOR0:
+            arm64_ldrb(blk, REG_ALOCAL, REG_PARAMS, offsetof(voodoo_params_t, color0) + 3);
+            break;
+        case CCA_LOCALSELECT_ITER_Z:
+            arm64_clamp8(blk, REG_ALOCAL, REG_Z, 20);
+            break;
+        default:
+            break;
+    }
+    switch (a_sel) {
+        case A_SEL_ITER_A:
+            arm64_clamp8(blk, REG_AOTHER, REG_IA, 12);
+            break;
+        case A_SEL_COLOR1:
+            arm64_ldrb(blk, REG_AOTHER, REG_PARAMS, offsetof(voodoo_params_t, color1) + 3);
+            break;
+        default: /*TREX alpha is zero here*/
+            arm64_movz(blk, REG_AOTHER, 0, 0);
+            break;
+    }
+
+    voodoo_arm64_combine_rgb(blk, params, REG_SRC_R, REG_IR, 2);
+    voodoo_arm64_combine_rgb(blk, params, REG_SRC_G, REG_IG, 1);
+    voodoo_arm64_combine_rgb(blk, params, REG_SRC_B, REG_IB, 0);
+
+    if (cca_zero_other)
+        arm64_movz(blk, REG_SRC_A, 0, 0);
+    else
+        arm64_mov(blk, REG_SRC_A, REG_AOTHER);
+    if (cca_sub_clocal)
+        arm64_sub(blk, REG_SRC_A, REG_SRC_A, REG_ALOCAL);
+    switch (cca_mselect) {
+        case CCA_MSELECT_ALOCAL:
+        case CCA_MSELECT_ALOCAL2:
+            arm64_mov(blk, REG_T1, REG_ALOCAL);
+            break;
+        case CCA_MSELECT_AOTHER:
+            arm64_mov(blk, REG_T1, REG_AOTHER);
+            break;
+        default: /*Zero and texture alpha*/
+            arm64_movz(blk, REG_T1, 0, 0);
+            break;
+    }
+    if (!cca_reverse_blend)
+        arm64_eor_ff(blk, REG_T1, REG_T1);
+    arm64_add_imm(blk, REG_T1, REG_T1, 1);
+    arm64_mul(blk, REG_SRC_A, REG_SRC_A, REG_T1);
+    arm64_asr_imm(blk, REG_SRC_A, REG_SRC_A, 8);
+    if (cca_add)
+        arm64_add(blk, REG_SRC_A, REG_SRC_A, REG_ALOCAL);
+    arm64_clamp8(blk, REG_SRC_A, REG_SRC_A, 0);
+    if (cca_invert_output)
+        arm64_eor_ff(blk, REG_SRC_A, REG_SRC_A);
+
+    if (params->alphaMode & 1) {
+        if (alpha_func == AFUNC_NEVER)
+            skip_pos[skip_count++] = arm64_b(blk);
+        else if (alpha_func != AFUNC_ALWAYS) {
+            static const int fail_cond[8] = {
+                [AFUNC_LESSTHAN]         = COND_GE,
+                [AFUNC_EQUAL]            = COND_NE,
+                [AFUNC_LESSTHANEQUAL]    = COND_GT,
+                [AFUNC_GREATERTHAN]      = COND_LE,
+                [AFUNC_NOTEQUAL]         = COND_EQ,
+                [AFUNC_GREATERTHANEQUAL] = COND_LT
+            };
+
+            arm64_cmp_imm(blk, REG_SRC_A, a_ref);
+            skip_pos[skip_count++] = arm64_b_cond(blk, fail_cond[alpha_func]);
+        }
+    }
+
+    if (dither) {
+        int shift = dither2x2 ? 2 : 4;
+
+        arm64_and_mask(blk, REG_T0, REG_X, dither2x2 ? 1 : 2);
+        arm64_orr(blk, REG_T0, REG_T0, REG_DITHY, 0);
+        arm64_add_x_uxtw(blk, REG_T1, REG_DITH_RB, REG_SRC_R, shift);
+        arm64_ldrb_reg(blk, REG_SRC_R, REG_T1, REG_T0);
+        arm64_add_x_uxtw(blk, REG_T1, REG_DITH_G, REG_SRC_G, shift);
+        arm64_ldrb_reg(blk, REG_SRC_G, REG_T1, REG_T0);
+        arm64_add_x_uxtw(blk, REG_T1, REG_DITH_RB, REG_SRC_B, shift);
+        arm64_ldrb_reg(blk, REG_SRC_B, REG_T1, REG_T0);
+    } else {
+        arm64_lsr_imm(blk, REG_SRC_R, REG_SRC_R, 3);
+        arm64_lsr_imm(blk, REG_SRC_G, REG_SRC_G, 2);
+        arm64_lsr_imm(blk, REG_SRC_B, REG_SRC_B, 3);
+    }
+
+    if (params->fbzMode & FBZ_RGB_WMASK) {
+        arm64_orr(blk, REG_T0, REG_SRC_B, REG_SRC_G, 5);
+        arm64_orr(blk, REG_T0, REG_T0, REG_SRC_R, 11);
+        arm64_strh_x(blk, REG_T0, REG_FB);
+    }
+    if ((params->fbzMode & (FBZ_DEPTH_WMASK | FBZ_DEPTH_ENABLE)) == (FBZ_DEPTH_WMASK | FBZ_DEPTH_ENABLE))
+        arm64_strh_x(blk, REG_DEPTH, REG_AUX);
+
+    /*skip_pixel*/
+    for (int c = 0; c < skip_count; c++)
+        arm64_patch(blk, skip_pos[c], blk->pos);
+
+    arm64_ldr(blk, REG_T0, REG_PARAMS, offsetof(voodoo_params_t, dRdX));
+    arm64_ldr(blk, REG_T1, REG_PARAMS, offsetof(voodoo_params_t, dGdX));
+    arm64_ldr(blk, REG_T2, REG_PARAMS, offsetof(voodoo_params_t, dBdX));
+    arm64_ldr(blk, REG_T3, REG_PARAMS, offsetof(voodoo_params_t, dAdX));
+    if (state->xdir > 0) {
+        arm64_add(blk, REG_IR, REG_IR, REG_T0);
+        arm64_add(blk, REG_IG, REG_IG, REG_T1);
+        arm64_add(blk, REG_IB, REG_IB, REG_T2);
+        arm64_add(blk, REG_IA, REG_IA, REG_T3);
+    } else {
+        arm64_sub(blk, REG_IR, REG_IR, REG_T0);
+        arm64_sub(blk, REG_IG, REG_IG, REG_T1);
+        arm64_sub(blk, REG_IB, REG_IB, REG_T2);
+        arm64_sub(blk, REG_IA, REG_IA, REG_T3);
+    }
+    arm64_ldr(blk, REG_T0, REG_PARAMS, offsetof(voodoo_params_t, dZdX));
+    arm64_ldr_x(blk, REG_T1, REG_PARAMS, offsetof(voodoo_params_t, dWdX));
+    if (state->xdir > 0) {
+        arm64_add(blk, REG_Z, REG_Z, REG_T0);
+        arm64_add_x(blk, REG_W, REG_W, REG_T1);
+    } else {
+        arm64_sub(blk, REG_Z, REG_Z, REG_T0);
+        arm64_sub_x(blk, REG_W, REG_W, REG_T1);
+    }
+
+    arm64_cmp(blk, REG_X, REG_X2);
+    done_pos = arm64_b_cond(blk, COND_EQ);
+    if (state->xdir > 0)
+        arm64_add_imm(blk, REG_X, REG_X, 1);
+    else
+        arm64_sub_imm(blk, REG_X, REG_X, 1);
+    arm64_patch(blk, arm64_b(blk), loop_pos);
+    arm64_patch(blk, done_pos, blk->pos);
+
+    arm64_ldr(blk, REG_T0, REG_STATE, offsetof(voodoo_state_t, pixel_count));
+    arm64_add(blk, REG_T0, REG_T0, REG_COUNT);
+    arm64_str(blk, REG_T0, REG_STATE, offsetof(voodoo_state_t, pixel_count));
+
+    addinst(0xa8c173fb); /*LDP X27, X28, [SP], #16*/
+    addinst(0xa8c16bf9); /*LDP X25, X26, [SP], #16*/
+    addinst(0xa8c163f7); /*LDP X23, X24, [SP], #16*/
+    addinst(0xa8c15bf5); /*LDP X21, X22, [SP], #16*/
+    addinst(0xa8c153f3); /*LDP X19, X20, [SP], #16*/
+    arm64_movz(blk, 0, 0, 0);
+    addinst(0xd65f03c0); /*RET*/
+
+    return blk->pos;
+}
+
+/*Pipelines this generator can express. Everything else runs on the C path*/
+static inline int
+voodoo_arm64_supported(voodoo_t *voodoo, voodoo_params_t *params)
+{
+    if ((params->fbzColorPath & FBZCP_TEXTURE_ENABLED) || (voodoo->trexInit1[0] & (1 << 18)))
+        return 0;
+    if ((params->fogMode & FOG_ENABLE) || (params->alphaMode & (1 << 4)))
+        return 0;
+    if (params->col_tiled || params->aux_tiled || voodoo->params.col_tiled || voodoo->params.aux_tiled)
+        return 0;
+    /*Combinations the C path treats as fatal*/
+    if (cca_localselect > CCA_LOCALSELECT_ITER_Z || a_sel > A_SEL_COLOR1 || cc_mselect > CC_MSELECT_TEXRGB || cca_mselect > CCA_MSELECT_TEX || cc_add == 3)
+        return 0;
+
+    return 1;
+}
+
+int voodoo_recomp = 0;
+static inline void *
+voodoo_get_block(voodoo_t *voodoo, voodoo_params_t *params, voodoo_state_t *state, int thread)
+{
+    int                  b                 = last_block[thread];
+    voodoo_arm64_data_t *voodoo_arm64_data = voodoo->codegen_data;
+    voodoo_arm64_data_t *data;
+    int                  len;
+
+    if (!voodoo_arm64_supported(voodoo, params))
+        return NULL;
+
+    for (uint8_t c = 0; c < 8; c++) {
+        data = &voodoo_arm64_data[thread + b * VOODOO_MAX_RENDER_THREADS];
+
+        if (state->xdir == data->xdir && params->alphaMode == data->alphaMode && params->fbzMode == data->fbzMode && params->fogMode == data->fogMode && params->fbzColorPath == data->fbzColorPath && (voodoo->trexInit1[0] & (1 << 18)) == data->trexInit1 && params->textureMode[0] == data->textureMode[0] && params->textureMode[1] == data->textureMode[1] && (params->tLOD[0] & LOD_MASK) == data->tLOD[0] && (params->tLOD[1] & LOD_MASK) == data->tLOD[1] && ((params->col_tiled || params->aux_tiled) ? 1 : 0) == data->is_tiled) {
+            last_block[thread] = b;
+            return data->code_block;
+        }
+
+        b = (b + 1) & 7;
+    }
+    voodoo_recomp++;
+    data = &voodoo_arm64_data[thread + next_block_to_write[thread] * VOODOO_MAX_RENDER_THREADS];
+
+#if defined __APPLE__
+    if (__builtin_available(macOS 11.0, *))
+        pthread_jit_write_protect_np(0);
+#endif
+    len = voodoo_generate(data->code_block, voodoo, params, state, depth_op);
+#if defined __APPLE__
+    if (__builtin_available(macOS 11.0, *))
+        pthread_jit_write_protect_np(1);
+#endif
+#ifdef _MSC_VER
+    FlushInstructionCache(GetCurrentProcess(), data->code_block, len * 4);
+#else
+    __clear_cache((char *) data->code_block, (char *) &data->code_block[len]);
+#endif
+
+    data->xdir           = state->xdir;
+    data->alphaMode      = params->alphaMode;
+    data->fbzMode        = params->fbzMode;
+    data->fogMode        = params->fogMode;
+    data->fbzColorPath   = params->fbzColorPath;
+    data->trexInit1      = voodoo->trexInit1[0] & (1 << 18);
+    data->textureMode[0] = params->textureMode[0];
+    data->textureMode[1] = params->textureMode[1];
+    data->tLOD[0]        = params->tLOD[0] & LOD_MASK;
+    data->tLOD[1]        = params->tLOD[1] & LOD_MASK;
+    data->is_tiled       = (params->col_tiled || params->aux_tiled) ? 1 : 0;
+
+    next_block_to_write[thread] = (next_block_to_write[thread] + 1) & 7;
+
+    return data->code_block;
+}
+
+void
+voodoo_codegen_init(voodoo_t *voodoo)
+{
+    voodoo->codegen_data = plat_mmap(sizeof(voodoo_arm64_data_t) * BLOCK_NUM * VOODOO_MAX_RENDER_THREADS, 1);
+}
+
+void
+voodoo_codegen_close(voodoo_t *voodoo)
+{
+    plat_munmap(voodoo->codegen_data, sizeof(voodoo_arm64_data_t) * BLOCK_NUM * VOODOO_MAX_RENDER_THREADS);
+}
+
+#endif /*VIDEO_VOODOO_CODEGEN_ARM64_H*/
@@ -30,7 +30,8 @@
 
 #define TEX_DIRTY_SHIFT 10
 
-#define TEX_CACHE_MAX   64
+#define TEX_CACHE_DEFAULT 64
+#define TEX_HASH_SIZE     1024
 
 #ifdef __cplusplus
 #    include <atomic>
@@ -100,6 +101,14 @@ enum {
 #define PARAM_MASK       (PARAM_SIZE - 1)
 #define PARAM_ENTRY_SIZE (1 << 31)
 
+#define VOODOO_MAX_RENDER_THREADS 16
+
+/*The screen is split into VOODOO_RENDER_BANDS interleaved bands of
+  (1 << VOODOO_RENDER_BAND_SHIFT) lines. Each band has its own read index into
+  the shared parameter ring, and render threads claim whichever band has work*/
+#define VOODOO_RENDER_BANDS      64
+#define VOODOO_RENDER_BAND_SHIFT 2
+
 #define PARAM_ENTRIES(x) (voodoo->params_write_idx - voodoo->params_read_idx[x])
 #define PARAM_FULL(x)    ((voodoo->params_write_idx - voodoo->params_read_idx[x]) >= PARAM_SIZE)
 #define PARAM_EMPTY(x)   (voodoo->params_read_idx[x] == voodoo->params_write_idx)
@@ -234,12 +243,15 @@ typedef struct texture_t {
     uint32_t   base;
     uint32_t   tLOD;
     atomic_int refcount;
-    atomic_int refcount_r[4];
+    atomic_int refcount_r;
     int        is16;
     uint32_t   palette_checksum;
     uint32_t   addr_start[4];
     uint32_t   addr_end[4];
     uint32_t  *data;
+    uint32_t   tformat;
+    int        hash;
+    int        hash_next;
 } texture_t;
 
 typedef struct vert_t {
@@ -266,6 +278,11 @@ typedef struct clip_t {
     int y_max;
 } clip_t;
 
+typedef struct voodoo_render_worker_t {
+    struct voodoo_t *voodoo;
+    int              index;
+} voodoo_render_worker_t;
+
 typedef struct voodoo_t {
     mem_mapping_t mapping;
 
@@ -362,25 +379,27 @@ typedef struct voodoo_t {
     int    ncc_dirty[2];
 
     thread_t *fifo_thread;
-    thread_t *render_thread[4];
+    thread_t *render_thread[VOODOO_MAX_RENDER_THREADS];
     event_t  *wake_fifo_thread;
     event_t  *wake_main_thread;
     event_t  *fifo_not_full_event;
-    event_t  *render_not_full_event[4];
-    event_t  *wake_render_thread[4];
+    event_t  *render_not_full_event;
+    event_t  *wake_render_thread[VOODOO_MAX_RENDER_THREADS];
 
     int voodoo_busy;
-    int render_voodoo_busy[4];
+    int render_voodoo_busy[VOODOO_MAX_RENDER_THREADS];
 
     int render_threads;
-    int odd_even_mask;
+    int render_bands; /* 1 with a single render thread, else VOODOO_RENDER_BANDS */
 
-    int pixel_count[4];
-    int texel_count[4];
+    voodoo_render_worker_t render_worker[VOODOO_MAX_RENDER_THREADS];
+
+    int pixel_count[VOODOO_MAX_RENDER_THREADS];
+    int texel_count[VOODOO_MAX_RENDER_THREADS];
     int tri_count;
     int frame_count;
-    int pixel_count_old[4];
-    int texel_count_old[4];
+    int pixel_count_old[VOODOO_MAX_RENDER_THREADS];
+    int texel_count_old[VOODOO_MAX_RENDER_THREADS];
     int wr_count;
     int rd_count;
     int tex_count;
@@ -411,8 +430,10 @@ typedef struct voodoo_t {
     atomic_int   cmd_written_fifo_2;
 
     voodoo_params_t params_buffer[PARAM_SIZE];
-    atomic_int      params_read_idx[4];
+    atomic_int      params_read_idx[VOODOO_RENDER_BANDS];
     atomic_int      params_write_idx;
+    atomic_int      params_bands_left[PARAM_SIZE]; /* bands yet to pass each entry */
+    atomic_int      params_band_claimed[VOODOO_RENDER_BANDS];
 
     uint32_t   cmdfifo_base;
     uint32_t   cmdfifo_end;
@@ -658,15 +679,17 @@ typedef struct voodoo_t {
     uint8_t  thefilterb[256][256];
     uint16_t purpleline[256][3];
 
-    texture_t texture_cache[2][TEX_CACHE_MAX];
-    uint8_t   texture_present[2][16384];
-    int       texture_last_removed;
+    texture_t *texture_cache[2];
+    int        texture_cache_size; /* entries per TMU, power of 2 */
+    int        texture_hash[2][TEX_HASH_SIZE];
+    uint16_t   texture_present[2][16384]; /* cached textures using each page */
+    int        texture_last_removed;
 
     uint32_t palette_checksum[2];
     int      palette_dirty[2];
 
     uint64_t time;
-    int      render_time[4];
+    int      render_time[VOODOO_MAX_RENDER_THREADS];
 
     int      force_blit_count;
     int      can_blit;
@@ -675,10 +698,13 @@ typedef struct voodoo_t {
     int   use_recompiler;
     void *codegen_data;
 
+    struct voodoo_capture_t *capture;
+    struct voodoo_replay_t  *replay;
+
     struct voodoo_set_t *set;
 
     uint8_t fifo_thread_run;
-    uint8_t render_thread_run[4];
+    uint8_t render_thread_run[VOODOO_MAX_RENDER_THREADS];
 
     uint8_t *vram;
     uint8_t *changedvram;
@@ -219,6 +219,8 @@ extern int    readflash;
 extern int    ibm8514_active;
 extern int    xga_active;
 
+extern char voodoo_replay_path[1024];
+
 /* Function handler pointers. */
 extern void (*video_recalctimings)(void);
 extern void video_screenshot_monitor(uint32_t *buf, int start_x, int start_y, int row_len, int monitor_index);
@@ -255,6 +257,9 @@ extern void video_blit_memtoscreen_8(int x, int y, int w, int h);
 extern void video_blend_monitor(int x, int y, int monitor_index);
 extern void video_process_8_monitor(int x, int y, int monitor_index);
 extern void video_blit_memtoscreen_monitor(int x, int y, int w, int h, int monitor_index);
+extern void video_blit_memtoscreen_dirty_monitor(int x, int y, int w, int h, const uint8_t *dirty, int monitor_index);
+extern int  video_blit_copy_monitor(uint8_t *dst, int pitch, uint32_t *seq, int *first, int *last, int monitor_index);
+extern int  video_blit_lines_monitor(void (*func)(int line, const uint32_t *src, int w, void *priv), void *priv, uint32_t *seq, int monitor_index);
 extern void video_blit_complete_monitor(int monitor_index);
 extern void video_wait_for_blit_monitor(int monitor_index);
 extern void video_wait_for_buffer_monitor(int monitor_index);
@@ -31,6 +31,7 @@
 #include "x86.h"
 #include <86box/m_amstrad.h>
 #include <86box/pci.h>
+#include <86box/perf.h>
 
 #define NPORTS 65536 /* PC/AT supports 64K ports */
 
@@ -48,6 +49,43 @@ typedef struct _io_ {
     struct _io_ *prev, *next;
 } io_t;
 
+/* Flattened copy of one io_t, used by the dispatch table. */
+typedef struct {
+    uint8_t (*inb)(uint16_t addr, void *priv);
+    uint16_t (*inw)(uint16_t addr, void *priv);
+    uint32_t (*inl)(uint16_t addr, void *priv);
+
+    void (*outb)(uint16_t addr, uint8_t val, void *priv);
+    void (*outw)(uint16_t addr, uint16_t val, void *priv);
+    void (*outl)(uint16_t addr, uint32_t val, void *priv);
+
+    void *priv;
+} io_handler_t;
+
+/* Which kinds of handlers are present on a port, so the accessors can skip
+   the passes (native, word split, byte split) that have nothing to call. */
+#define IO_HAS_INB     0x0001
+#define IO_HAS_INB_W   0x0002 /* inb && !inw */
+#define IO_HAS_INB_L   0x0004 /* inb && !inw && !inl */
+#define IO_HAS_INW     0x0008
+#define IO_HAS_INW_L   0x0010 /* inw && !inl */
+#define IO_HAS_INL     0x0020
+#define IO_HAS_OUTB    0x0040
+#define IO_HAS_OUTB_W  0x0080 /* outb && !outw */
+#define IO_HAS_OUTB_L  0x0100 /* outb && !outw && !outl */
+#define IO_HAS_OUTW    0x0200
+#define IO_HAS_OUTW_L  0x0400 /* outw && !outl */
+#define IO_HAS_OUTL    0x0800
+
+/* Per-port dispatch entry, rebuilt from the io_t chain whenever the handlers
+   on the port change. The handlers are stored contiguously, in the same order
+   as the chain. */
+typedef struct {
+    uint16_t      count;
+    uint16_t      flags;
+    io_handler_t *handlers;
+} io_port_t;
+
 typedef struct {
     uint8_t   enable;
     uint16_t  base;
@@ -60,6 +98,16 @@ int   initialized = 0;
 io_t *io[NPORTS];
 io_t *io_last[NPORTS];
 
+static io_port_t io_ports[NPORTS];
+
+/* Handler arrays replaced while a handler is running (for example a device
+   remapping itself from its own I/O callback) are only freed once the
+   outermost I/O access has completed, as the caller still iterates them. */
+static int            io_dispatch_depth   = 0;
+static io_handler_t **io_free_pending     = NULL;
+static int            io_free_pending_num = 0;
+static int            io_free_pending_max = 0;
+
 #ifdef ENABLE_IO_LOG
 int io_do_log = ENABLE_IO_LOG;
 
@@ -78,6 +126,110 @@ io_log(const char *fmt, ...)
 #    define io_log(fmt, ...)
 #endif
 
+static void
+io_free_handlers(io_handler_t *handlers)
+{
+    if (handlers == NULL)
+        return;
+
+    if (io_dispatch_depth == 0) {
+        free(handlers);
+        return;
+    }
+
+    if (io_free_pending_num == io_free_pending_max) {
+        io_free_pending_max = io_free_pending_max ? (io_free_pending_max << 1) : 16;
+        io_free_pending     = (io_handler_t **) realloc(io_free_pending,
+                                                        io_free_pending_max * sizeof(io_handler_t *));
+    }
+
+    io_free_pending[io_free_pending_num++] = handlers;
+}
+
+static __inline void
+io_dispatch_enter(void)
+{
+    io_dispatch_depth++;
+}
+
+static __inline void
+io_dispatch_leave(void)
+{
+    if ((--io_dispatch_depth == 0) && io_free_pending_num) {
+        for (int i = 0; i < io_free_pending_num; i++)
+            free(io_free_pending[i]);
+        io_free_pending_num = 0;
+    }
+}
+
+/* Regenerate the dispatch entry of a port from its io_t chain. */
+static void
+io_port_rebuild(uint16_t port)
+{
+    io_port_t    *dp       = &io_ports[port];
+    io_handler_t *handlers = NULL;
+    io_handler_t *h;
+    io_t         *p;
+    uint16_t      count    = 0;
+    uint16_t      flags    = 0;
+
+    for (p = io[port]; p != NULL; p = p->next)
+        count++;
+
+    if (count) {
+        handlers = (io_handler_t *) malloc(count * sizeof(io_handler_t));
+        h        = handlers;
+
+        for (p = io[port]; p != NULL; p = p->next, h++) {
+            h->inb  = p->inb;
+            h->inw  = p->inw;
+            h->inl  = p->inl;
+            h->outb = p->outb;
+            h->outw = p->outw;
+            h->outl = p->outl;
+            h->priv = p->priv;
+
+            if (p->inb) {
+                flags |= IO_HAS_INB;
+                if (!p->inw) {
+                    flags |= IO_HAS_INB_W;
+                    if (!p->inl)
+                        flags |= IO_HAS_INB_L;
+                }
+            }
+            if (p->inw) {
+                flags |= IO_HAS_INW;
+                if (!p->inl)
+                    flags |= IO_HAS_INW_L;
+            }
+            if (p->inl)
+                flags |= IO_HAS_INL;
+
+            if (p->outb) {
+                flags |= IO_HAS_OUTB;
+                if (!p->outw) {
+                    flags |= IO_HAS_OUTB_W;
+                    if (!p->outl)
+                        flags |= IO_HAS_OUTB_L;
+                }
+            }
+            if (p->outw) {
+                flags |= IO_HAS_OUTW;
+                if (!p->outl)
+                    flags |= IO_HAS_OUTW_L;
+            }
+            if (p->outl)
+                flags |= IO_HAS_OUTL;
+        }
+    }
+
+    io_free_handlers(dp->handlers);
+
+    dp->handlers = handlers;
+    dp->count    = count;
+    dp->flags    = flags;
+}
+
 void
 io_init(void)
 {
@@ -106,6 +258,9 @@ io_init(void)
 
         /* io[c] should be NULL. */
         io[c] = io_last[c] = NULL;
+
+        if (io_ports[c].count)
+            io_port_rebuild(c);
     }
 }
 
@@ -147,6 +302,8 @@ io_sethandler_common(uint16_t base, int size,
 
         io_last[base + c] = q;
 
+        io_port_rebuild(base + c);
+
         q = NULL;
     }
 }
@@ -181,6 +338,7 @@ io_removehandler_common(uint16_t base, int size,
                     io_last[base + c] = p->prev;
                 free(p);
                 p = NULL;
+                io_port_rebuild(base + c);
                 break;
             }
             p = q;
@@ -337,15 +495,16 @@ io_debug_check_addr(uint16_t addr)
 uint8_t
 inb(uint16_t port)
 {
-    uint8_t ret = 0xff;
-    io_t   *p;
-    io_t   *q;
-    int     found  = 0;
+    uint8_t             ret = 0xff;
+    const io_port_t    *dp;
+    const io_handler_t *h;
+    int                 found  = 0;
 #ifdef ENABLE_IO_LOG
-    int     qfound = 0;
+    int                 qfound = 0;
 #endif
 
     io_port = port;
+    perf_counters.io_reads++;
 
 #ifdef USE_DEBUG_REGS_486
     io_debug_check_addr(port);
@@ -364,17 +523,30 @@ inb(uint16_t port)
         qfound = 1;
 #endif
     } else {
-        p = io[port];
-        while (p) {
-            q = p->next;
-            if (p->inb) {
-                ret &= p->inb(port, p->priv);
-                found |= 1;
+        dp = &io_ports[port];
+        if (dp->flags & IO_HAS_INB) {
+            io_dispatch_enter();
+            if (dp->count == 1) {
+                /* Single handler fast path. */
+                h   = dp->handlers;
+                ret = h->inb(port, h->priv);
+                found = 1;
+#ifdef ENABLE_IO_LOG
+                qfound = 1;
+#endif
+            } else {
+                h = dp->handlers;
+                for (int c = dp->count; c > 0; c--, h++) {
+                    if (h->inb) {
+                        ret &= h->inb(port, h->priv);
+                        found |= 1;
 #ifdef ENABLE_IO_LOG
-                qfound++;
+                        qfound++;
 #endif
+                    }
+                }
             }
-            p = q;
+            io_dispatch_leave();
         }
     }
 
@@ -404,15 +576,16 @@ inb(uint16_t port)
 void
 outb(uint16_t port, uint8_t val)
 {
-    io_t *p;
-    io_t *q;
-    int   found  = 0;
+    const io_port_t    *dp;
+    const io_handler_t *h;
+    int                 found  = 0;
 #ifdef ENABLE_IO_LOG
-    int   qfound = 0;
+    int                 qfound = 0;
 #endif
 
     io_port = port;
     io_val  = val;
+    perf_counters.io_writes++;
 
 #ifdef USE_DEBUG_REGS_486
     io_debug_check_addr(port);
@@ -431,17 +604,30 @@ outb(uint16_t port, uint8_t val)
         qfound = 1;
 #endif
     } else {
-        p = io[port];
-        while (p) {
-            q = p->next;
-            if (p->outb) {
-                p->outb(port, val, p->priv);
-                found |= 1;
+        dp = &io_ports[port];
+        if (dp->flags & IO_HAS_OUTB) {
+            io_dispatch_enter();
+            if (dp->count == 1) {
+                /* Single handler fast path. */
+                h = dp->handlers;
+                h->outb(port, val, h->priv);
+                found = 1;
+#ifdef ENABLE_IO_LOG
+                qfound = 1;
+#endif
+            } else {
+                h = dp->handlers;
+                for (int c = dp->count; c > 0; c--, h++) {
+                    if (h->outb) {
+                        h->outb(port, val, h->priv);
+                        found |= 1;
 #ifdef ENABLE_IO_LOG
-                qfound++;
+                        qfound++;
 #endif
+                    }
+                }
             }
-            p = q;
+            io_dispatch_leave();
         }
     }
 
@@ -461,16 +647,17 @@ outb(uint16_t port, uint8_t val)
 uint16_t
 inw(uint16_t port)
 {
-    io_t    *p;
-    io_t    *q;
-    uint16_t ret    = 0xffff;
-    int      found  = 0;
+    const io_port_t    *dp;
+    const io_handler_t *h;
+    uint16_t            ret    = 0xffff;
+    int                 found  = 0;
 #ifdef ENABLE_IO_LOG
-    int      qfound = 0;
+    int                 qfound = 0;
 #endif
-    uint8_t  ret8[2];
+    uint8_t             ret8[2];
 
     io_port = port;
+    perf_counters.io_reads++;
 
 #ifdef USE_DEBUG_REGS_486
     io_debug_check_addr(port);
@@ -489,36 +676,42 @@ inw(uint16_t port)
         qfound = 1;
 #endif
     } else {
-        p = io[port];
-        while (p) {
-            q = p->next;
-            if (p->inw) {
-                ret &= p->inw(port, p->priv);
-                found |= 2;
+        io_dispatch_enter();
+
+        dp = &io_ports[port];
+        if (dp->flags & IO_HAS_INW) {
+            h = dp->handlers;
+            for (int c = dp->count; c > 0; c--, h++) {
+                if (h->inw) {
+                    ret &= h->inw(port, h->priv);
+                    found |= 2;
 #ifdef ENABLE_IO_LOG
-                qfound++;
+                    qfound++;
 #endif
+                }
             }
-            p = q;
         }
 
         ret8[0] = ret & 0xff;
         ret8[1] = (ret >> 8) & 0xff;
         for (uint8_t i = 0; i < 2; i++) {
-            p = io[(port + i) & 0xffff];
-            while (p) {
-                q = p->next;
-                if (p->inb && !p->inw) {
-                    ret8[i] &= p->inb(port + i, p->priv);
+            dp = &io_ports[(port + i) & 0xffff];
+            if (!(dp->flags & IO_HAS_INB_W))
+                continue;
+            h = dp->handlers;
+            for (int c = dp->count; c > 0; c--, h++) {
+                if (h->inb && !h->inw) {
+                    ret8[i] &= h->inb(port + i, h->priv);
                     found |= 1;
 #ifdef ENABLE_IO_LOG
                     qfound++;
 #endif
                 }
-                p = q;
             }
         }
         ret = (ret8[1] << 8) | ret8[0];
+
+        io_dispatch_leave();
     }
 
     if (amstrad_latch & 0x80000000) {
@@ -541,15 +734,16 @@ inw(uint16_t port)
 void
 outw(uint16_t port, uint16_t val)
 {
-    io_t *p;
-    io_t *q;
-    int   found  = 0;
+    const io_port_t    *dp;
+    const io_handler_t *h;
+    int                 found  = 0;
 #ifdef ENABLE_IO_LOG
-    int   qfound = 0;
+    int                 qfound = 0;
 #endif
 
     io_port = port;
     io_val  = val;
+    perf_counters.io_writes++;
 
 #ifdef USE_DEBUG_REGS_486
     io_debug_check_addr(port);
@@ -568,33 +762,39 @@ outw(uint16_t port, uint16_t val)
         qfound = 1;
 #endif
     } else {
-        p = io[port];
-        while (p) {
-            q = p->next;
-            if (p->outw) {
-                p->outw(port, val, p->priv);
-                found |= 2;
+        io_dispatch_enter();
+
+        dp = &io_ports[port];
+        if (dp->flags & IO_HAS_OUTW) {
+            h = dp->handlers;
+            for (int c = dp->count; c > 0; c--, h++) {
+                if (h->outw) {
+                    h->outw(port, val, h->priv);
+                    found |= 2;
 #ifdef ENABLE_IO_LOG
-                qfound++;
+                    qfound++;
 #endif
+                }
             }
-            p = q;
         }
 
         for (uint8_t i = 0; i < 2; i++) {
-            p = io[(port + i) & 0xffff];
-            while (p) {
-                q = p->next;
-                if (p->outb && !p->outw) {
-                    p->outb(port + i, val >> (i << 3), p->priv);
+            dp = &io_ports[(port + i) & 0xffff];
+            if (!(dp->flags & IO_HAS_OUTB_W))
+                continue;
+            h = dp->handlers;
+            for (int c = dp->count; c > 0; c--, h++) {
+                if (h->outb && !h->outw) {
+                    h->outb(port + i, val >> (i << 3), h->priv);
                     found |= 1;
 #ifdef ENABLE_IO_LOG
                     qfound++;
 #endif
                 }
-                p = q;
             }
         }
+
+        io_dispatch_leave();
     }
 
     if (!found) {
@@ -613,17 +813,18 @@ outw(uint16_t port, uint16_t val)
 uint32_t
 inl(uint16_t port)
 {
-    io_t    *p;
-    io_t    *q;
-    uint32_t ret = 0xffffffff;
-    uint16_t ret16[2];
-    uint8_t  ret8[4];
-    int      found  = 0;
+    const io_port_t    *dp;
+    const io_handler_t *h;
+    uint32_t            ret = 0xffffffff;
+    uint16_t            ret16[2];
+    uint8_t             ret8[4];
+    int                 found  = 0;
 #ifdef ENABLE_IO_LOG
-    int      qfound = 0;
+    int                 qfound = 0;
 #endif
 
     io_port = port;
+    perf_counters.io_reads++;
 
 #ifdef USE_DEBUG_REGS_486
     io_debug_check_addr(port);
@@ -642,45 +843,38 @@ inl(uint16_t port)
         qfound = 1;
 #endif
     } else {
-        p = io[port];
-        while (p) {
-            q = p->next;
-            if (p->inl) {
-                ret &= p->inl(port, p->priv);
-                found |= 4;
+        io_dispatch_enter();
+
+        dp = &io_ports[port];
+        if (dp->flags & IO_HAS_INL) {
+            h = dp->handlers;
+            for (int c = dp->count; c > 0; c--, h++) {
+                if (h->inl) {
+                    ret &= h->inl(port, h->priv);
+                    found |= 4;
 #ifdef ENABLE_IO_LOG
-                qfound++;
+                    qfound++;
 #endif
+                }
             }
-            p = q;
         }
 
         ret16[0] = ret & 0xffff;
         ret16[1] = (ret >> 16) & 0xffff;
-        p        = io[port & 0xffff];
-        while (p) {
-            q = p->next;
-            if (p->inw && !p->inl) {
-                ret16[0] &= p->inw(port, p->priv);
-                found |= 2;
-#ifdef ENABLE_IO_LOG
-                qfound++;
-#endif
-            }
-            p = q;
-        }
-
-        p = io[(port + 2) & 0xffff];
-        while (p) {
-            q = p->next;
-            if (p->inw && !p->inl) {
-                ret16[1] &= p->inw(port + 2, p->priv);
-                found |= 2;
+        for (uint8_t i = 0; i < 2; i++) {
+            dp = &io_ports[(port + (i << 1)) & 0xffff];
+            if (!(dp->flags & IO_HAS_INW_L))
+                continue;
+            h = dp->handlers;
+            for (int c = dp->count; c > 0; c--, h++) {
+                if (h->inw && !h->inl) {
+                    ret16[i] &= h->inw(port + (i << 1), h->priv);
+                    found |= 2;
 #ifdef ENABLE_IO_LOG
-                qfound++;
+                    qfound++;
 #endif
+                }
             }
-            p = q;
         }
         ret = (ret16[1] << 16) | ret16[0];
 
@@ -689,20 +883,23 @@ inl(uint16_t port)
         ret8[2] = (ret >> 16) & 0xff;
         ret8[3] = (ret >> 24) & 0xff;
         for (uint8_t i = 0; i < 4; i++) {
-            p = io[(port + i) & 0xffff];
-            while (p) {
-                q = p->next;
-                if (p->inb && !p->inw && !p->inl) {
-                    ret8[i] &= p->inb(port + i, p->priv);
+            dp = &io_ports[(port + i) & 0xffff];
+            if (!(dp->flags & IO_HAS_INB_L))
+                continue;
+            h = dp->handlers;
+            for (int c = dp->count; c > 0; c--, h++) {
+                if (h->inb && !h->inw && !h->inl) {
+                    ret8[i] &= h->inb(port + i, h->priv);
                     found |= 1;
 #ifdef ENABLE_IO_LOG
                     qfound++;
 #endif
                 }
-                p = q;
             }
         }
         ret = (ret8[3] << 24) | (ret8[2] << 16) | (ret8[1] << 8) | ret8[0];
+
+        io_dispatch_leave();
     }
 
     if (amstrad_latch & 0x80000000) {
@@ -725,16 +922,17 @@ inl(uint16_t port)
 void
 outl(uint16_t port, uint32_t val)
 {
-    io_t *p;
-    io_t *q;
-    int   found  = 0;
+    const io_port_t    *dp;
+    const io_handler_t *h;
+    int                 found  = 0;
 #ifdef ENABLE_IO_LOG
-    int   qfound = 0;
+    int                 qfound = 0;
 #endif
-    int   i      = 0;
+    int                 i      = 0;
 
     io_port = port;
     io_val  = val;
+    perf_counters.io_writes++;
 
 #ifdef USE_DEBUG_REGS_486
     io_debug_check_addr(port);
@@ -753,50 +951,55 @@ outl(uint16_t port, uint32_t val)
         qfound = 1;
 #endif
     } else {
-        p = io[port];
-        if (p) {
-            while (p) {
-                q = p->next;
-                if (p->outl) {
-                    p->outl(port, val, p->priv);
+        io_dispatch_enter();
+
+        dp = &io_ports[port];
+        if (dp->flags & IO_HAS_OUTL) {
+            h = dp->handlers;
+            for (int c = dp->count; c > 0; c--, h++) {
+                if (h->outl) {
+                    h->outl(port, val, h->priv);
                     found |= 4;
 #ifdef ENABLE_IO_LOG
                     qfound++;
 #endif
                 }
-                p = q;
             }
         }
 
         for (i = 0; i < 4; i += 2) {
-            p = io[(port + i) & 0xffff];
-            while (p) {
-                q = p->next;
-                if (p->outw && !p->outl) {
-                    p->outw(port + i, val >> (i << 3), p->priv);
+            dp = &io_ports[(port + i) & 0xffff];
+            if (!(dp->flags & IO_HAS_OUTW_L))
+                continue;
+            h = dp->handlers;
+            for (int c = dp->count; c > 0; c--, h++) {
+                if (h->outw && !h->outl) {
+                    h->outw(port + i, val >> (i << 3), h->priv);
                     found |= 2;
 #ifdef ENABLE_IO_LOG
                     qfound++;
 #endif
                 }
-                p = q;
             }
         }
 
         for (i = 0; i < 4; i++) {
-            p = io[(port + i) & 0xffff];
-            while (p) {
-                q = p->next;
-                if (p->outb && !p->outw && !p->outl) {
-                    p->outb(port + i, val >> (i << 3), p->priv);
+            dp = &io_ports[(port + i) & 0xffff];
+            if (!(dp->flags & IO_HAS_OUTB_L))
+                continue;
+            h = dp->handlers;
+            for (int c = dp->count; c > 0; c--, h++) {
+                if (h->outb && !h->outw && !h->outl) {
+                    h->outb(port + i, val >> (i << 3), h->priv);
                     found |= 1;
 #ifdef ENABLE_IO_LOG
                     qfound++;
 #endif
                 }
-                p = q;
             }
         }
+
+        io_dispatch_leave();
     }
 
     if (!found) {
@@ -37,6 +37,9 @@
 #include <86box/mem.h>
 #include <86box/plat.h>
 #include <86box/rom.h>
+#include <86box/timer.h>
+#include <86box/snapshot.h>
+#include <86box/perf.h>
 #include <86box/gdbstub.h>
 #ifdef USE_DYNAREC
 #    include "codegen_public.h"
@@ -270,6 +273,10 @@ flushmmucache_nopc(void)
             writelookup[c]               = 0xffffffff;
         }
     }
+
+#ifdef USE_DYNAREC
+    codegen_flush();
+#endif
 }
 
 void
@@ -308,6 +315,13 @@ mem_flush_write_page(uint32_t addr, uint32_t virt)
 #define rammap(x)                ((uint32_t *) (_mem_exec[(x) >> MEM_GRANULARITY_BITS]))[((x) >> 2) & MEM_GRANULARITY_QMASK]
 #define rammap64(x)              ((uint64_t *) (_mem_exec[(x) >> MEM_GRANULARITY_BITS]))[((x) >> 3) & MEM_GRANULARITY_PMASK]
 
+/* Accesses that end up in a mapping without a RAM backing are MMIO. */
+#define mem_count_mmio(map, counter)   \
+    do {                               \
+        if ((map) && !(map)->exec)     \
+            perf_counters.counter++;   \
+    } while (0)
+
 static __inline uint64_t
 mmutranslatereal_normal(uint32_t addr, int rw)
 {
@@ -743,6 +757,7 @@ read_mem_b(uint32_t addr)
     addr &= rammask;
 
     map = read_mapping[addr >> MEM_GRANULARITY_BITS];
+    mem_count_mmio(map, mmio_reads);
     if (map && map->read_b)
         ret = map->read_b(addr, map->priv);
 
@@ -765,6 +780,7 @@ read_mem_w(uint32_t addr)
         ret = read_mem_b(addr) | (read_mem_b(addr + 1) << 8);
     else {
         map = read_mapping[addr >> MEM_GRANULARITY_BITS];
+        mem_count_mmio(map, mmio_reads);
 
         if (map && map->read_w)
             ret = map->read_w(addr, map->priv);
@@ -787,6 +803,7 @@ write_mem_b(uint32_t addr, uint8_t val)
     addr &= rammask;
 
     map = write_mapping[addr >> MEM_GRANULARITY_BITS];
+    mem_count_mmio(map, mmio_writes);
     if (map && map->write_b)
         map->write_b(addr, val, map->priv);
 
@@ -807,6 +824,7 @@ write_mem_w(uint32_t addr, uint16_t val)
         write_mem_b(addr + 1, val >> 8);
     } else {
         map = write_mapping[addr >> MEM_GRANULARITY_BITS];
+        mem_count_mmio(map, mmio_writes);
         if (map) {
             if (map->write_w)
                 map->write_w(addr, val, map->priv);
@@ -846,6 +864,7 @@ readmembl(uint32_t addr)
     addr = (uint32_t) (addr64 & rammask);
 
     map = read_mapping[addr >> MEM_GRANULARITY_BITS];
+    mem_count_mmio(map, mmio_reads);
     if (map && map->read_b)
         return map->read_b(addr, map->priv);
 
@@ -883,6 +902,7 @@ writemembl(uint32_t addr, uint8_t val)
     addr = (uint32_t) (addr64 & rammask);
 
     map = write_mapping[addr >> MEM_GRANULARITY_BITS];
+    mem_count_mmio(map, mmio_writes);
     if (map && map->write_b)
         map->write_b(addr, val, map->priv);
 }
@@ -906,6 +926,7 @@ readmembl_no_mmut(uint32_t addr, uint32_t a64)
         addr &= rammask;
 
     map = read_mapping[addr >> MEM_GRANULARITY_BITS];
+    mem_count_mmio(map, mmio_reads);
     if (map && map->read_b)
         return map->read_b(addr, map->priv);
 
@@ -936,6 +957,7 @@ writemembl_no_mmut(uint32_t addr, uint32_t a64, uint8_t val)
         addr &= rammask;
 
     map = write_mapping[addr >> MEM_GRANULARITY_BITS];
+    mem_count_mmio(map, mmio_writes);
     if (map && map->write_b)
         map->write_b(addr, val, map->priv);
 }
@@ -991,6 +1013,7 @@ readmemwl(uint32_t addr)
     addr = addr64a[0] & rammask;
 
     map = read_mapping[addr >> MEM_GRANULARITY_BITS];
+    mem_count_mmio(map, mmio_reads);
 
     if (map && map->read_w)
         return map->read_w(addr, map->priv);
@@ -1067,6 +1090,7 @@ writememwl(uint32_t addr, uint16_t val)
     addr = addr64a[0] & rammask;
 
     map = write_mapping[addr >> MEM_GRANULARITY_BITS];
+    mem_count_mmio(map, mmio_writes);
 
     if (map && map->write_w) {
         map->write_w(addr, val, map->priv);
@@ -1115,6 +1139,7 @@ readmemwl_no_mmut(uint32_t addr, uint32_t *a64)
         addr &= rammask;
 
     map = read_mapping[addr >> MEM_GRANULARITY_BITS];
+    mem_count_mmio(map, mmio_reads);
 
     if (map && map->read_w)
         return map->read_w(addr, map->priv);
@@ -1170,6 +1195,7 @@ writememwl_no_mmut(uint32_t addr, uint32_t *a64, uint16_t val)
         addr &= rammask;
 
     map = write_mapping[addr >> MEM_GRANULARITY_BITS];
+    mem_count_mmio(map, mmio_writes);
 
     if (map && map->write_w) {
         map->write_w(addr, val, map->priv);
@@ -1248,6 +1274,7 @@ readmemll(uint32_t addr)
     addr = addr64a[0] & rammask;
 
     map = read_mapping[addr >> MEM_GRANULARITY_BITS];
+    mem_count_mmio(map, mmio_reads);
 
     if (map && map->read_l)
         return map->read_l(addr, map->priv);
@@ -1339,6 +1366,7 @@ writememll(uint32_t addr, uint32_t val)
     addr = addr64a[0] & rammask;
 
     map = write_mapping[addr >> MEM_GRANULARITY_BITS];
+    mem_count_mmio(map, mmio_writes);
 
     if (map && map->write_l) {
         map->write_l(addr, val, map->priv);
@@ -1393,6 +1421,7 @@ readmemll_no_mmut(uint32_t addr, uint32_t *a64)
         addr &= rammask;
 
     map = read_mapping[addr >> MEM_GRANULARITY_BITS];
+    mem_count_mmio(map, mmio_reads);
 
     if (map && map->read_l)
         return map->read_l(addr, map->priv);
@@ -1450,6 +1479,7 @@ writememll_no_mmut(uint32_t addr, uint32_t *a64, uint32_t val)
         addr &= rammask;
 
     map = write_mapping[addr >> MEM_GRANULARITY_BITS];
+    mem_count_mmio(map, mmio_writes);
 
     if (map && map->write_l) {
         map->write_l(addr, val, map->priv);
@@ -1533,6 +1563,7 @@ readmemql(uint32_t addr)
     addr = addr64a[0] & rammask;
 
     map = read_mapping[addr >> MEM_GRANULARITY_BITS];
+    mem_count_mmio(map, mmio_reads);
 
     if (map && map->read_l)
         return map->read_l(addr, map->priv) |
@@ -1633,6 +1664,7 @@ writememql(uint32_t addr, uint64_t val)
     addr = addr64a[0] & rammask;
 
     map = write_mapping[addr >> MEM_GRANULARITY_BITS];
+    mem_count_mmio(map, mmio_writes);
 
     if (map && map->write_l) {
         map->write_l(addr, val, map->priv);
@@ -2830,13 +2862,13 @@ mem_reset(void)
     }
 
     if (ram != NULL) {
-        plat_munmap(ram, ram_size);
+        plat_munmap_ram(ram, ram_size);
         ram      = NULL;
         ram_size = 0;
     }
 #if (!(defined __amd64__ || defined _M_X64 || defined __aarch64__ || defined _M_ARM64))
     if (ram2 != NULL) {
-        plat_munmap(ram2, ram2_size);
+        plat_munmap_ram(ram2, ram2_size);
         ram2      = NULL;
         ram2_size = 0;
     }
@@ -2847,18 +2879,25 @@ mem_reset(void)
 
     m = 1024UL * (size_t) mem_size;
 
+    /*
+     * RAM comes from plat_mmap_ram(), which hands out zero-filled
+     * memory aligned for (and hinted to use) huge pages, so there is
+     * no need to clear it here; doing so would only fault in every
+     * page of a large guest up front. If a memory file is configured,
+     * the (single) RAM block is a shared mapping of that file, which
+     * external tools can map to inspect or dump the guest's memory.
+     */
 #if (!(defined __amd64__ || defined _M_X64 || defined __aarch64__ || defined _M_ARM64))
     if (mem_size > 1048576) {
         ram_size = 1 << 30;
-        ram      = (uint8_t *) plat_mmap(ram_size, 0); /* allocate and clear the RAM block of the first 1 GB */
+        ram      = (uint8_t *) plat_mmap_ram(ram_size, NULL); /* allocate the RAM block of the first 1 GB */
         if (ram == NULL) {
             fatal("Failed to allocate primary RAM block. Make sure you have enough RAM available.\n");
             return;
         }
-        memset(ram, 0x00, ram_size);
         ram2_size = m - (1 << 30);
         /* Allocate 16 extra bytes of RAM to mitigate some dynarec recompiler memory access quirks. */
-        ram2      = (uint8_t *) plat_mmap(ram2_size + 16, 0); /* allocate and clear the RAM block above 1 GB */
+        ram2      = (uint8_t *) plat_mmap_ram(ram2_size + 16, NULL); /* allocate the RAM block above 1 GB */
         if (ram2 == NULL) {
             if (config_changed == 2)
                 fatal(EMU_NAME " must be restarted for the memory amount change to be applied.\n");
@@ -2866,18 +2905,19 @@ mem_reset(void)
                 fatal("Failed to allocate secondary RAM block. Make sure you have enough RAM available.\n");
             return;
         }
-        memset(ram2, 0x00, ram2_size + 16);
     } else
 #endif
     {
         ram_size = m;
         /* Allocate 16 extra bytes of RAM to mitigate some dynarec recompiler memory access quirks. */
-        ram      = (uint8_t *) plat_mmap(ram_size + 16, 0); /* allocate and clear the RAM block */
+        ram      = (uint8_t *) plat_mmap_ram(ram_size + 16, mem_file); /* allocate the RAM block */
         if (ram == NULL) {
-            fatal("Failed to allocate RAM block. Make sure you have enough RAM available.\n");
+            if (mem_file[0] != 0x00)
+                fatal("Failed to map RAM block to \"%s\". Make sure the file can be created and there is enough space for it.\n", mem_file);
+            else
+                fatal("Failed to allocate RAM block. Make sure you have enough RAM available.\n");
             return;
         }
-        memset(ram, 0x00, ram_size + 16);
 #if (!(defined __amd64__ || defined _M_X64 || defined __aarch64__ || defined _M_ARM64))
         if (mem_size > 1048576)
             ram2 = &(ram[1 << 30]);
@@ -3026,18 +3066,33 @@ mem_reset(void)
 void
 mem_init(void)
 {
+    uint8_t *lookup;
+
     /* Perform a one-time init. */
     ram = rom = NULL;
     ram2      = NULL;
     pages     = NULL;
 
-    /* Allocate the lookup tables. */
-    page_lookup  = (page_t **) malloc((1 << 20) * sizeof(page_t *));
-    page_lookupp = (uint8_t *) malloc((1 << 20) * sizeof(uint8_t));
-    readlookup2  = malloc((1 << 20) * sizeof(uintptr_t));
-    readlookupp  = malloc((1 << 20) * sizeof(uint8_t));
-    writelookup2 = malloc((1 << 20) * sizeof(uintptr_t));
-    writelookupp = malloc((1 << 20) * sizeof(uint8_t));
+    /*
+     * Allocate the lookup tables. They are hit on every TLB miss,
+     * so they share one huge page backed block rather than being
+     * scattered over the heap.
+     */
+    lookup = (uint8_t *) plat_mmap_ram((1 << 20) * (sizeof(page_t *) + (2 * sizeof(uintptr_t)) + (3 * sizeof(uint8_t))), NULL);
+    if (lookup == NULL)
+        fatal("Failed to allocate the memory lookup tables.\n");
+
+    page_lookup  = (page_t **) lookup;
+    lookup += (1 << 20) * sizeof(page_t *);
+    readlookup2  = (uintptr_t *) lookup;
+    lookup += (1 << 20) * sizeof(uintptr_t);
+    writelookup2 = (uintptr_t *) lookup;
+    lookup += (1 << 20) * sizeof(uintptr_t);
+    page_lookupp = lookup;
+    lookup += (1 << 20) * sizeof(uint8_t);
+    readlookupp  = lookup;
+    lookup += (1 << 20) * sizeof(uint8_t);
+    writelookupp = lookup;
 }
 
 static void
@@ -3278,3 +3333,151 @@ mem_a20_recalc(void)
 
     mem_a20_state = state;
 }
+
+/* Store a mapping's exec pointer as an offset into RAM, anything else (ROM,
+   device memory) is set up again by its owner and left alone on restore. */
+#define MEM_STATE_EXEC_NONE  0xffffffff
+#define MEM_STATE_EXEC_KEEP  0xfffffffe
+
+static uint32_t
+mem_exec_to_state(const uint8_t *exec)
+{
+    if (exec == NULL)
+        return MEM_STATE_EXEC_NONE;
+
+    if ((ram != NULL) && (exec >= ram) && (exec < (ram + ram_size)))
+        return (uint32_t) (exec - ram);
+
+#if (!(defined __amd64__ || defined _M_X64 || defined __aarch64__ || defined _M_ARM64))
+    if ((ram2 != NULL) && ram2_size && (exec >= ram2) && (exec < (ram2 + ram2_size)))
+        return (uint32_t) ((exec - ram2) + (1 << 30));
+#endif
+
+    return MEM_STATE_EXEC_KEEP;
+}
+
+static uint8_t *
+mem_state_to_exec(uint32_t offset, uint8_t *cur)
+{
+    if (offset == MEM_STATE_EXEC_NONE)
+        return NULL;
+
+    if (offset == MEM_STATE_EXEC_KEEP)
+        return cur;
+
+#if (!(defined __amd64__ || defined _M_X64 || defined __aarch64__ || defined _M_ARM64))
+    if (ram2_size && (offset >= (1 << 30)))
+        return &ram2[offset - (1 << 30)];
+#endif
+
+    return &ram[offset];
+}
+
+void
+mem_save_state(snapshot_t *s)
+{
+    mem_mapping_t *map;
+    uint32_t       num = 0;
+    uint32_t       exec;
+    uint64_t       size;
+
+    snapshot_write_var(s, mem_a20_key);
+    snapshot_write_var(s, mem_a20_alt);
+    snapshot_write_var(s, mem_a20_state);
+    snapshot_write_var(s, rammask);
+    snapshot_write_var(s, shadowbios);
+    snapshot_write_var(s, shadowbios_write);
+    snapshot_write_var(s, remap_start_addr);
+    snapshot_write_var(s, remap_start_addr2);
+    snapshot_write(s, _mem_state, sizeof(_mem_state));
+    snapshot_write(s, _mem_wp, sizeof(_mem_wp));
+    snapshot_write(s, _mem_wp_bus, sizeof(_mem_wp_bus));
+
+    /* The mappings are created in the same order for the same configuration,
+       so the list position identifies them. */
+    for (map = base_mapping; map != NULL; map = map->next)
+        num++;
+    snapshot_write_var(s, num);
+
+    for (map = base_mapping; map != NULL; map = map->next) {
+        exec = mem_exec_to_state(map->exec);
+
+        snapshot_write_var(s, map->enable);
+        snapshot_write_var(s, map->base);
+        snapshot_write_var(s, map->size);
+        snapshot_write_var(s, map->base_ignore);
+        snapshot_write_var(s, map->mask);
+        snapshot_write_var(s, map->flags);
+        snapshot_write_var(s, exec);
+    }
+
+    /* The RAM goes out as a single block. */
+    size = ram_size;
+    snapshot_write_var(s, size);
+    snapshot_write(s, ram, ram_size);
+#if (!(defined __amd64__ || defined _M_X64 || defined __aarch64__ || defined _M_ARM64))
+    size = ram2_size;
+    snapshot_write_var(s, size);
+    snapshot_write(s, ram2, ram2_size);
+#endif
+}
+
+void
+mem_load_state(snapshot_t *s)
+{
+    mem_mapping_t *map;
+    uint32_t       num  = 0;
+    uint32_t       exec = 0;
+    uint64_t       size = 0ULL;
+
+    snapshot_read_var(s, mem_a20_key);
+    snapshot_read_var(s, mem_a20_alt);
+    snapshot_read_var(s, mem_a20_state);
+    snapshot_read_var(s, rammask);
+    snapshot_read_var(s, shadowbios);
+    snapshot_read_var(s, shadowbios_write);
+    snapshot_read_var(s, remap_start_addr);
+    snapshot_read_var(s, remap_start_addr2);
+    snapshot_read(s, _mem_state, sizeof(_mem_state));
+    snapshot_read(s, _mem_wp, sizeof(_mem_wp));
+    snapshot_read(s, _mem_wp_bus, sizeof(_mem_wp_bus));
+
+    snapshot_read_var(s, num);
+    for (map = base_mapping; map != NULL; map = map->next)
+        num--;
+    if (num != 0)
+        snapshot_set_error(s);
+
+    for (map = base_mapping; (map != NULL) && !snapshot_error(s); map = map->next) {
+        snapshot_read_var(s, map->enable);
+        snapshot_read_var(s, map->base);
+        snapshot_read_var(s, map->size);
+        snapshot_read_var(s, map->base_ignore);
+        snapshot_read_var(s, map->mask);
+        snapshot_read_var(s, map->flags);
+        snapshot_read_var(s, exec);
+        map->exec = mem_state_to_exec(exec, map->exec);
+    }
+
+    snapshot_read_var(s, size);
+    if (size != ram_size)
+        snapshot_set_error(s);
+    snapshot_read(s, ram, ram_size);
+#if (!(defined __amd64__ || defined _M_X64 || defined __aarch64__ || defined _M_ARM64))
+    snapshot_read_var(s, size);
+    if (size != ram2_size)
+        snapshot_set_error(s);
+    snapshot_read(s, ram2, ram2_size);
+#endif
+
+    if (snapshot_error(s))
+        return;
+
+    mem_mapping_recalc(0ULL, 0x100000000ULL);
+
+    /* Everything recompiled or cached so far refers to the old contents. */
+#ifdef USE_DYNAREC
+    codegen_reset();
+#endif
+    flushmmucache();
+}
@@ -218,6 +218,7 @@
  *   USA.
  */
 #include <inttypes.h>
+#include <stddef.h>
 #include <stdio.h>
 #include <stdint.h>
 #include <string.h>
@@ -232,6 +233,7 @@
 #include <86box/nmi.h>
 #include <86box/pic.h>
 #include <86box/timer.h>
+#include <86box/snapshot.h>
 #include <86box/pit.h>
 #include <86box/rom.h>
 #include <86box/device.h>
@@ -922,6 +924,58 @@ nvr_at_speed_changed(void *priv)
     timer_set_delay_u64(&nvr->onesec_time, (10000ULL * TIMER_USEC));
 }
 
+static void
+nvr_at_save_state(void *priv, snapshot_t *s)
+{
+    nvr_t   *nvr   = (nvr_t *) priv;
+    local_t *local = (local_t *) nvr->data;
+
+    snapshot_write(s, nvr->regs, nvr->size);
+    snapshot_write_var(s, nvr->onesec_cnt);
+    snapshot_write_timer(s, &nvr->onesec_time);
+
+    snapshot_write(s, local, offsetof(local_t, lock));
+    snapshot_write(s, local->lock, nvr->size);
+    snapshot_write_var(s, local->count);
+    snapshot_write_var(s, local->state);
+    snapshot_write_var(s, local->addr);
+    snapshot_write_var(s, local->smi_enable);
+    snapshot_write_var(s, local->ecount);
+    snapshot_write_var(s, local->rtc_time);
+    snapshot_write_timer(s, &local->update_timer);
+    snapshot_write_timer(s, &local->rtc_timer);
+}
+
+static void
+nvr_at_load_state(void *priv, snapshot_t *s)
+{
+    nvr_t    *nvr   = (nvr_t *) priv;
+    local_t  *local = (local_t *) nvr->data;
+    struct tm tm;
+
+    snapshot_read(s, nvr->regs, nvr->size);
+    snapshot_read_var(s, nvr->onesec_cnt);
+    snapshot_read_timer(s, &nvr->onesec_time);
+
+    snapshot_read(s, local, offsetof(local_t, lock));
+    snapshot_read(s, local->lock, nvr->size);
+    snapshot_read_var(s, local->count);
+    snapshot_read_var(s, local->state);
+    snapshot_read_var(s, local->addr);
+    snapshot_read_var(s, local->smi_enable);
+    snapshot_read_var(s, local->ecount);
+    snapshot_read_var(s, local->rtc_time);
+    snapshot_read_timer(s, &local->update_timer);
+    snapshot_read_timer(s, &local->rtc_timer);
+
+    if (snapshot_error(s))
+        return;
+
+    /* The chip time is authoritative, carry on from there. */
+    time_get(nvr, &tm);
+    nvr_time_set(&tm);
+}
+
 void
 nvr_at_handler(int set, uint16_t base, nvr_t *nvr)
 {
@@ -1227,7 +1281,9 @@ const device_t at_nvr_old_device = {
     .available     = NULL,
     .speed_changed = nvr_at_speed_changed,
     .force_redraw  = NULL,
-    .config        = NULL
+    .config        = NULL,
+    .save_state    = nvr_at_save_state,
+    .load_state    = nvr_at_load_state
 };
 
 const device_t at_nvr_device = {
@@ -1241,7 +1297,9 @@ const device_t at_nvr_device = {
     .available     = NULL,
     .speed_changed = nvr_at_speed_changed,
     .force_redraw  = NULL,
-    .config        = NULL
+    .config        = NULL,
+    .save_state    = nvr_at_save_state,
+    .load_state    = nvr_at_load_state
 };
 
 const device_t at_mb_nvr_device = {
@@ -1255,7 +1313,9 @@ const device_t at_mb_nvr_device = {
     .available     = NULL,
     .speed_changed = nvr_at_speed_changed,
     .force_redraw  = NULL,
-    .config        = NULL
+    .config        = NULL,
+    .save_state    = nvr_at_save_state,
+    .load_state    = nvr_at_load_state
 };
 
 const device_t ps_nvr_device = {
@@ -1269,7 +1329,9 @@ const device_t ps_nvr_device = {
     .available     = NULL,
     .speed_changed = nvr_at_speed_changed,
     .force_redraw  = NULL,
-    .config        = NULL
+    .config        = NULL,
+    .save_state    = nvr_at_save_state,
+    .load_state    = nvr_at_load_state
 };
 
 const device_t amstrad_nvr_device = {
@@ -1283,7 +1345,9 @@ const device_t amstrad_nvr_device = {
     .available     = NULL,
     .speed_changed = nvr_at_speed_changed,
     .force_redraw  = NULL,
-    .config        = NULL
+    .config        = NULL,
+    .save_state    = nvr_at_save_state,
+    .load_state    = nvr_at_load_state
 };
 
 const device_t ibmat_nvr_device = {
@@ -1297,7 +1361,9 @@ const device_t ibmat_nvr_device = {
     .available     = NULL,
     .speed_changed = nvr_at_speed_changed,
     .force_redraw  = NULL,
-    .config        = NULL
+    .config        = NULL,
+    .save_state    = nvr_at_save_state,
+    .load_state    = nvr_at_load_state
 };
 
 const device_t piix4_nvr_device = {
@@ -1311,7 +1377,9 @@ const device_t piix4_nvr_device = {
     .available     = NULL,
     .speed_changed = nvr_at_speed_changed,
     .force_redraw  = NULL,
-    .config        = NULL
+    .config        = NULL,
+    .save_state    = nvr_at_save_state,
+    .load_state    = nvr_at_load_state
 };
 
 const device_t ps_no_nmi_nvr_device = {
@@ -1325,7 +1393,9 @@ const device_t ps_no_nmi_nvr_device = {
     .available     = NULL,
     .speed_changed = nvr_at_speed_changed,
     .force_redraw  = NULL,
-    .config        = NULL
+    .config        = NULL,
+    .save_state    = nvr_at_save_state,
+    .load_state    = nvr_at_load_state
 };
 
 const device_t amstrad_no_nmi_nvr_device = {
@@ -1339,7 +1409,9 @@ const device_t amstrad_no_nmi_nvr_device = {
     .available     = NULL,
     .speed_changed = nvr_at_speed_changed,
     .force_redraw  = NULL,
-    .config        = NULL
+    .config        = NULL,
+    .save_state    = nvr_at_save_state,
+    .load_state    = nvr_at_load_state
 };
 
 const device_t ami_1992_nvr_device = {
@@ -1353,7 +1425,9 @@ const device_t ami_1992_nvr_device = {
     .available     = NULL,
     .speed_changed = nvr_at_speed_changed,
     .force_redraw  = NULL,
-    .config        = NULL
+    .config        = NULL,
+    .save_state    = nvr_at_save_state,
+    .load_state    = nvr_at_load_state
 };
 
 const device_t ami_1994_nvr_device = {
@@ -1367,7 +1441,9 @@ const device_t ami_1994_nvr_device = {
     .available     = NULL,
     .speed_changed = nvr_at_speed_changed,
     .force_redraw  = NULL,
-    .config        = NULL
+    .config        = NULL,
+    .save_state    = nvr_at_save_state,
+    .load_state    = nvr_at_load_state
 };
 
 const device_t ami_1995_nvr_device = {
@@ -1381,7 +1457,9 @@ const device_t ami_1995_nvr_device = {
     .available     = NULL,
     .speed_changed = nvr_at_speed_changed,
     .force_redraw  = NULL,
-    .config        = NULL
+    .config        = NULL,
+    .save_state    = nvr_at_save_state,
+    .load_state    = nvr_at_load_state
 };
 
 const device_t via_nvr_device = {
@@ -1395,7 +1473,9 @@ const device_t via_nvr_device = {
     .available     = NULL,
     .speed_changed = nvr_at_speed_changed,
     .force_redraw  = NULL,
-    .config        = NULL
+    .config        = NULL,
+    .save_state    = nvr_at_save_state,
+    .load_state    = nvr_at_load_state
 };
 
 const device_t p6rp4_nvr_device = {
@@ -1409,7 +1489,9 @@ const device_t p6rp4_nvr_device = {
     .available     = NULL,
     .speed_changed = nvr_at_speed_changed,
     .force_redraw  = NULL,
-    .config        = NULL
+    .config        = NULL,
+    .save_state    = nvr_at_save_state,
+    .load_state    = nvr_at_load_state
 };
 
 const device_t amstrad_megapc_nvr_device = {
@@ -1423,7 +1505,9 @@ const device_t amstrad_megapc_nvr_device = {
     .available     = NULL,
     .speed_changed = nvr_at_speed_changed,
     .force_redraw  = NULL,
-    .config        = NULL
+    .config        = NULL,
+    .save_state    = nvr_at_save_state,
+    .load_state    = nvr_at_load_state
 };
 
 const device_t elt_nvr_device = {
@@ -1437,5 +1521,7 @@ const device_t elt_nvr_device = {
     .available     = NULL,
     .speed_changed = nvr_at_speed_changed,
     .force_redraw  = NULL,
-    .config        = NULL
+    .config        = NULL,
+    .save_state    = nvr_at_save_state,
+    .load_state    = nvr_at_load_state
 };
@@ -0,0 +1,326 @@
+/*
+ * 86Box    A hypervisor and IBM PC system emulator that specializes in
+ *          running old operating systems and software designed for IBM
+ *          PC systems and compatibles from 1981 through fairly recent
+ *          system designs based on the PCI bus.
+ *
+ *          This file is part of the 86Box distribution.
+ *
+ *          Performance counters and the headless benchmark mode.
+ *
+ *          In benchmark mode the platform CPU thread runs pc_run()
+ *          back to back instead of pacing it against the host clock,
+ *          until either the requested number of emulated seconds has
+ *          elapsed or the guest ends the run (see perf_bench_stop()).
+ *          A JSON report is then written and the machine is powered
+ *          off, so the run ends through the normal shutdown path and
+ *          every device and disk image is closed.
+ *
+ *          Emulated time is counted in pc_run() slices, each of which
+ *          executes 10 ms worth of CPU cycles.
+ */
+#include <inttypes.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <wchar.h>
+#ifdef _WIN32
+#    include <windows.h>
+#elif defined(__APPLE__)
+#    include <mach/mach.h>
+#    include <sys/resource.h>
+#else
+#    include <pthread.h>
+#    include <time.h>
+#endif
+#define HAVE_STDARG_H
+#include <86box/86box.h>
+#include <86box/machine.h>
+#include <86box/plat.h>
+#include <86box/perf.h>
+
+typedef struct perf_thread_t {
+    char name[32];
+#ifdef _WIN32
+    HANDLE handle;
+#elif defined(__APPLE__)
+    mach_port_t port;
+#else
+    clockid_t clock;
+#endif
+} perf_thread_t;
+
+perf_counters_t perf_counters;
+
+int      perf_bench_enabled = 0;
+uint32_t perf_bench_secs    = 0;
+char     perf_bench_report[1024];
+
+static perf_thread_t perf_threads[PERF_THREADS_MAX];
+static volatile int  perf_threads_num = 0;
+
+static uint32_t     perf_bench_start_ticks;
+static uint32_t     perf_bench_end_ticks;
+static volatile int perf_bench_stopped   = 0;
+static int          perf_bench_exit_code = 0;
+
+#ifdef ENABLE_PERF_LOG
+int perf_do_log = ENABLE_PERF_LOG;
+
+static void
+perf_log(const char *fmt, ...)
+{
+    va_list ap;
+
+    if (perf_do_log) {
+        va_start(ap, fmt);
+        pclog_ex(fmt, ap);
+        va_end(ap);
+    }
+}
+#else
+#    define perf_log(fmt, ...)
+#endif
+
+void
+perf_reset(void)
+{
+    memset(&perf_counters, 0x00, sizeof(perf_counters_t));
+}
+
+void
+perf_thread_register(const char *name)
+{
+    perf_thread_t *t;
+    int            n = perf_threads_num;
+    int            i;
+
+    /* A thread that is re-created (e.g. on a hard reset) takes over the
+       slot of its predecessor. */
+    for (i = 0; i < n; i++) {
+        if (!strcmp(perf_threads[i].name, name))
+            break;
+    }
+
+    if (i >= PERF_THREADS_MAX)
+        return;
+
+    t = &perf_threads[i];
+#ifdef _WIN32
+    if (i < n)
+        CloseHandle(t->handle);
+#endif
+    strncpy(t->name, name, sizeof(t->name) - 1);
+#ifdef _WIN32
+    /* GetCurrentThread() is a pseudo-handle, get a real one. */
+    if (!DuplicateHandle(GetCurrentProcess(), GetCurrentThread(), GetCurrentProcess(),
+                         &t->handle, THREAD_QUERY_INFORMATION, FALSE, 0))
+        return;
+#elif defined(__APPLE__)
+    t->port = mach_thread_self();
+#else
+    if (pthread_getcpuclockid(pthread_self(), &t->clock) != 0)
+        return;
+#endif
+
+    if (i == n)
+        perf_threads_num = n + 1;
+}
+
+/* CPU time (user + system) used by a registered thread, in seconds. */
+static double
+perf_thread_cpu_time(perf_thread_t *t)
+{
+#ifdef _WIN32
+    FILETIME       create;
+    FILETIME       exit_time;
+    FILETIME       kernel;
+    FILETIME       user;
+    ULARGE_INTEGER k;
+    ULARGE_INTEGER u;
+
+    if (!GetThreadTimes(t->handle, &create, &exit_time, &kernel, &user))
+        return 0.0;
+
+    k.LowPart  = kernel.dwLowDateTime;
+    k.HighPart = kernel.dwHighDateTime;
+    u.LowPart  = user.dwLowDateTime;
+    u.HighPart = user.dwHighDateTime;
+
+    return (double) (k.QuadPart + u.QuadPart) / 10000000.0;
+#elif defined(__APPLE__)
+    thread_basic_info_data_t info;
+    mach_msg_type_number_t   count = THREAD_BASIC_INFO_COUNT;
+
+    if (thread_info(t->port, THREAD_BASIC_INFO, (thread_info_t) &info, &count) != KERN_SUCCESS)
+        return 0.0;
+
+    return (double) info.user_time.seconds + (double) info.user_time.microseconds / 1000000.0 +
+           (double) info.system_time.seconds + (double) info.system_time.microseconds / 1000000.0;
+#else
+    struct timespec ts;
+
+    if (clock_gettime(t->clock, &ts) != 0)
+        return 0.0;
+
+    return (double) ts.tv_sec + (double) ts.tv_nsec / 1000000000.0;
+#endif
+}
+
+static double
+perf_process_cpu_time(void)
+{
+#ifdef _WIN32
+    FILETIME       create;
+    FILETIME       exit_time;
+    FILETIME       kernel;
+    FILETIME       user;
+    ULARGE_INTEGER k;
+    ULARGE_INTEGER u;
+
+    if (!GetProcessTimes(GetCurrentProcess(), &create, &exit_time, &kernel, &user))
+        return 0.0;
+
+    k.LowPart  = kernel.dwLowDateTime;
+    k.HighPart = kernel.dwHighDateTime;
+    u.LowPart  = user.dwLowDateTime;
+    u.HighPart = user.dwHighDateTime;
+
+    return (double) (k.QuadPart + u.QuadPart) / 10000000.0;
+#elif defined(__APPLE__)
+    struct rusage ru;
+
+    if (getrusage(RUSAGE_SELF, &ru) != 0)
+        return 0.0;
+
+    return (double) ru.ru_utime.tv_sec + (double) ru.ru_utime.tv_usec / 1000000.0 +
+           (double) ru.ru_stime.tv_sec + (double) ru.ru_stime.tv_usec / 1000000.0;
+#else
+    struct timespec ts;
+
+    if (clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &ts) != 0)
+        return 0.0;
+
+    return (double) ts.tv_sec + (double) ts.tv_nsec / 1000000000.0;
+#endif
+}
+
+void
+perf_bench_start(void)
+{
+    perf_reset();
+    perf_bench_stopped     = 0;
+    perf_bench_exit_code   = 0;
+    perf_bench_start_ticks = plat_get_ticks();
+
+    perf_log("Perf: benchmark started, %u emulated seconds\n", perf_bench_secs);
+}
+
+int
+perf_bench_done(void)
+{
+    if (perf_bench_stopped)
+        return 1;
+
+    return perf_bench_secs && (perf_counters.emu_slices >= ((uint64_t) perf_bench_secs * 100ULL));
+}
+
+void
+perf_bench_stop(int exit_code)
+{
+    perf_bench_exit_code = exit_code;
+    perf_bench_stopped   = 1;
+}
+
+int
+perf_bench_get_exit_code(void)
+{
+    return perf_bench_exit_code;
+}
+
+static void
+perf_write_report(FILE *fp)
+{
+    double emu_secs  = (double) perf_counters.emu_slices / 100.0;
+    double wall_secs = (double) (perf_bench_end_ticks - perf_bench_start_ticks) / 1000.0;
+
+    fprintf(fp, "{\n");
+    fprintf(fp, "  \"machine\": \"%s\",\n", machine_get_internal_name());
+    fprintf(fp, "  \"trigger\": \"%s\",\n", perf_bench_stopped ? "guest" : "time");
+    fprintf(fp, "  \"exit_code\": %i,\n", perf_bench_exit_code);
+    fprintf(fp, "  \"emulated_seconds\": %.3f,\n", emu_secs);
+    fprintf(fp, "  \"wall_seconds\": %.3f,\n", wall_secs);
+    fprintf(fp, "  \"speed_ratio\": %.4f,\n", (wall_secs > 0.0) ? (emu_secs / wall_secs) : 0.0);
+    fprintf(fp, "  \"counters\": {\n");
+    fprintf(fp, "    \"timer_callbacks\": %" PRIu64 ",\n", perf_counters.timer_callbacks);
+    fprintf(fp, "    \"io_reads\": %" PRIu64 ",\n", perf_counters.io_reads);
+    fprintf(fp, "    \"io_writes\": %" PRIu64 ",\n", perf_counters.io_writes);
+    fprintf(fp, "    \"mmio_reads\": %" PRIu64 ",\n", perf_counters.mmio_reads);
+    fprintf(fp, "    \"mmio_writes\": %" PRIu64 ",\n", perf_counters.mmio_writes);
+    fprintf(fp, "    \"dynarec_blocks_compiled\": %" PRIu64 ",\n", perf_counters.blocks_compiled);
+    fprintf(fp, "    \"dynarec_blocks_invalidated\": %" PRIu64 ",\n", perf_counters.blocks_invalidated);
+    fprintf(fp, "    \"dynarec_transitions_chained\": %" PRIu64 ",\n", perf_counters.blocks_chained);
+    fprintf(fp, "    \"dynarec_transitions_dispatched\": %" PRIu64 ",\n", perf_counters.blocks_dispatched);
+    fprintf(fp, "    \"dynarec_flag_writes_elided\": %" PRIu64 ",\n", perf_counters.flag_writes_elided);
+    fprintf(fp, "    \"dynarec_cache_hits\": %" PRIu64 ",\n", perf_counters.blocks_chained + perf_counters.blocks_dispatched);
+    fprintf(fp, "    \"dynarec_cache_misses\": %" PRIu64 ",\n", perf_counters.blocks_missed);
+    fprintf(fp, "    \"dynarec_cache_evictions\": %" PRIu64 ",\n", perf_counters.blocks_evicted);
+    fprintf(fp, "    \"dynarec_tcache_prewarmed\": %" PRIu64 ",\n", perf_counters.blocks_prewarmed);
+    fprintf(fp, "    \"video_lines_copied\": %" PRIu64 ",\n", perf_counters.video_lines_copied);
+    fprintf(fp, "    \"video_lines_skipped\": %" PRIu64 ",\n", perf_counters.video_lines_skipped);
+    fprintf(fp, "    \"video_blit_wait_us\": %" PRIu64 ",\n", perf_counters.video_blit_wait_us);
+    fprintf(fp, "    \"video_frames_dropped\": %" PRIu64 ",\n", perf_counters.video_frames_dropped);
+    fprintf(fp, "    \"vnc_tiles_sent\": %" PRIu64 ",\n", perf_counters.vnc_tiles_sent);
+    fprintf(fp, "    \"vnc_tiles_skipped\": %" PRIu64 ",\n", perf_counters.vnc_tiles_skipped);
+    fprintf(fp, "    \"hdd_async_reads\": %" PRIu64 ",\n", perf_counters.hdd_async_reads);
+    fprintf(fp, "    \"hdd_read_stalls\": %" PRIu64 ",\n", perf_counters.hdd_read_stalls);
+    fprintf(fp, "    \"hdd_cache_hits\": %" PRIu64 ",\n", perf_counters.hdd_cache_hits);
+    fprintf(fp, "    \"hdd_cache_misses\": %" PRIu64 ",\n", perf_counters.hdd_cache_misses);
+    fprintf(fp, "    \"hdd_cache_hit_rate\": %.4f,\n",
+            (perf_counters.hdd_cache_hits + perf_counters.hdd_cache_misses) ?
+            ((double) perf_counters.hdd_cache_hits / (double) (perf_counters.hdd_cache_hits + perf_counters.hdd_cache_misses)) : 0.0);
+    fprintf(fp, "    \"hdd_cache_bytes_saved\": %" PRIu64 ",\n", perf_counters.hdd_cache_bytes_saved);
+    fprintf(fp, "    \"hdd_cache_read_ahead\": %" PRIu64 ",\n", perf_counters.hdd_cache_read_ahead);
+    fprintf(fp, "    \"voodoo_tex_hits\": %" PRIu64 ",\n", perf_counters.voodoo_tex_hits);
+    fprintf(fp, "    \"voodoo_tex_misses\": %" PRIu64 ",\n", perf_counters.voodoo_tex_misses);
+    fprintf(fp, "    \"voodoo_tex_evicted\": %" PRIu64 ",\n", perf_counters.voodoo_tex_evicted);
+    fprintf(fp, "    \"voodoo_tex_invalidated\": %" PRIu64 "\n", perf_counters.voodoo_tex_invalidated);
+    fprintf(fp, "  },\n");
+    fprintf(fp, "  \"threads\": [\n");
+    for (int i = 0; i < perf_threads_num; i++) {
+        fprintf(fp, "    { \"name\": \"%s\", \"cpu_seconds\": %.3f }%s\n",
+                perf_threads[i].name, perf_thread_cpu_time(&perf_threads[i]),
+                (i < (perf_threads_num - 1)) ? "," : "");
+    }
+    fprintf(fp, "  ],\n");
+    fprintf(fp, "  \"process_cpu_seconds\": %.3f\n", perf_process_cpu_time());
+    fprintf(fp, "}\n");
+}
+
+void
+perf_bench_finish(void)
+{
+    FILE *fp = stdout;
+
+    perf_bench_end_ticks = plat_get_ticks();
+
+    if (perf_bench_report[0] != '\0') {
+        fp = plat_fopen(perf_bench_report, "w");
+        if (fp == NULL) {
+            pclog("Perf: unable to create '%s', writing the report to stdout\n", perf_bench_report);
+            fp = stdout;
+        }
+    }
+
+    perf_write_report(fp);
+
+    if (fp != stdout)
+        fclose(fp);
+    else
+        fflush(fp);
+
+    /* Stops the CPU thread; the platform then closes the machine down. */
+    plat_power_off();
+}
@@ -19,6 +19,7 @@
  */
 #include <inttypes.h>
 #include <stdarg.h>
+#include <stddef.h>
 #include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
@@ -33,6 +34,7 @@
 #include <86box/pci.h>
 #include <86box/pic.h>
 #include <86box/timer.h>
+#include <86box/snapshot.h>
 #include <86box/pit.h>
 #include <86box/device.h>
 #include <86box/apm.h>
@@ -899,3 +901,42 @@ picinterrupt(void)
 
     return ret;
 }
+
+/* The slave pointers are host addresses and set up by pic_init(), so only
+   the part of pic_t before them is saved. */
+#define PIC_STATE_SIZE offsetof(pic_t, slaves)
+
+void
+pic_save_state(snapshot_t *s)
+{
+    snapshot_write(s, &pic, PIC_STATE_SIZE);
+    snapshot_write(s, &pic2, PIC_STATE_SIZE);
+    snapshot_write_var(s, shadow);
+    snapshot_write_var(s, elcr_enabled);
+    snapshot_write_var(s, pic_pci);
+    snapshot_write_var(s, kbd_latch);
+    snapshot_write_var(s, mouse_latch);
+    snapshot_write_var(s, smi_irq_mask);
+    snapshot_write_var(s, smi_irq_status);
+    snapshot_write_var(s, latched_irqs);
+    snapshot_write_timer(s, &pic_timer);
+}
+
+void
+pic_load_state(snapshot_t *s)
+{
+    snapshot_read(s, &pic, PIC_STATE_SIZE);
+    snapshot_read(s, &pic2, PIC_STATE_SIZE);
+    snapshot_read_var(s, shadow);
+    snapshot_read_var(s, elcr_enabled);
+    snapshot_read_var(s, pic_pci);
+    snapshot_read_var(s, kbd_latch);
+    snapshot_read_var(s, mouse_latch);
+    snapshot_read_var(s, smi_irq_mask);
+    snapshot_read_var(s, smi_irq_status);
+    snapshot_read_var(s, latched_irqs);
+    snapshot_read_timer(s, &pic_timer);
+
+    if (!snapshot_error(s) && (update_pending != NULL))
+        update_pending();
+}
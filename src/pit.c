@@ -18,6 +18,7 @@
 #include <inttypes.h>
 #include <math.h>
 #include <stdarg.h>
+#include <stddef.h>
 #include <stdio.h>
 #include <stdint.h>
 #include <stdlib.h>
@@ -34,6 +35,7 @@
 #include <86box/nmi.h>
 #include <86box/pic.h>
 #include <86box/timer.h>
+#include <86box/snapshot.h>
 #include <86box/pit.h>
 #include <86box/pit_fast.h>
 #include <86box/ppi.h>
@@ -952,6 +954,34 @@ pit_init(const device_t *info)
     return dev;
 }
 
+/* The counters are saved up to their callback pointers, which are set by
+   whoever owns the PIT. */
+static void
+pit_save_state(void *priv, snapshot_t *s)
+{
+    pit_t *dev = (pit_t *) priv;
+
+    snapshot_write_var(s, dev->clock);
+    for (int i = 0; i < NUM_COUNTERS; i++)
+        snapshot_write(s, &dev->counters[i], offsetof(ctr_t, load_func));
+    snapshot_write_var(s, dev->ctrl);
+    snapshot_write_var(s, dev->pit_const);
+    snapshot_write_timer(s, &dev->callback_timer);
+}
+
+static void
+pit_load_state(void *priv, snapshot_t *s)
+{
+    pit_t *dev = (pit_t *) priv;
+
+    snapshot_read_var(s, dev->clock);
+    for (int i = 0; i < NUM_COUNTERS; i++)
+        snapshot_read(s, &dev->counters[i], offsetof(ctr_t, load_func));
+    snapshot_read_var(s, dev->ctrl);
+    snapshot_read_var(s, dev->pit_const);
+    snapshot_read_timer(s, &dev->callback_timer);
+}
+
 const device_t i8253_device = {
     .name          = "Intel 8253/8253-5 Programmable Interval Timer",
     .internal_name = "i8253",
@@ -963,7 +993,9 @@ const device_t i8253_device = {
     .available     = NULL,
     .speed_changed = pit_speed_changed,
     .force_redraw  = NULL,
-    .config        = NULL
+    .config        = NULL,
+    .save_state    = pit_save_state,
+    .load_state    = pit_load_state
 };
 
 const device_t i8253_ext_io_device = {
@@ -977,7 +1009,9 @@ const device_t i8253_ext_io_device = {
     .available     = NULL,
     .speed_changed = NULL,
     .force_redraw  = NULL,
-    .config        = NULL
+    .config        = NULL,
+    .save_state    = pit_save_state,
+    .load_state    = pit_load_state
 };
 
 const device_t i8254_device = {
@@ -991,7 +1025,9 @@ const device_t i8254_device = {
     .available     = NULL,
     .speed_changed = pit_speed_changed,
     .force_redraw  = NULL,
-    .config        = NULL
+    .config        = NULL,
+    .save_state    = pit_save_state,
+    .load_state    = pit_load_state
 };
 
 const device_t i8254_sec_device = {
@@ -1005,7 +1041,9 @@ const device_t i8254_sec_device = {
     .available     = NULL,
     .speed_changed = pit_speed_changed,
     .force_redraw  = NULL,
-    .config        = NULL
+    .config        = NULL,
+    .save_state    = pit_save_state,
+    .load_state    = pit_load_state
 };
 
 const device_t i8254_ext_io_device = {
@@ -1019,7 +1057,9 @@ const device_t i8254_ext_io_device = {
     .available     = NULL,
     .speed_changed = NULL,
     .force_redraw  = NULL,
-    .config        = NULL
+    .config        = NULL,
+    .save_state    = pit_save_state,
+    .load_state    = pit_load_state
 };
 
 const device_t i8254_ps2_device = {
@@ -1033,7 +1073,9 @@ const device_t i8254_ps2_device = {
     .available     = NULL,
     .speed_changed = pit_speed_changed,
     .force_redraw  = NULL,
-    .config        = NULL
+    .config        = NULL,
+    .save_state    = pit_save_state,
+    .load_state    = pit_load_state
 };
 
 pit_t *
@@ -18,6 +18,7 @@
 #include <inttypes.h>
 #include <math.h>
 #include <stdarg.h>
+#include <stddef.h>
 #include <stdio.h>
 #include <stdint.h>
 #include <stdlib.h>
@@ -34,6 +35,7 @@
 #include <86box/nmi.h>
 #include <86box/pic.h>
 #include <86box/timer.h>
+#include <86box/snapshot.h>
 #include <86box/pit.h>
 #include <86box/pit_fast.h>
 #include <86box/ppi.h>
@@ -743,6 +745,32 @@ pitf_init(const device_t *info)
     return dev;
 }
 
+/* The counters are saved up to their timer, the timer separately and the
+   callback pointers not at all, as those are set by the PIT's owner. */
+static void
+pitf_save_state(void *priv, snapshot_t *s)
+{
+    pitf_t *dev = (pitf_t *) priv;
+
+    for (int i = 0; i < NUM_COUNTERS; i++) {
+        snapshot_write(s, &dev->counters[i], offsetof(ctrf_t, timer));
+        snapshot_write_timer(s, &dev->counters[i].timer);
+    }
+    snapshot_write_var(s, dev->ctrl);
+}
+
+static void
+pitf_load_state(void *priv, snapshot_t *s)
+{
+    pitf_t *dev = (pitf_t *) priv;
+
+    for (int i = 0; i < NUM_COUNTERS; i++) {
+        snapshot_read(s, &dev->counters[i], offsetof(ctrf_t, timer));
+        snapshot_read_timer(s, &dev->counters[i].timer);
+    }
+    snapshot_read_var(s, dev->ctrl);
+}
+
 const device_t i8253_fast_device = {
     .name          = "Intel 8253/8253-5 Programmable Interval Timer",
     .internal_name = "i8253_fast",
@@ -754,7 +782,9 @@ const device_t i8253_fast_device = {
     .available     = NULL,
     .speed_changed = pitf_speed_changed,
     .force_redraw  = NULL,
-    .config        = NULL
+    .config        = NULL,
+    .save_state    = pitf_save_state,
+    .load_state    = pitf_load_state
 };
 
 const device_t i8254_fast_device = {
@@ -768,7 +798,9 @@ const device_t i8254_fast_device = {
     .available     = NULL,
     .speed_changed = pitf_speed_changed,
     .force_redraw  = NULL,
-    .config        = NULL
+    .config        = NULL,
+    .save_state    = pitf_save_state,
+    .load_state    = pitf_load_state
 };
 
 const device_t i8254_sec_fast_device = {
@@ -782,7 +814,9 @@ const device_t i8254_sec_fast_device = {
     .available     = NULL,
     .speed_changed = pitf_speed_changed,
     .force_redraw  = NULL,
-    .config        = NULL
+    .config        = NULL,
+    .save_state    = pitf_save_state,
+    .load_state    = pitf_load_state
 };
 
 const device_t i8254_ext_io_fast_device = {
@@ -796,7 +830,9 @@ const device_t i8254_ext_io_fast_device = {
     .available     = NULL,
     .speed_changed = NULL,
     .force_redraw  = NULL,
-    .config        = NULL
+    .config        = NULL,
+    .save_state    = pitf_save_state,
+    .load_state    = pitf_load_state
 };
 
 const device_t i8254_ps2_fast_device = {
@@ -810,7 +846,9 @@ const device_t i8254_ps2_fast_device = {
     .available     = NULL,
     .speed_changed = pitf_speed_changed,
     .force_redraw  = NULL,
-    .config        = NULL
+    .config        = NULL,
+    .save_state    = pitf_save_state,
+    .load_state    = pitf_load_state
 };
 
 const pit_intf_t pit_fast_intf = {
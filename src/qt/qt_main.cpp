@@ -89,6 +89,7 @@ extern "C" {
 #include "cpu.h"
 #include <86box/timer.h>
 #include <86box/nvr.h>
+#include <86box/perf.h>
 extern int qt_nvr_save(void);
 
 bool cpu_thread_running = false;
@@ -438,6 +439,9 @@ main_thread_fn()
     uint64_t old_time = elapsed_timer.elapsed();
     int drawits = frames = 0;
     is_cpu_thread = 1;
+    perf_thread_register("cpu");
+    if (perf_bench_enabled)
+        perf_bench_start();
     while (!is_quit && cpu_thread_run) {
         /* See if it is time to run a frame of code. */
         const uint64_t new_time = elapsed_timer.elapsed();
@@ -446,6 +450,10 @@ main_thread_fn()
             drawits = 10;
         else
 #endif
+        if (unthrottled)
+            /* Run back to back, emulated time is decoupled from the host clock. */
+            drawits = 10;
+        else
             drawits += static_cast<int>(new_time - old_time);
         old_time = new_time;
         if (drawits > 0 && !dopause) {
@@ -460,6 +468,9 @@ main_thread_fn()
             /* Run a block of code. */
             pc_run();
 
+            if (perf_bench_enabled && perf_bench_done())
+                perf_bench_finish();
+
 #ifdef USE_INSTRUMENT
             if (instru_enabled) {
                 uint64_t elapsed_us       = (elapsed_timer.nsecsElapsed() - start_time) / 1000;
@@ -797,5 +808,5 @@ main(int argc, char *argv[])
     endblit();
 
     socket.close();
-    return ret;
+    return perf_bench_enabled ? perf_bench_get_exit_code() : ret;
 }
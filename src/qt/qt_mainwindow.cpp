@@ -346,6 +346,7 @@ MainWindow::MainWindow(QWidget *parent)
 
     ui->actionKeyboard_requires_capture->setChecked(kbd_req_capture);
     ui->actionRight_CTRL_is_left_ALT->setChecked(rctrl_is_lalt);
+    ui->actionUnthrottled->setChecked(unthrottled);
     ui->actionResizable_window->setChecked(vid_resize == 1);
     ui->actionRemember_size_and_position->setChecked(window_remember);
     ui->menuWindow_scale_factor->setEnabled(vid_resize == 0);
@@ -999,6 +1000,12 @@ MainWindow::on_actionPause_triggered()
     plat_pause(dopause ^ 1);
 }
 
+void
+MainWindow::on_actionUnthrottled_triggered()
+{
+    unthrottled ^= 1;
+}
+
 void
 MainWindow::on_actionExit_triggered()
 {
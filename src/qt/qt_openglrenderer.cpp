@@ -67,6 +67,16 @@ extern bool cpu_thread_running;
 #define SCALE_VIEWPORT 1
 #define SCALE_ABSOLUTE 2
 
+#define BUFFERBYTES (2048 * 2048 * 4)
+#define BUFFERCOUNT 2
+
+#ifndef GL_MAP_PERSISTENT_BIT
+#    define GL_MAP_PERSISTENT_BIT 0x0040
+#endif
+#ifndef GL_MAP_COHERENT_BIT
+#    define GL_MAP_COHERENT_BIT 0x0080
+#endif
+
 static GLfloat matrix[] = { 1, 0, 0, 0, 0, 1, 0, 0, 0, 0, 1, 0, 0, 0, 0, 1 };
 
 extern int video_filter_method;
@@ -897,6 +907,9 @@ OpenGLRenderer::initialize()
 
         create_texture(&scene_texture);
 
+        initializeExtensions();
+        initializeBuffers();
+
         /* load shader */
         //        const char* shaders[1];
         //        shaders[0] = gl3_shader_file;
@@ -1107,6 +1120,39 @@ OpenGLRenderer::initialize()
     }
 }
 
+void
+OpenGLRenderer::initializeExtensions()
+{
+#ifndef NO_BUFFER_STORAGE
+    if (context->hasExtension("GL_ARB_buffer_storage"))
+        glBufferStorage = reinterpret_cast<decltype(glBufferStorage)>(context->getProcAddress("glBufferStorage"));
+    else if (context->hasExtension("GL_EXT_buffer_storage"))
+        glBufferStorage = reinterpret_cast<decltype(glBufferStorage)>(context->getProcAddress("glBufferStorageEXT"));
+#endif
+}
+
+void
+OpenGLRenderer::initializeBuffers()
+{
+    if (!glBufferStorage)
+        return;
+
+    /* The blitter thread copies scanlines straight into GPU-visible memory,
+       and onBlit() only has to start the texture upload from it. */
+    glw.glGenBuffers(1, &unpackBufferID);
+    glw.glBindBuffer(GL_PIXEL_UNPACK_BUFFER, unpackBufferID);
+    glBufferStorage(GL_PIXEL_UNPACK_BUFFER, BUFFERBYTES * BUFFERCOUNT, NULL, GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT);
+    unpackBuffer = glw.glMapBufferRange(GL_PIXEL_UNPACK_BUFFER, 0, BUFFERBYTES * BUFFERCOUNT, GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT);
+    glw.glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+
+    if (unpackBuffer == nullptr) {
+        pclog("OpenGL: Couldn't map the pixel unpack buffer, using client memory\n");
+        glw.glDeleteBuffers(1, &unpackBufferID);
+        unpackBufferID = 0;
+    } else
+        pclog("OpenGL: Using persistently mapped pixel unpack buffers\n");
+}
+
 void
 OpenGLRenderer::finalize()
 {
@@ -1115,6 +1161,21 @@ OpenGLRenderer::finalize()
 
     context->makeCurrent(this);
 
+    for (auto &fence : unpackFence) {
+        if (fence)
+            glw.glDeleteSync(fence);
+        fence = nullptr;
+    }
+
+    if (unpackBuffer) {
+        glw.glBindBuffer(GL_PIXEL_UNPACK_BUFFER, unpackBufferID);
+        glw.glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+        glw.glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+        glw.glDeleteBuffers(1, &unpackBufferID);
+        unpackBuffer   = nullptr;
+        unpackBufferID = 0;
+    }
+
     delete_texture(&scene_texture);
 
     if (active_shader) {
@@ -1138,21 +1199,57 @@ OpenGLRenderer::onBlit(int buf_idx, int x, int y, int w, int h)
 
     context->makeCurrent(this);
 
+    int first = dirtyLines[buf_idx][0];
+    int last  = dirtyLines[buf_idx][1];
+
     if (source.width() != w || source.height() != h) {
         glw.glBindTexture(GL_TEXTURE_2D, scene_texture.id);
         glw.glTexImage2D(GL_TEXTURE_2D, 0, (GLenum) QOpenGLTexture::RGBA8_UNorm, w, h, 0, (GLenum) QOpenGLTexture::BGRA, (GLenum) QOpenGLTexture::UInt32_RGBA8_Rev, NULL);
         glw.glBindTexture(GL_TEXTURE_2D, 0);
+        fullUpload = true;
+    }
+
+    /* Lines outside the dirty range are the same in the texture already. */
+    if (fullUpload) {
+        first      = 0;
+        last       = h - 1;
+        fullUpload = false;
     }
 
     source.setRect(x, y, w, h);
 
-    glw.glBindTexture(GL_TEXTURE_2D, scene_texture.id);
-    glw.glPixelStorei(GL_UNPACK_ROW_LENGTH, 2048);
-    glw.glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, w, h, (GLenum) QOpenGLTexture::BGRA, (GLenum) QOpenGLTexture::UInt32_RGBA8_Rev, (const void *) ((uintptr_t) imagebufs[buf_idx].get() + (uintptr_t) (2048 * 4 * y + x * 4)));
-    glw.glPixelStorei(GL_UNPACK_ROW_LENGTH, 0);
-    glw.glBindTexture(GL_TEXTURE_2D, 0);
+    if ((first >= 0) && (last >= first)) {
+        uintptr_t offset = (uintptr_t) (2048 * 4 * (y + first) + x * 4);
+
+        glw.glBindTexture(GL_TEXTURE_2D, scene_texture.id);
+        glw.glPixelStorei(GL_UNPACK_ROW_LENGTH, 2048);
+        if (unpackBuffer) {
+            glw.glBindBuffer(GL_PIXEL_UNPACK_BUFFER, unpackBufferID);
+            glw.glTexSubImage2D(GL_TEXTURE_2D, 0, 0, first, w, last - first + 1, (GLenum) QOpenGLTexture::BGRA, (GLenum) QOpenGLTexture::UInt32_RGBA8_Rev, (const void *) ((uintptr_t) buf_idx * BUFFERBYTES + offset));
+            glw.glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+        } else
+            glw.glTexSubImage2D(GL_TEXTURE_2D, 0, 0, first, w, last - first + 1, (GLenum) QOpenGLTexture::BGRA, (GLenum) QOpenGLTexture::UInt32_RGBA8_Rev, (const void *) ((uintptr_t) imagebufs[buf_idx].get() + offset));
+        glw.glPixelStorei(GL_UNPACK_ROW_LENGTH, 0);
+        glw.glBindTexture(GL_TEXTURE_2D, 0);
+    }
 
-    buf_usage[buf_idx].clear();
+    if (unpackBuffer) {
+        /* The upload from a mapped buffer is asynchronous, so it goes back to
+           the blitter only once the GPU is done reading it. The other buffer
+           was handed over a frame earlier, so waiting for it costs nothing in
+           practice, and it is what keeps the blitter from running dry. */
+        unpackFence[buf_idx] = glw.glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+        for (int i = 0; i < BUFFERCOUNT; i++) {
+            if ((i == buf_idx) || !unpackFence[i])
+                continue;
+
+            glw.glClientWaitSync(unpackFence[i], GL_SYNC_FLUSH_COMMANDS_BIT, GL_TIMEOUT_IGNORED);
+            glw.glDeleteSync(unpackFence[i]);
+            unpackFence[i] = nullptr;
+            buf_usage[i].clear();
+        }
+    } else
+        buf_usage[buf_idx].clear();
     source.setRect(x, y, w, h);
     this->pixelRatio = devicePixelRatio();
     onResize(this->width(), this->height());
@@ -1174,12 +1271,24 @@ OpenGLRenderer::getBuffers()
 {
     std::vector<std::tuple<uint8_t *, std::atomic_flag *>> buffers;
 
-    buffers.push_back(std::make_tuple(imagebufs[0].get(), &buf_usage[0]));
-    buffers.push_back(std::make_tuple(imagebufs[1].get(), &buf_usage[1]));
+    if (unpackBuffer) {
+        for (int i = 0; i < BUFFERCOUNT; i++)
+            buffers.push_back(std::make_tuple((uint8_t *) unpackBuffer + (i * BUFFERBYTES), &buf_usage[i]));
+    } else {
+        buffers.push_back(std::make_tuple(imagebufs[0].get(), &buf_usage[0]));
+        buffers.push_back(std::make_tuple(imagebufs[1].get(), &buf_usage[1]));
+    }
 
     return buffers;
 }
 
+void
+OpenGLRenderer::setDirtyLines(int buf_idx, int first, int last)
+{
+    dirtyLines[buf_idx][0] = first;
+    dirtyLines[buf_idx][1] = last;
+}
+
 void
 OpenGLRenderer::exposeEvent(QExposeEvent *event)
 {
@@ -68,6 +68,7 @@ public:
     std::vector<std::tuple<uint8_t *, std::atomic_flag *>> getBuffers() override;
 
     void     finalize() override final;
+    void     setDirtyLines(int buf_idx, int first, int last) override;
     bool     hasOptions() const override { return true; }
     QDialog *getOptions(QWidget *parent) override;
     bool     reloadRendererOption() override { return true; }
@@ -102,7 +103,17 @@ private:
     struct shader_texture scene_texture;
     glsl_t *active_shader;
 
-    void *unpackBuffer = nullptr;
+    /* Persistently mapped pixel unpack buffer backing both image buffers,
+       if the context supports buffer storage; nullptr otherwise. */
+    void  *unpackBuffer   = nullptr;
+    GLuint unpackBufferID = 0;
+    GLsync unpackFence[2] = { nullptr, nullptr };
+
+    void(QOPENGLF_APIENTRYP glBufferStorage)(GLenum target, GLsizeiptr size, const void *data, GLbitfield flags) = nullptr;
+
+    /* Lines of each image buffer rewritten since it was last uploaded. */
+    int dirtyLines[2][2] = { { -1, -1 }, { -1, -1 } };
+    bool fullUpload      = true;
 
     int glsl_version[2] = { 0, 0 };
 
@@ -61,6 +61,8 @@
 #ifdef Q_OS_UNIX
 #    include <pthread.h>
 #    include <sys/mman.h>
+#    include <fcntl.h>
+#    include <unistd.h>
 #endif
 
 #ifdef Q_OS_OPENBSD
@@ -109,6 +111,7 @@ extern "C" {
 #        define NOMINMAX
 #    endif
 #    include <windows.h>
+#    include <io.h>
 #    include <86box/win.h>
 #else
 #    include <strings.h>
@@ -193,6 +196,12 @@ plat_get_ticks(void)
     return elapsed_timer.elapsed();
 }
 
+uint64_t
+plat_get_micro_ticks(void)
+{
+    return elapsed_timer.nsecsElapsed() / 1000;
+}
+
 uint64_t
 plat_timer_read(void)
 {
@@ -396,6 +405,121 @@ plat_munmap(void *ptr, size_t size)
 #endif
 }
 
+void *
+plat_mmap_ram(size_t size, const char *path)
+{
+#if defined Q_OS_WINDOWS
+    /* Large pages would need SeLockMemoryPrivilege, so plain pages are used. */
+    if ((path == nullptr) || (path[0] == '\0'))
+        return VirtualAlloc(NULL, size, MEM_RESERVE | MEM_COMMIT, PAGE_READWRITE);
+
+    HANDLE file = CreateFileW((LPCWSTR) QString::fromUtf8(path).utf16(), GENERIC_READ | GENERIC_WRITE,
+                              FILE_SHARE_READ | FILE_SHARE_WRITE, NULL, CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, NULL);
+    if (file == INVALID_HANDLE_VALUE)
+        return nullptr;
+    HANDLE map = CreateFileMappingW(file, NULL, PAGE_READWRITE, (DWORD) ((uint64_t) size >> 32), (DWORD) size, NULL);
+    CloseHandle(file);
+    if (map == NULL)
+        return nullptr;
+    /* The view keeps the section alive. */
+    void *ret = MapViewOfFile(map, FILE_MAP_ALL_ACCESS, 0, 0, size);
+    CloseHandle(map);
+    return ret;
+#elif defined Q_OS_UNIX
+    size_t   page = sysconf(_SC_PAGESIZE);
+    uint8_t *ret;
+
+    size = (size + page - 1) & ~(page - 1);
+
+    if ((path != nullptr) && (path[0] != '\0')) {
+        /* Shared file mapping, truncated first so it starts out zeroed. */
+        int fd = open(path, O_RDWR | O_CREAT, 0644);
+        if (fd < 0)
+            return nullptr;
+        if ((ftruncate(fd, 0) < 0) || (ftruncate(fd, size) < 0)) {
+            close(fd);
+            return nullptr;
+        }
+        ret = (uint8_t *) mmap(0, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+        close(fd);
+        return (ret == MAP_FAILED) ? nullptr : ret;
+    }
+
+#    ifdef MADV_HUGEPAGE
+    /* Over-allocate so the block can be aligned to a huge page, then trim. */
+    size_t    align = 2 << 20;
+    uintptr_t start;
+
+    ret = (uint8_t *) mmap(0, size + align, PROT_READ | PROT_WRITE, MAP_ANON | MAP_PRIVATE, -1, 0);
+    if (ret == MAP_FAILED)
+        return nullptr;
+    start = ((uintptr_t) ret + align - 1) & ~(uintptr_t) (align - 1);
+    if (start != (uintptr_t) ret)
+        munmap(ret, start - (uintptr_t) ret);
+    if ((uintptr_t) ret + align != start)
+        munmap((uint8_t *) start + size, (uintptr_t) ret + align - start);
+    ret = (uint8_t *) start;
+    madvise(ret, size, MADV_HUGEPAGE);
+#    else
+    ret = (uint8_t *) mmap(0, size, PROT_READ | PROT_WRITE, MAP_ANON | MAP_PRIVATE, -1, 0);
+    if (ret == MAP_FAILED)
+        return nullptr;
+#    endif
+
+    return ret;
+#endif
+}
+
+void
+plat_munmap_ram(void *ptr, size_t size)
+{
+#if defined Q_OS_WINDOWS
+    MEMORY_BASIC_INFORMATION mbi;
+
+    if (VirtualQuery(ptr, &mbi, sizeof(mbi)) && (mbi.Type == MEM_MAPPED))
+        UnmapViewOfFile(ptr);
+    else
+        VirtualFree(ptr, 0, MEM_RELEASE);
+#else
+    munmap(ptr, size);
+#endif
+}
+
+/* Maps the first size bytes of an open file read-only. */
+void *
+plat_mmap_file(FILE *fp, uint64_t size)
+{
+    if ((size == 0) || (size > SIZE_MAX))
+        return nullptr;
+
+#if defined Q_OS_WINDOWS
+    HANDLE map = CreateFileMappingW((HANDLE) _get_osfhandle(_fileno(fp)), NULL, PAGE_READONLY, 0, 0, NULL);
+    if (map == NULL)
+        return nullptr;
+    /* The view keeps the section alive. */
+    void *ret = MapViewOfFile(map, FILE_MAP_READ, 0, 0, (SIZE_T) size);
+    CloseHandle(map);
+    return ret;
+#elif defined Q_OS_UNIX
+    void *ret = mmap(0, (size_t) size, PROT_READ, MAP_PRIVATE, fileno(fp), 0);
+    if (ret == MAP_FAILED)
+        return nullptr;
+    return ret;
+#else
+    return nullptr;
+#endif
+}
+
+void
+plat_munmap_file(void *ptr, uint64_t size)
+{
+#if defined Q_OS_WINDOWS
+    UnmapViewOfFile(ptr);
+#elif defined Q_OS_UNIX
+    munmap(ptr, (size_t) size);
+#endif
+}
+
 extern bool cpu_thread_running;
 void
 plat_pause(int p)
@@ -416,7 +540,9 @@ plat_pause(int p)
         return;
     }
 
-    if ((p == 0) && (time_sync & TIME_SYNC_ENABLED))
+    /* Unthrottled, the RTC follows emulated time; do not make it jump
+       back to the host time. */
+    if ((p == 0) && (time_sync & TIME_SYNC_ENABLED) && !unthrottled)
         nvr_time_sync();
 
     do_pause(p);
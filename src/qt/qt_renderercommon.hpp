@@ -28,6 +28,11 @@ public:
         return buffers;
     }
 
+    /* Called from the blitter thread before a buffer is handed over with
+       onBlit(); first and last are the lines of the blitted area that were
+       rewritten, -1 if none. */
+    virtual void setDirtyLines(int buf_idx, int first, int last) { }
+
     /* Does renderer implement options dialog */
     virtual bool hasOptions() const { return false; }
     /* Returns options dialog for renderer */
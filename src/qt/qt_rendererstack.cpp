@@ -417,6 +417,7 @@ RendererStack::createRenderer(Renderer renderer)
     rendererWindow->r_monitor_index = m_monitor_index;
 
     currentBuf = 0;
+    bufSeq.clear();
 
     if (renderer != Renderer::OpenGL3 && renderer != Renderer::Vulkan) {
         imagebufs = rendererWindow->getBuffers();
@@ -441,15 +442,25 @@ RendererStack::blit(int x, int y, int w, int h)
     sw = this->w = w;
     sh = this->h       = h;
     uint8_t *imagebits = std::get<uint8_t *>(imagebufs[currentBuf]);
-    for (int y1 = y; y1 < (y + h); y1++) {
-        auto scanline = imagebits + (y1 * rendererWindow->getBytesPerRow()) + (x * 4);
-        video_copy(scanline, &(monitors[m_monitor_index].target_buffer->line[y1][x]), w * 4);
-    }
+    /* Each buffer only needs the lines that changed since it was last filled. */
+    if (bufSeq.size() != imagebufs.size())
+        bufSeq.assign(imagebufs.size(), 0);
+    int first;
+    int last;
+    int copied = video_blit_copy_monitor(imagebits + (y * rendererWindow->getBytesPerRow()) + (x * 4),
+                                         rendererWindow->getBytesPerRow(), &bufSeq[currentBuf], &first, &last, m_monitor_index);
 
     if (monitors[m_monitor_index].mon_screenshots && !rendererTakesScreenshots) {
         video_screenshot_monitor((uint32_t *) imagebits, x, y, 2048, m_monitor_index);
+    } else if (!copied && !monitors[m_monitor_index].mon_screenshots) {
+        /* Nothing changed since this buffer was last shown, so neither
+           does what is on screen; skip the upload. */
+        std::get<std::atomic_flag *>(imagebufs[currentBuf])->clear();
+        video_blit_complete_monitor(m_monitor_index);
+        return;
     }
     video_blit_complete_monitor(m_monitor_index);
+    rendererWindow->setDirtyLines(currentBuf, first, last);
     emit blitToRenderer(currentBuf, sx, sy, sw, sh);
     currentBuf = (currentBuf + 1) % imagebufs.size();
 }
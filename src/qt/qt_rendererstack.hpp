@@ -131,6 +131,7 @@ private:
     int m_monitor_index = 0;
 
     std::vector<std::tuple<uint8_t *, std::atomic_flag *>> imagebufs;
+    std::vector<uint32_t>                                  bufSeq;
 
     RendererCommon          *rendererWindow { nullptr };
     std::unique_ptr<QWidget> current;
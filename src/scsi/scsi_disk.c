@@ -772,21 +772,23 @@ scsi_disk_blocks(scsi_disk_t *dev, int32_t *len, UNUSED(int first_batch), const
 
     *len = dev->requested_blocks << 9;
 
-    for (int i = 0; i < dev->requested_blocks; i++) {
-        if (out) {
+    if (out) {
+        for (int i = 0; i < dev->requested_blocks; i++) {
             if (hdd_image_write(dev->id, dev->sector_pos, 1, dev->temp_buffer +
                                 (i << 9)) < 0) {
                 scsi_disk_write_error(dev);
                 return -1;
             }
-        } else {
-            if (hdd_image_read(dev->id, dev->sector_pos, 1, dev->temp_buffer +
-                               (i << 9)) < 0) {
-                scsi_disk_read_error(dev);
-                return -1;
-            }
+            dev->sector_pos++;
         }
-        dev->sector_pos++;
+    } else {
+        /* Collects the read started when the command was issued, if any. */
+        if (hdd_image_read_finish(dev->id, dev->sector_pos, dev->requested_blocks,
+                                  dev->temp_buffer) < 0) {
+            scsi_disk_read_error(dev);
+            return -1;
+        }
+        dev->sector_pos += dev->requested_blocks;
     }
 
     scsi_disk_log(dev->log, "%s %i bytes of blocks...\n", out ? "Written" : "Read", *len);
@@ -1100,6 +1102,11 @@ scsi_disk_command(scsi_common_t *sc, const uint8_t *cdb)
                     dev->drv->seek_pos = dev->sector_pos;
                     dev->drv->seek_len = dev->sector_len;
 
+                    /* Same start/finish pair as the IDE path; reads past the end
+                       of the image are left to scsi_disk_blocks() to reject. */
+                    if (((uint64_t) dev->sector_pos + dev->sector_len - 1) <= last_sector)
+                        hdd_image_read_start(dev->id, dev->sector_pos, dev->sector_len);
+
                     ret          = scsi_disk_blocks(dev, &alloc_length, 1, 0);
                     alloc_length = dev->requested_blocks * 512;
 
@@ -0,0 +1,362 @@
+/*
+ * 86Box    A hypervisor and IBM PC system emulator that specializes in
+ *          running old operating systems and software designed for IBM
+ *          PC systems and compatibles from 1981 through fairly recent
+ *          system designs based on the PCI bus.
+ *
+ *          This file is part of the 86Box distribution.
+ *
+ *          Machine state snapshots (save states).
+ *
+ *          A snapshot file is a fixed header identifying the machine
+ *          it was taken from, followed by a list of sections. Every
+ *          section starts with a tag, an instance number and the byte
+ *          length of its payload:
+ *
+ *            "CPU " - CPU, FPU and MSR state, TSC;
+ *            "MEM " - memory mappings, shadow state and the RAM itself;
+ *            "PIC " - both 8259 PIC's;
+ *            "DMA " - both 8237 DMA controllers and page registers;
+ *            "DEV " - one per device, written by the device_t hooks.
+ *
+ *          A snapshot can only be restored into the same machine
+ *          configuration it was taken from, and only machines whose
+ *          devices all implement the save state hooks can be saved.
+ *          So far that is the PIT's and the AT NVR, the remaining
+ *          devices are converted one at a time. Until a whole machine
+ *          is covered nothing in the UI, monitor or command line
+ *          saves or restores a snapshot.
+ */
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <wchar.h>
+#define HAVE_STDARG_H
+#include <86box/86box.h>
+#include "cpu.h"
+#include <86box/device.h>
+#include <86box/machine.h>
+#include <86box/mem.h>
+#include <86box/plat.h>
+#include <86box/timer.h>
+#include <86box/snapshot.h>
+
+#define SNAPSHOT_NAME_LEN 64
+
+typedef struct snapshot_header_t {
+    char     magic[8];
+    uint32_t version;
+    uint32_t mem_size;
+    char     machine[SNAPSHOT_NAME_LEN];
+    char     cpu_family[SNAPSHOT_NAME_LEN];
+    int32_t  cpu;
+    int32_t  fpu_type;
+} snapshot_header_t;
+
+struct snapshot_t {
+    FILE   *fp;
+    int     error;
+    int64_t section_start;
+    int64_t section_end;
+};
+
+#ifdef ENABLE_SNAPSHOT_LOG
+int snapshot_do_log = ENABLE_SNAPSHOT_LOG;
+
+static void
+snapshot_log(const char *fmt, ...)
+{
+    va_list ap;
+
+    if (snapshot_do_log) {
+        va_start(ap, fmt);
+        pclog_ex(fmt, ap);
+        va_end(ap);
+    }
+}
+#else
+#    define snapshot_log(fmt, ...)
+#endif
+
+void
+snapshot_write(snapshot_t *s, const void *data, size_t size)
+{
+    if (s->error || !size)
+        return;
+
+    if (fwrite(data, 1, size, s->fp) != size)
+        s->error = 1;
+}
+
+void
+snapshot_read(snapshot_t *s, void *data, size_t size)
+{
+    if (s->error || !size)
+        return;
+
+    /* Never read past the end of the current section. */
+    if ((s->section_end > 0) && ((ftello64(s->fp) + (int64_t) size) > s->section_end)) {
+        s->error = 1;
+        return;
+    }
+
+    if (fread(data, 1, size, s->fp) != size)
+        s->error = 1;
+}
+
+int
+snapshot_error(snapshot_t *s)
+{
+    return s->error;
+}
+
+void
+snapshot_set_error(snapshot_t *s)
+{
+    s->error = 1;
+}
+
+void
+snapshot_begin_section(snapshot_t *s, uint32_t tag, uint32_t inst)
+{
+    uint64_t len = 0ULL;
+
+    snapshot_write_var(s, tag);
+    snapshot_write_var(s, inst);
+    s->section_start = ftello64(s->fp);
+    /* Placeholder, patched by snapshot_end_section(). */
+    snapshot_write_var(s, len);
+}
+
+void
+snapshot_end_section(snapshot_t *s)
+{
+    int64_t  end = ftello64(s->fp);
+    uint64_t len = end - s->section_start - sizeof(uint64_t);
+
+    if (s->error)
+        return;
+
+    if (fseeko64(s->fp, s->section_start, SEEK_SET) != 0) {
+        s->error = 1;
+        return;
+    }
+    snapshot_write_var(s, len);
+    if (fseeko64(s->fp, end, SEEK_SET) != 0)
+        s->error = 1;
+}
+
+int
+snapshot_enter_section(snapshot_t *s, uint32_t tag, uint32_t inst)
+{
+    uint32_t ftag  = 0;
+    uint32_t finst = 0;
+    uint64_t len   = 0ULL;
+
+    s->section_end = 0;
+    snapshot_read_var(s, ftag);
+    snapshot_read_var(s, finst);
+    snapshot_read_var(s, len);
+
+    if (s->error || (ftag != tag) || (finst != inst)) {
+        snapshot_log("Snapshot: expected section %.4s/%i, found %.4s/%i\n",
+                     (char *) &tag, inst, (char *) &ftag, finst);
+        s->error = 1;
+        return 0;
+    }
+
+    s->section_end = ftello64(s->fp) + len;
+
+    return 1;
+}
+
+void
+snapshot_leave_section(snapshot_t *s)
+{
+    /* A reader that consumed less than the section holds is a format
+       mismatch, do not silently go on with the next one. */
+    if (!s->error && (ftello64(s->fp) != s->section_end))
+        s->error = 1;
+
+    s->section_end = 0;
+}
+
+void
+snapshot_write_timer(snapshot_t *s, const pc_timer_t *timer)
+{
+    uint64_t ts    = timer->ts.ts64;
+    int32_t  flags = timer->flags & (TIMER_ENABLED | TIMER_SPLIT);
+    double   period = timer->period;
+
+    snapshot_write_var(s, ts);
+    snapshot_write_var(s, flags);
+    snapshot_write_var(s, period);
+}
+
+void
+snapshot_read_timer(snapshot_t *s, pc_timer_t *timer)
+{
+    uint64_t ts     = 0ULL;
+    int32_t  flags  = 0;
+    double   period = 0.0;
+
+    snapshot_read_var(s, ts);
+    snapshot_read_var(s, flags);
+    snapshot_read_var(s, period);
+
+    if (s->error)
+        return;
+
+    timer_disable(timer);
+    timer->ts.ts64 = ts;
+    timer->period  = period;
+    timer->flags   = (timer->flags & ~TIMER_SPLIT) | (flags & TIMER_SPLIT);
+    if (flags & TIMER_ENABLED)
+        timer_enable(timer);
+}
+
+static void
+snapshot_fill_header(snapshot_header_t *hdr)
+{
+    memset(hdr, 0x00, sizeof(snapshot_header_t));
+
+    memcpy(hdr->magic, SNAPSHOT_MAGIC, sizeof(hdr->magic));
+    hdr->version  = SNAPSHOT_VERSION;
+    hdr->mem_size = mem_size;
+    strncpy(hdr->machine, machine_get_internal_name(), SNAPSHOT_NAME_LEN - 1);
+    strncpy(hdr->cpu_family, cpu_f->internal_name, SNAPSHOT_NAME_LEN - 1);
+    hdr->cpu      = cpu;
+    hdr->fpu_type = fpu_type;
+}
+
+int
+snapshot_supported(void)
+{
+    const device_t *dev = device_find_unsaveable();
+
+    if (dev != NULL) {
+        pclog("Snapshot: device '%s' does not support save states\n", dev->name);
+        return 0;
+    }
+
+    return 1;
+}
+
+int
+snapshot_save(const char *fn)
+{
+    snapshot_header_t hdr;
+    snapshot_t        s;
+
+    if (!snapshot_supported()) {
+        pclog("Snapshot: the current machine configuration does not support save states\n");
+        return -1;
+    }
+
+    memset(&s, 0x00, sizeof(snapshot_t));
+    s.fp = plat_fopen64(fn, "wb");
+    if (s.fp == NULL) {
+        pclog("Snapshot: unable to create '%s'\n", fn);
+        return -1;
+    }
+
+    snapshot_fill_header(&hdr);
+    snapshot_write_var(&s, hdr);
+
+    snapshot_begin_section(&s, SNAPSHOT_TAG('C', 'P', 'U', ' '), 0);
+    cpu_save_state(&s);
+    snapshot_end_section(&s);
+
+    snapshot_begin_section(&s, SNAPSHOT_TAG('M', 'E', 'M', ' '), 0);
+    mem_save_state(&s);
+    snapshot_end_section(&s);
+
+    snapshot_begin_section(&s, SNAPSHOT_TAG('P', 'I', 'C', ' '), 0);
+    pic_save_state(&s);
+    snapshot_end_section(&s);
+
+    snapshot_begin_section(&s, SNAPSHOT_TAG('D', 'M', 'A', ' '), 0);
+    dma_save_state(&s);
+    snapshot_end_section(&s);
+
+    device_save_state_all(&s);
+
+    fclose(s.fp);
+
+    if (s.error) {
+        pclog("Snapshot: error writing '%s'\n", fn);
+        remove(fn);
+        return -1;
+    }
+
+    snapshot_log("Snapshot: machine state saved to '%s'\n", fn);
+
+    return 0;
+}
+
+int
+snapshot_load(const char *fn)
+{
+    snapshot_header_t hdr;
+    snapshot_header_t cur;
+    snapshot_t        s;
+
+    if (!snapshot_supported()) {
+        pclog("Snapshot: the current machine configuration does not support save states\n");
+        return -1;
+    }
+
+    memset(&s, 0x00, sizeof(snapshot_t));
+    s.fp = plat_fopen64(fn, "rb");
+    if (s.fp == NULL) {
+        pclog("Snapshot: unable to open '%s'\n", fn);
+        return -1;
+    }
+
+    /* Refuse anything that was not taken from this exact configuration,
+       before touching any of the machine state. */
+    snapshot_read_var(&s, hdr);
+    snapshot_fill_header(&cur);
+    if (s.error || memcmp(&hdr, &cur, sizeof(snapshot_header_t))) {
+        pclog("Snapshot: '%s' is not a compatible save state for this machine\n", fn);
+        fclose(s.fp);
+        return -1;
+    }
+
+    if (snapshot_enter_section(&s, SNAPSHOT_TAG('C', 'P', 'U', ' '), 0)) {
+        cpu_load_state(&s);
+        snapshot_leave_section(&s);
+    }
+
+    if (snapshot_enter_section(&s, SNAPSHOT_TAG('M', 'E', 'M', ' '), 0)) {
+        mem_load_state(&s);
+        snapshot_leave_section(&s);
+    }
+
+    if (snapshot_enter_section(&s, SNAPSHOT_TAG('P', 'I', 'C', ' '), 0)) {
+        pic_load_state(&s);
+        snapshot_leave_section(&s);
+    }
+
+    if (snapshot_enter_section(&s, SNAPSHOT_TAG('D', 'M', 'A', ' '), 0)) {
+        dma_load_state(&s);
+        snapshot_leave_section(&s);
+    }
+
+    device_load_state_all(&s);
+
+    fclose(s.fp);
+
+    if (s.error) {
+        /* The machine is now in an undefined state, start over. */
+        pclog("Snapshot: error reading '%s', resetting the machine\n", fn);
+        pc_reset_hard();
+        return -1;
+    }
+
+    snapshot_log("Snapshot: machine state restored from '%s'\n", fn);
+
+    return 0;
+}
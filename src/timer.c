@@ -1,90 +1,139 @@
 #include <stdio.h>
 #include <stdint.h>
+#include <stdlib.h>
 #include <string.h>
 #include <wchar.h>
 #include <86box/86box.h>
 #include "cpu.h"
 #include <86box/timer.h>
+#include <86box/perf.h>
 #include <86box/nv/vid_nv_rivatimer.h>
 
 uint64_t TIMER_USEC;
 uint32_t timer_target;
 
-/*Enabled timers are stored in a linked list, with the first timer to expire at
-  the head.*/
-pc_timer_t *timer_head = NULL;
+/*Enabled timers are stored in a binary min-heap, with the first timer to
+  expire at index 1. Each timer records its own heap index (0 when it is not
+  queued), so removal of an arbitrary timer is O(log n) as well. Timers with
+  identical timestamps are ordered most-recently-enabled first, which is what
+  the old sorted list did.*/
+static pc_timer_t **timer_heap      = NULL;
+static uint32_t     timer_heap_size = 0;
+static uint32_t     timer_heap_max  = 0;
+static uint32_t     timer_seq       = 0;
 
 /* Are we initialized? */
 int timer_inited = 0;
 
 static void timer_advance_ex(pc_timer_t *timer, int start);
 
+/*True if timer a must fire before timer b*/
+static __inline int
+timer_heap_before(pc_timer_t *a, pc_timer_t *b)
+{
+    if (a->ts.ts64 == b->ts.ts64)
+        return (int32_t) (a->seq - b->seq) > 0;
+
+    return TIMER_LESS_THAN(a, b);
+}
+
+static __inline void
+timer_heap_place(pc_timer_t *timer, uint32_t idx)
+{
+    timer_heap[idx]  = timer;
+    timer->heap_idx = idx;
+}
+
+static void
+timer_heap_up(uint32_t idx)
+{
+    pc_timer_t *timer = timer_heap[idx];
+
+    while (idx > 1) {
+        uint32_t parent = idx >> 1;
+
+        if (!timer_heap_before(timer, timer_heap[parent]))
+            break;
+
+        timer_heap_place(timer_heap[parent], idx);
+        idx = parent;
+    }
+
+    timer_heap_place(timer, idx);
+}
+
+static void
+timer_heap_down(uint32_t idx)
+{
+    pc_timer_t *timer = timer_heap[idx];
+
+    while (1) {
+        uint32_t child = idx << 1;
+
+        if (child > timer_heap_size)
+            break;
+
+        if ((child < timer_heap_size) && timer_heap_before(timer_heap[child + 1], timer_heap[child]))
+            child++;
+
+        if (!timer_heap_before(timer_heap[child], timer))
+            break;
+
+        timer_heap_place(timer_heap[child], idx);
+        idx = child;
+    }
+
+    timer_heap_place(timer, idx);
+}
+
+/*Remove the timer at the given heap index, keeping the heap ordered*/
+static void
+timer_heap_remove(uint32_t idx)
+{
+    pc_timer_t *last = timer_heap[timer_heap_size];
+
+    timer_heap[idx]->heap_idx = 0;
+    timer_heap[timer_heap_size--] = NULL;
+
+    if (idx > timer_heap_size)
+        return;
+
+    timer_heap_place(last, idx);
+    if ((idx > 1) && timer_heap_before(last, timer_heap[idx >> 1]))
+        timer_heap_up(idx);
+    else
+        timer_heap_down(idx);
+}
+
 void
 timer_enable(pc_timer_t *timer)
 {
-    pc_timer_t *timer_node = timer_head;
-    int ret = 0;
-
     if (!timer_inited || (timer == NULL))
         return;
 
     if (timer->flags & TIMER_ENABLED)
         timer_disable(timer);
 
-    if (timer->next || timer->prev)
-        fatal("timer_disable(): Attempting to enable a non-isolated "
+    if (timer->heap_idx)
+        fatal("timer_enable(): Attempting to enable a non-isolated "
               "timer incorrectly marked as disabled\n");
 
-    /*List currently empty - add to head*/
-    if (!timer_head) {
-        timer_head  = timer;
-        timer->next = timer->prev = NULL;
-        timer_target              = timer_head->ts.ts32.integer;
-        ret = 1;
-    } else if (TIMER_LESS_THAN(timer, timer_head)) {
-        timer->next      = timer_head;
-        timer->prev      = NULL;
-        timer_head->prev = timer;
-        timer_head       = timer;
-        timer_target     = timer_head->ts.ts32.integer;
-        ret = 1;
-    } else if (!timer_head->next) {
-        timer_head->next = timer;
-        timer->prev      = timer_head;
-        ret = 1;
+    if (timer_heap_size == timer_heap_max) {
+        timer_heap_max = timer_heap_max ? (timer_heap_max << 1) : 64;
+        /* Index 0 is unused so that a heap index of 0 means "not queued". */
+        timer_heap = (pc_timer_t **) realloc(timer_heap, (timer_heap_max + 1) * sizeof(pc_timer_t *));
+        if (timer_heap == NULL)
+            fatal("timer_enable(): Unable to grow the timer heap\n");
     }
 
-    if (ret == 0) {
-        pc_timer_t *prev = timer_head;
-        timer_node       = timer_head->next;
-
-        while (1) {
-            /*Timer expires before timer_node. Add to list in front of timer_node*/
-            if (TIMER_LESS_THAN(timer, timer_node)) {
-                timer->next      = timer_node;
-                timer->prev      = prev;
-                timer_node->prev = timer;
-                prev->next       = timer;
-                ret = 1;
-                break;
-            }
-
-            /*timer_node is last in the list. Add timer to end of list*/
-            if (!timer_node->next) {
-                timer_node->next = timer;
-                timer->prev      = timer_node;
-                ret = 1;
-                break;
-            }
-
-            prev       = timer_node;
-            timer_node = timer_node->next;
-        }
-    }
+    timer->seq = ++timer_seq;
+    timer_heap[++timer_heap_size] = timer;
+    timer_heap_up(timer_heap_size);
 
-    /* Do not mark it as enabled if it has failed every single condition. */
-    if (ret == 1)
-        timer->flags |= TIMER_ENABLED;
+    if (timer->heap_idx == 1)
+        timer_target = timer->ts.ts32.integer;
+
+    timer->flags |= TIMER_ENABLED;
 }
 
 void
@@ -93,20 +142,14 @@ timer_disable(pc_timer_t *timer)
     if (!timer_inited || (timer == NULL) || !(timer->flags & TIMER_ENABLED))
         return;
 
-    if (!timer->next && !timer->prev && timer != timer_head)
+    if (!timer->heap_idx || (timer->heap_idx > timer_heap_size) || (timer_heap[timer->heap_idx] != timer))
         fatal("timer_disable(): Attempting to disable an isolated "
-              "non-head timer incorrectly marked as enabled\n");
+              "timer incorrectly marked as enabled\n");
 
     timer->flags &= ~TIMER_ENABLED;
     timer->in_callback = 0;
 
-    if (timer->prev)
-        timer->prev->next = timer->next;
-    else
-        timer_head = timer->next;
-    if (timer->next)
-        timer->next->prev = timer->prev;
-    timer->prev = timer->next = NULL;
+    timer_heap_remove(timer->heap_idx);
 }
 
 void
@@ -114,20 +157,16 @@ timer_process(void)
 {
     pc_timer_t *timer;
 
-    if (!timer_head)
+    if (!timer_heap_size)
         return;
 
-    while (1) {
-        timer = timer_head;
+    while (timer_heap_size) {
+        timer = timer_heap[1];
 
         if (!TIMER_LESS_THAN_VAL(timer, (uint32_t) tsc))
             break;
 
-        timer_head = timer->next;
-        if (timer_head)
-            timer_head->prev = NULL;
-
-        timer->next = timer->prev = NULL;
+        timer_heap_remove(1);
         timer->flags &= ~TIMER_ENABLED;
 
         if (timer->flags & TIMER_SPLIT)
@@ -138,30 +177,29 @@ timer_process(void)
                have a NULL callback when no operation
                is needed. */
             timer->in_callback = 1;
+            perf_counters.timer_callbacks++;
             timer->callback(timer->priv);
             timer->in_callback = 0;
         }
     }
 
-    timer_target = timer_head->ts.ts32.integer;
+    if (timer_heap_size)
+        timer_target = timer_heap[1]->ts.ts32.integer;
 }
 
 void
 timer_close(void)
 {
-    pc_timer_t *t = timer_head;
-    pc_timer_t *r;
-
-    /* Set all timers' prev and next to NULL so it is assured that
-       timers that are not in malloc'd structs don't keep pointing
-       to timers that may be in malloc'd structs. */
-    while (t != NULL) {
-        r       = t;
-        r->prev = r->next = NULL;
-        t                 = r->next;
-    }
+    /* Mark all queued timers as isolated so it is assured that timers
+       that are not in malloc'd structs don't keep pointing into a heap
+       that may be reused by timers in malloc'd structs. */
+    for (uint32_t i = 1; i <= timer_heap_size; i++)
+        timer_heap[i]->heap_idx = 0;
 
-    timer_head = NULL;
+    free(timer_heap);
+    timer_heap      = NULL;
+    timer_heap_size = 0;
+    timer_heap_max  = 0;
 
     timer_inited = 0;
 }
@@ -187,7 +225,7 @@ timer_add(pc_timer_t *timer, void (*callback)(void *priv), void *priv, int start
     timer->in_callback = 0;
     timer->priv        = priv;
     timer->flags       = 0;
-    timer->prev        = timer->next = NULL;
+    timer->heap_idx    = 0;
     if (start_timer)
         timer_set_delay_u64(timer, 0);
 }
@@ -264,26 +302,24 @@ timer_on_auto(pc_timer_t *timer, double period)
 void
 timer_set_new_tsc(uint64_t new_tsc)
 {
-    pc_timer_t *timer = NULL;
     /* Run timers already expired. */
 #ifdef USE_DYNAREC
     if (cpu_use_dynarec)
         update_tsc();
 #endif
 
-    if (!timer_head) {
+    if (!timer_heap_size) {
         tsc = new_tsc;
         return;
     }
 
-    timer = timer_head;
-    timer_target = new_tsc + (int32_t)(timer_get_ts_int(timer_head) - (uint32_t)tsc);
+    timer_target = new_tsc + (int32_t)(timer_get_ts_int(timer_heap[1]) - (uint32_t)tsc);
 
-    while (timer) {
+    /* Every timer is shifted by the same amount, so the heap stays ordered. */
+    for (uint32_t i = 1; i <= timer_heap_size; i++) {
+        pc_timer_t *timer = timer_heap[i];
         int32_t offset_from_current_tsc = (int32_t)(timer_get_ts_int(timer) - (uint32_t)tsc);
         timer->ts.ts32.integer = new_tsc + offset_from_current_tsc;
-
-        timer = timer->next;
     }
 
     tsc = new_tsc;
@@ -16,6 +16,7 @@
 #include <sys/types.h>
 #include <sys/stat.h>
 #include <sys/mman.h>
+#include <fcntl.h>
 #include <unistd.h>
 #include <errno.h>
 #include <inttypes.h>
@@ -44,6 +45,7 @@
 #include "cpu.h"
 #include <86box/timer.h>
 #include <86box/nvr.h>
+#include <86box/perf.h>
 #include <86box/version.h>
 #include <86box/video.h>
 #include <86box/ui.h>
@@ -426,6 +428,81 @@ plat_munmap(void *ptr, size_t size)
     munmap(ptr, size);
 }
 
+void *
+plat_mmap_ram(size_t size, const char *path)
+{
+    size_t   page = sysconf(_SC_PAGESIZE);
+    uint8_t *ret;
+    int      fd;
+
+    size = (size + page - 1) & ~(page - 1);
+
+    if ((path != NULL) && (path[0] != '\0')) {
+        /* Shared file mapping, truncated first so it starts out zeroed. */
+        fd = open(path, O_RDWR | O_CREAT, 0644);
+        if (fd < 0)
+            return NULL;
+        if ((ftruncate(fd, 0) < 0) || (ftruncate(fd, size) < 0)) {
+            close(fd);
+            return NULL;
+        }
+        ret = mmap(0, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+        close(fd);
+        return (ret == MAP_FAILED) ? NULL : ret;
+    }
+
+#ifdef MADV_HUGEPAGE
+    /* Over-allocate so the block can be aligned to a huge page, then trim. */
+    size_t    align = 2 << 20;
+    uintptr_t start;
+
+    ret = mmap(0, size + align, PROT_READ | PROT_WRITE, MAP_ANON | MAP_PRIVATE, -1, 0);
+    if (ret == MAP_FAILED)
+        return NULL;
+    start = ((uintptr_t) ret + align - 1) & ~(uintptr_t) (align - 1);
+    if (start != (uintptr_t) ret)
+        munmap(ret, start - (uintptr_t) ret);
+    if ((uintptr_t) ret + align != start)
+        munmap((uint8_t *) start + size, (uintptr_t) ret + align - start);
+    ret = (uint8_t *) start;
+    madvise(ret, size, MADV_HUGEPAGE);
+#else
+    ret = mmap(0, size, PROT_READ | PROT_WRITE, MAP_ANON | MAP_PRIVATE, -1, 0);
+    if (ret == MAP_FAILED)
+        return NULL;
+#endif
+
+    return ret;
+}
+
+void
+plat_munmap_ram(void *ptr, size_t size)
+{
+    munmap(ptr, size);
+}
+
+/* Maps the first size bytes of an open file read-only. */
+void *
+plat_mmap_file(FILE *fp, uint64_t size)
+{
+    void *ret;
+
+    if ((size == 0) || (size > SIZE_MAX))
+        return NULL;
+
+    ret = mmap(0, (size_t) size, PROT_READ, MAP_PRIVATE, fileno(fp), 0);
+    if (ret == MAP_FAILED)
+        return NULL;
+
+    return ret;
+}
+
+void
+plat_munmap_file(void *ptr, uint64_t size)
+{
+    munmap(ptr, (size_t) size);
+}
+
 uint64_t
 plat_timer_read(void)
 {
@@ -455,6 +532,12 @@ plat_get_ticks(void)
     return (uint32_t) (plat_get_ticks_common() / 1000);
 }
 
+uint64_t
+plat_get_micro_ticks(void)
+{
+    return plat_get_ticks_common();
+}
+
 void
 plat_remove(char *path)
 {
@@ -549,6 +632,9 @@ main_thread(UNUSED(void *param))
     // title_update = 1;
     old_time = SDL_GetTicks();
     drawits = frames = 0;
+    perf_thread_register("cpu");
+    if (perf_bench_enabled)
+        perf_bench_start();
     while (!is_quit && cpu_thread_run) {
         /* See if it is time to run a frame of code. */
         new_time = SDL_GetTicks();
@@ -557,6 +643,10 @@ main_thread(UNUSED(void *param))
             drawits = 10;
         else
 #endif
+        if (unthrottled)
+            /* Run back to back, emulated time is decoupled from the host clock. */
+            drawits = 10;
+        else
             drawits += (new_time - old_time);
         old_time = new_time;
         if (drawits > 0 && !dopause) {
@@ -568,6 +658,9 @@ main_thread(UNUSED(void *param))
             /* Run a block of code. */
             pc_run();
 
+            if (perf_bench_enabled && perf_bench_done())
+                perf_bench_finish();
+
             /* Every 200 frames we save the machine status. */
             if (++frames >= 200 && nvr_dosave) {
                 nvr_save();
@@ -587,7 +680,11 @@ main_thread(UNUSED(void *param))
         }
     }
 
-    is_quit = 1;
+    /* Let the event thread shut the machine down through do_stop(). */
+    if (perf_bench_enabled)
+        exit_event = 1;
+    else
+        is_quit = 1;
 }
 
 thread_t *thMain = NULL;
@@ -765,7 +862,9 @@ plat_pause(int p)
     if ((!!p) == dopause)
         return;
 
-    if ((p == 0) && (time_sync & TIME_SYNC_ENABLED))
+    /* Unthrottled, the RTC follows emulated time; do not make it jump
+       back to the host time. */
+    if ((p == 0) && (time_sync & TIME_SYNC_ENABLED) && !unthrottled)
         nvr_time_sync();
 
     do_pause(p);
@@ -978,6 +1077,8 @@ monitor_thread(UNUSED(void *param))
                         "moeject <id> - eject image from MO drive <id>.\n\n"
                         "hardreset - hard reset the emulated system.\n"
                         "pause - pause the the emulated system.\n"
+                        "unthrottle - toggle running the emulated system as fast as possible.\n"
+                        "dynareccache <size> - set the dynarec code cache size in MB (0 = maximum).\n"
                         "fullscreen - toggle fullscreen.\n"
                         "version - print version and license information.\n"
                         "exit - exit 86Box.\n");
@@ -1025,6 +1126,14 @@ monitor_thread(UNUSED(void *param))
                 } else if (strncasecmp(xargv[0], "pause", 5) == 0) {
                     plat_pause(dopause ^ 1);
                     printf("%s", dopause ? "Paused.\n" : "Unpaused.\n");
+                } else if (strncasecmp(xargv[0], "unthrottle", 10) == 0) {
+                    unthrottled ^= 1;
+                    printf("%s", unthrottled ? "Unthrottled.\n" : "Throttled.\n");
+                } else if (strncasecmp(xargv[0], "dynareccache", 12) == 0 && cmdargc >= 2) {
+                    cpu_dynarec_cache_size = atoi(xargv[1]);
+                    if (cpu_dynarec_cache_size < 0)
+                        cpu_dynarec_cache_size = 0;
+                    config_save();
                 } else if (strncasecmp(xargv[0], "hardreset", 9) == 0) {
                     pc_reset_hard();
                 } else if (strncasecmp(xargv[0], "cdload", 6) == 0 && cmdargc >= 3) {
@@ -1215,7 +1324,9 @@ main(int argc, char **argv)
     } else
         fprintf(stderr, "libedit not found, line editing will be limited.\n");
     mousemutex = SDL_CreateMutex();
-    sdl_initho();
+    /* The benchmark mode is headless, without a renderer nothing is blitted. */
+    if (!perf_bench_enabled)
+        sdl_initho();
 
     if (start_in_fullscreen) {
         video_fullscreen = 1;
@@ -1370,7 +1481,7 @@ main(int argc, char **argv)
     SDL_Quit();
     if (f_rl_callback_handler_remove)
         f_rl_callback_handler_remove();
-    return 0;
+    return perf_bench_enabled ? perf_bench_get_exit_code() : 0;
 }
 char *
 plat_vidapi_name(UNUSED(int i))
@@ -52,6 +52,7 @@ int                 resize_pending    = 0;
 int                 resize_w          = 0;
 int                 resize_h          = 0;
 static void        *pixeldata;
+static uint32_t     pixeldata_seq;
 
 extern void RenderImGui(void);
 static void
@@ -152,8 +153,7 @@ sdl_blit_shim(int x, int y, int w, int h, int monitor_index)
     params.h = h;
 
     if (!(!sdl_enabled || (x < 0) || (y < 0) || (w <= 0) || (h <= 0) || (w > 2048) || (h > 2048) || (buffer32 == NULL) || (sdl_render == NULL) || (sdl_tex == NULL)) || (monitor_index >= 1))
-        for (int row = 0; row < h; ++row)
-            video_copy(&(((uint8_t *) pixeldata)[row * 2048 * sizeof(uint32_t)]), &(buffer32->line[y + row][x]), w * sizeof(uint32_t));
+        video_blit_copy_monitor((uint8_t *) pixeldata, 2048 * sizeof(uint32_t), &pixeldata_seq, NULL, NULL, monitor_index);
 
     if (monitors[monitor_index].mon_screenshots)
         video_screenshot((uint32_t *) pixeldata, 0, 0, 2048);
@@ -435,7 +435,8 @@ sdl_init_common(int flags)
     /* Make sure we get a clean exit. */
     atexit(sdl_close);
 
-    pixeldata = malloc(2048 * 2048 * 4);
+    pixeldata     = malloc(2048 * 2048 * 4);
+    pixeldata_seq = 0;
 
     /* Register our renderer! */
     video_setblit(sdl_blit_shim);
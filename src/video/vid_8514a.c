@@ -3786,9 +3786,16 @@ ibm8514_poll(void *priv)
                 ibm8514_render_overscan_right(dev, svga);
                 svga->x_add = (overscan_x >> 1);
 
+                /* The renderers move lastline_draw onto the lines they redraw;
+                   svga_doblit() only hands marked lines on to the blitter. */
+                if ((dev->lastline_draw == dev->displine) || dev->hwcursor_on)
+                    svga->dirty_lines[(dev->displine + svga->y_add) & 0x7ff] = 1;
+
                 if (dev->hwcursor_on) {
-                    if (svga->hwcursor_draw)
+                    if (svga->hwcursor_draw) {
                         svga->hwcursor_draw(svga, (dev->displine + svga->y_add + ((dev->hwcursor_latch.y >= 0) ? 0 : dev->hwcursor_latch.y)) & 2047);
+                        svga->dirty_lines[(dev->displine + svga->y_add + ((dev->hwcursor_latch.y >= 0) ? 0 : dev->hwcursor_latch.y)) & 0x7ff] = 1;
+                    }
                     dev->hwcursor_on--;
                     if (dev->hwcursor_on && dev->interlace)
                         dev->hwcursor_on--;
@@ -21,6 +21,8 @@
  */
 #include <inttypes.h>
 #include <stdarg.h>
+#include <stdatomic.h>
+#include <stddef.h>
 #include <stdio.h>
 #include <stdint.h>
 #include <stdlib.h>
@@ -37,6 +39,7 @@
 #include <86box/mem.h>
 #include <86box/rom.h>
 #include <86box/plat.h>
+#include <86box/thread.h>
 #include <86box/ui.h>
 #include <86box/video.h>
 #include <86box/vid_8514a.h>
@@ -182,6 +185,8 @@ svga_out(uint16_t addr, uint8_t val, void *priv)
     uint8_t    index;
     uint8_t    pal4to16[16] = { 0, 7, 0x38, 0x3f, 0, 3, 4, 0x3f, 0, 2, 4, 0x3e, 0, 3, 5, 0x3f };
 
+    svga->render_gen++;
+
     if ((addr >= 0x2ea) && (addr <= 0x2ed)) {
         if (!dev)
             return;
@@ -670,6 +675,7 @@ svga_set_ramdac_type(svga_t *svga, int type)
                                              (svga->vgapal[c].g & 0x3f) * 4,
                                              (svga->vgapal[c].b & 0x3f) * 4);
         }
+        svga->render_gen++;
     }
 }
 
@@ -702,6 +708,8 @@ svga_recalctimings(svga_t *svga)
     int              old_monitor_overscan_x = svga->monitor->mon_overscan_x;
     int              old_monitor_overscan_y = svga->monitor->mon_overscan_y;
 
+    svga->render_gen++;
+
     svga->vtotal      = svga->crtc[6];
     svga->dispend     = svga->crtc[0x12];
     svga->vsyncstart  = svga->crtc[0x10];
@@ -1167,7 +1175,7 @@ svga_recalctimings(svga_t *svga)
 }
 
 static void
-svga_do_render(svga_t *svga)
+svga_do_render_line(svga_t *svga)
 {
     /* Always render a blank screen and nothing else while in DPMS mode. */
     if (svga->dpms) {
@@ -1210,6 +1218,245 @@ svga_do_render(svga_t *svga)
     }
 }
 
+static void
+svga_do_render(svga_t *svga, uint8_t *dirty_lines)
+{
+    int drawn  = svga->lastline_draw;
+    int cursor = svga->overlay_on || svga->dac_hwcursor_on || svga->hwcursor_on;
+    int line   = (svga->displine + svga->y_add) & 0x7ff;
+
+    /* The renderers only update lastline_draw on lines they actually
+       redraw, which is what tells the blitter which lines changed. */
+    svga->lastline_draw = -1;
+
+    svga_do_render_line(svga);
+
+    if (svga->lastline_draw == -1)
+        svga->lastline_draw = drawn;
+    else
+        cursor = 1;
+
+    if (cursor && !svga->override)
+        dirty_lines[line] = 1;
+}
+
+/* The render worker keeps its own copy of svga_t, taken again whenever
+   render_gen changes (port writes, recalctimings, palette writes) and at
+   the start of every frame. Each queued scanline carries only the fields
+   svga_poll() changes from one line to the next, so raster effects (mid-
+   frame palette, start address or mode changes) come out the same. VRAM
+   itself is not snapshotted; the worker is drained at the end of the
+   active display, before changedvram is aged and before the blit.
+
+   Lines with a hardware cursor or overlay on them are drawn on the CPU
+   thread, as those callbacks read live card state. The renderers advance
+   firstline_draw/lastline_draw, so the worker owns those and carries them
+   from one line to the next. */
+#define SVGA_RENDER_JOBS 64
+#define SVGA_RENDER_MASK (SVGA_RENDER_JOBS - 1)
+
+typedef struct svga_render_job_t {
+    uint32_t ma;
+    uint32_t ca;
+    int      displine;
+    int      y_add;
+    int      x_add;
+    int      scrollcache;
+    int      sc;
+    int      con;
+    int      cursoron;
+    int      blink;
+    int      fullchange;
+} svga_render_job_t;
+
+typedef struct svga_render_worker_t {
+    svga_t  *svga;
+    svga_t  *shadow;
+    uint32_t shadow_gen; /* render_gen the shadow was taken at */
+    int      shadow_valid;
+
+    svga_render_job_t jobs[SVGA_RENDER_JOBS];
+
+    int firstline_draw;
+    int lastline_draw;
+
+    /* The index updates publish the job (and the worker's results) to the
+       other side, so they must be atomic, not just volatile. */
+    atomic_int read_idx;
+    atomic_int write_idx;
+    atomic_int run;
+
+    thread_t *thread;
+    event_t  *wake_event;
+    event_t  *done_event;
+} svga_render_worker_t;
+
+#define RENDER_ENTRIES(w) (atomic_load(&(w)->write_idx) - atomic_load(&(w)->read_idx))
+
+static void
+svga_render_thread_func(void *priv)
+{
+    svga_render_worker_t *w      = (svga_render_worker_t *) priv;
+    svga_t               *shadow = w->shadow;
+    svga_render_job_t    *job;
+
+    while (atomic_load(&w->run)) {
+        thread_wait_event(w->wake_event, -1);
+        thread_reset_event(w->wake_event);
+
+        while (RENDER_ENTRIES(w)) {
+            job = &w->jobs[atomic_load(&w->read_idx) & SVGA_RENDER_MASK];
+
+            shadow->ma          = job->ma;
+            shadow->ca          = job->ca;
+            shadow->displine    = job->displine;
+            shadow->y_add       = job->y_add;
+            shadow->x_add       = job->x_add;
+            shadow->scrollcache = job->scrollcache;
+            shadow->sc          = job->sc;
+            shadow->con         = job->con;
+            shadow->cursoron    = job->cursoron;
+            shadow->blink       = job->blink;
+            shadow->fullchange  = job->fullchange;
+
+            shadow->firstline_draw = w->firstline_draw;
+            shadow->lastline_draw  = w->lastline_draw;
+
+            svga_do_render(shadow, w->svga->dirty_lines);
+
+            w->firstline_draw = shadow->firstline_draw;
+            w->lastline_draw  = shadow->lastline_draw;
+
+            atomic_fetch_add(&w->read_idx, 1);
+            thread_set_event(w->done_event);
+        }
+    }
+}
+
+/* Waits for the worker to finish every queued line. */
+static void
+svga_render_sync(svga_t *svga)
+{
+    svga_render_worker_t *w = svga->render_worker;
+
+    while (RENDER_ENTRIES(w)) {
+        thread_reset_event(w->done_event);
+        if (RENDER_ENTRIES(w))
+            thread_wait_event(w->done_event, -1);
+    }
+
+    svga->firstline_draw = w->firstline_draw;
+    svga->lastline_draw  = w->lastline_draw;
+}
+
+/* Hands the state the worker owns back to it, after svga_poll() has
+   reloaded it or rendered a line itself; the worker must be drained. */
+static void
+svga_render_reset(svga_t *svga)
+{
+    svga_render_worker_t *w = svga->render_worker;
+
+    w->firstline_draw = svga->firstline_draw;
+    w->lastline_draw  = svga->lastline_draw;
+}
+
+static void
+svga_render_queue(svga_t *svga)
+{
+    svga_render_worker_t *w = svga->render_worker;
+    svga_render_job_t    *job;
+
+    if (!w->shadow_valid || (w->shadow_gen != svga->render_gen)) {
+        /* The worker may still be reading the old copy. */
+        svga_render_sync(svga);
+
+        memcpy(w->shadow, svga, offsetof(svga_t, dirty_lines));
+        if (w->shadow->map8 == svga->pallook)
+            w->shadow->map8 = w->shadow->pallook;
+        w->shadow->hwcursor_on     = 0;
+        w->shadow->dac_hwcursor_on = 0;
+        w->shadow->overlay_on      = 0;
+
+        w->shadow_gen   = svga->render_gen;
+        w->shadow_valid = 1;
+    }
+
+    while (RENDER_ENTRIES(w) == SVGA_RENDER_JOBS) {
+        thread_reset_event(w->done_event);
+        if (RENDER_ENTRIES(w) == SVGA_RENDER_JOBS)
+            thread_wait_event(w->done_event, -1);
+    }
+
+    job              = &w->jobs[atomic_load(&w->write_idx) & SVGA_RENDER_MASK];
+    job->ma          = svga->ma;
+    job->ca          = svga->ca;
+    job->displine    = svga->displine;
+    job->y_add       = svga->y_add;
+    job->x_add       = svga->x_add;
+    job->scrollcache = svga->scrollcache;
+    job->sc          = svga->sc;
+    job->con         = svga->con;
+    job->cursoron    = svga->cursoron;
+    job->blink       = svga->blink;
+    job->fullchange  = svga->fullchange;
+
+    atomic_fetch_add(&w->write_idx, 1);
+    thread_set_event(w->wake_event);
+}
+
+static void
+svga_render_scanline(svga_t *svga)
+{
+    if (!svga->render_worker)
+        svga_do_render(svga, svga->dirty_lines);
+    else if (svga->render_override || svga->hwcursor_on || svga->dac_hwcursor_on || svga->overlay_on) {
+        /* The override renders through the parent device, and the cursor
+           and overlay callbacks read live card state, not svga_t. */
+        svga_render_sync(svga);
+        svga_do_render(svga, svga->dirty_lines);
+        svga_render_reset(svga);
+    } else
+        svga_render_queue(svga);
+}
+
+static void
+svga_render_worker_init(svga_t *svga)
+{
+    svga_render_worker_t *w = calloc(1, sizeof(svga_render_worker_t));
+
+    w->svga           = svga;
+    w->shadow         = calloc(1, sizeof(svga_t));
+    w->firstline_draw = 2000;
+    atomic_init(&w->read_idx, 0);
+    atomic_init(&w->write_idx, 0);
+    atomic_init(&w->run, 1);
+    w->wake_event     = thread_create_event();
+    w->done_event     = thread_create_event();
+
+    svga->render_worker = w;
+
+    w->thread = thread_create(svga_render_thread_func, w);
+}
+
+static void
+svga_render_worker_close(svga_t *svga)
+{
+    svga_render_worker_t *w = svga->render_worker;
+
+    svga_render_sync(svga);
+
+    atomic_store(&w->run, 0);
+    thread_set_event(w->wake_event);
+    thread_wait(w->thread);
+
+    thread_destroy_event(w->wake_event);
+    thread_destroy_event(w->done_event);
+    free(w->shadow);
+    free(w);
+
+    svga->render_worker = NULL;
+}
+
 void
 svga_poll(void *priv)
 {
@@ -1275,18 +1522,18 @@ svga_poll(void *priv)
                 svga->displine <<= 1;
                 svga->y_add <<= 1;
 
-                svga_do_render(svga);
+                svga_render_scanline(svga);
 
                 svga->displine++;
 
                 svga->ma = old_ma;
 
-                svga_do_render(svga);
+                svga_render_scanline(svga);
 
                 svga->y_add >>= 1;
                 svga->displine >>= 1;
             } else
-                svga_do_render(svga);
+                svga_render_scanline(svga);
 
             if (svga->lastline < svga->displine)
                 svga->lastline = svga->displine;
@@ -1345,8 +1592,10 @@ svga_poll(void *priv)
         if (svga->vc == svga->split) {
             ret = 1;
 
-            if (svga->line_compare)
+            if (svga->line_compare) {
                 ret = svga->line_compare(svga);
+                svga->render_gen++;
+            }
 
             if (ret) {
                 if (svga->interlace && svga->oddeven)
@@ -1365,6 +1614,9 @@ svga_poll(void *priv)
             }
         }
         if (svga->vc == svga->dispend) {
+            if (svga->render_worker)
+                svga_render_sync(svga);
+
             if (svga->vblank_start)
                 svga->vblank_start(svga);
 
@@ -1402,6 +1654,9 @@ svga_poll(void *priv)
 
             wx = x;
 
+            if (svga->render_worker)
+                svga_render_sync(svga);
+
             if (!svga->override) {
                 if (svga->vertical_linedbl) {
                     wy = (svga->lastline - svga->firstline) << 1;
@@ -1444,6 +1699,9 @@ svga_poll(void *priv)
         if (svga->vc == lines_num) {
 #endif
         if (svga->vc == svga->vtotal) {
+            if (svga->render_worker)
+                svga_render_sync(svga);
+
             svga->vc       = 0;
             svga->sc       = (svga->crtc[0x8] & 0x1f);
             svga->dispon   = 1;
@@ -1478,6 +1736,13 @@ svga_poll(void *priv)
 
             svga->overlay_on    = 0;
             svga->overlay_latch = svga->overlay;
+
+            if (svga->render_worker) {
+                svga_render_reset(svga);
+                /* Card registers written without bumping render_gen are
+                   picked up here, once a frame. */
+                svga->render_worker->shadow_valid = 0;
+            }
         }
         if (svga->sc == (svga->crtc[10] & 31))
             svga->con = 1;
@@ -1511,6 +1776,7 @@ svga_init(const device_t *info, svga_t *svga, void *priv, int memsize,
             e                 = (e >> 1) | ((e & 1) ? 0x80 : 0);
         }
     }
+    svga_render_span_init();
     svga->readmode = 0;
 
     svga->attrregs[0x11] = 0;
@@ -1596,12 +1862,18 @@ svga_init(const device_t *info, svga_t *svga, void *priv, int memsize,
 
     svga->map8            = svga->pallook;
 
+    if (svga_render_thread)
+        svga_render_worker_init(svga);
+
     return 0;
 }
 
 void
 svga_close(svga_t *svga)
 {
+    if (svga->render_worker)
+        svga_render_worker_close(svga);
+
     free(svga->changedvram);
     free(svga->vram);
 
@@ -1972,6 +2244,8 @@ svga_doblit(int wx, int wy, svga_t *svga)
     int       j;
     int       xs_temp;
     int       ys_temp;
+    int       line;
+    uint32_t  col;
 
     y_add   = enable_overscan ? svga->monitor->mon_overscan_y : 0;
     x_add   = enable_overscan ? svga->monitor->mon_overscan_x : 0;
@@ -2024,23 +2298,25 @@ svga_doblit(int wx, int wy, svga_t *svga)
     }
 
     if ((wx >= 160) && ((wy + 1) >= 120)) {
-        /* Draw (overscan_size - scroll size) lines of overscan on top and bottom. */
-        for (i = 0; i < svga->y_add; i++) {
-            p = &svga->monitor->target_buffer->line[i & 0x7ff][0];
-
-            for (j = 0; j < (svga->monitor->mon_xsize + x_add); j++)
-                p[j] = svga->dpms ? 0 : svga->overscan_color;
-        }
+        col = svga->dpms ? 0 : svga->overscan_color;
 
-        for (i = 0; i < bottom; i++) {
-            p = &svga->monitor->target_buffer->line[(svga->monitor->mon_ysize + svga->y_add + i) & 0x7ff][0];
-
-            for (j = 0; j < (svga->monitor->mon_xsize + x_add); j++)
-                p[j] = svga->dpms ? 0 : svga->overscan_color;
+        /* Draw (overscan_size - scroll size) lines of overscan on top and bottom. */
+        for (i = 0; i < (svga->y_add + bottom); i++) {
+            line = ((i < svga->y_add) ? i : (svga->monitor->mon_ysize + i)) & 0x7ff;
+            p    = &svga->monitor->target_buffer->line[line][0];
+
+            for (j = 0; j < (svga->monitor->mon_xsize + x_add); j++) {
+                if (p[j] != col) {
+                    p[j]                    = col;
+                    svga->dirty_lines[line] = 1;
+                }
+            }
         }
     }
 
-    video_blit_memtoscreen_monitor(x_start, y_start, svga->monitor->mon_xsize + x_add, svga->monitor->mon_ysize + y_add, svga->monitor_index);
+    video_blit_memtoscreen_dirty_monitor(x_start, y_start, svga->monitor->mon_xsize + x_add, svga->monitor->mon_ysize + y_add,
+                                         svga->dirty_lines, svga->monitor_index);
+    memset(svga->dirty_lines, 0x00, sizeof(svga->dirty_lines));
 
     if (svga->vertical_linedbl)
         svga->vertical_linedbl >>= 1;
@@ -92,6 +92,18 @@ svga_render_blank(svga_t *svga)
         memset(line_ptr, 0, line_width);
 }
 
+/* The side borders are repainted on every line, mark the line as drawn when
+   that changes it (overscan colour or palette change) so it gets blitted. */
+static void
+svga_render_overscan_mark(svga_t *svga, const uint32_t *line_ptr, int count)
+{
+    if ((count > 0) && (line_ptr[0] != svga->overscan_color)) {
+        if (svga->firstline_draw == 2000)
+            svga->firstline_draw = svga->displine;
+        svga->lastline_draw = svga->displine;
+    }
+}
+
 void
 svga_render_overscan_left(svga_t *svga)
 {
@@ -102,6 +114,7 @@ svga_render_overscan_left(svga_t *svga)
         return;
 
     uint32_t *line_ptr = svga->monitor->target_buffer->line[svga->displine + svga->y_add];
+    svga_render_overscan_mark(svga, line_ptr, svga->x_add);
     for (int i = 0; i < svga->x_add; i++)
         *line_ptr++ = svga->overscan_color;
 }
@@ -119,6 +132,7 @@ svga_render_overscan_right(svga_t *svga)
 
     uint32_t *line_ptr = &svga->monitor->target_buffer->line[svga->displine + svga->y_add][svga->x_add + svga->hdisp];
     right              = (overscan_x >> 1);
+    svga_render_overscan_mark(svga, line_ptr, right);
     for (int i = 0; i < right; i++)
         *line_ptr++ = svga->overscan_color;
 }
@@ -146,11 +160,11 @@ svga_render_text_40(svga_t *svga)
     if ((svga->displine + svga->y_add) < 0)
         return;
 
-    if (svga->firstline_draw == 2000)
-        svga->firstline_draw = svga->displine;
-    svga->lastline_draw = svga->displine;
-
     if (svga->fullchange) {
+        if (svga->firstline_draw == 2000)
+            svga->firstline_draw = svga->displine;
+        svga->lastline_draw = svga->displine;
+
         p    = &svga->monitor->target_buffer->line[svga->displine + svga->y_add][svga->x_add];
         xinc = (svga->seqregs[1] & 1) ? 16 : 18;
 
@@ -229,11 +243,11 @@ svga_render_text_80(svga_t *svga)
     if ((svga->displine + svga->y_add) < 0)
         return;
 
-    if (svga->firstline_draw == 2000)
-        svga->firstline_draw = svga->displine;
-    svga->lastline_draw = svga->displine;
-
     if (svga->fullchange) {
+        if (svga->firstline_draw == 2000)
+            svga->firstline_draw = svga->displine;
+        svga->lastline_draw = svga->displine;
+
         p    = &svga->monitor->target_buffer->line[svga->displine + svga->y_add][svga->x_add];
         xinc = (svga->seqregs[1] & 1) ? 8 : 9;
 
@@ -307,11 +321,11 @@ svga_render_text_80_ksc5601(svga_t *svga)
     if ((svga->displine + svga->y_add) < 0)
         return;
 
-    if (svga->firstline_draw == 2000)
-        svga->firstline_draw = svga->displine;
-    svga->lastline_draw = svga->displine;
-
     if (svga->fullchange) {
+        if (svga->firstline_draw == 2000)
+            svga->firstline_draw = svga->displine;
+        svga->lastline_draw = svga->displine;
+
         p = &svga->monitor->target_buffer->line[svga->displine + svga->y_add][svga->x_add];
 
         xinc = (svga->seqregs[1] & 1) ? 8 : 9;
@@ -748,6 +762,22 @@ svga_render_indexed_gfx(svga_t *svga, bool highres, bool combine8bits)
         svga->firstline_draw = svga->displine;
     svga->lastline_draw = svga->displine;
 
+    /*
+       Packed 8bpp that loads and shows every byte as one pixel, with all planes
+       enabled and no blink, is a straight palette lookup of the VRAM bytes, so
+       hand the whole line to the span converter.
+     */
+    if (combine8bits && shift4bit && !svga->packed_4bpp && !svga->ati_4color && !svga->force_old_addr &&
+        !svga->remap_required && (incevery == 1) && (loadevery == 1) && (planemask == 0xffffffff) && !blinkmask &&
+        !(svga->vram_display_mask & (svga->vram_display_mask + 1))) {
+        x = (((svga->hdisp + svga->scrollcache) / charwidth) + 1) << 2;
+        svga_render_span_8bpp(svga, p, svga->ma, x);
+        if (!highres)
+            svga_render_span_double(p, x);
+        svga->ma = (svga->ma + x) & svga->vram_display_mask;
+        return;
+    }
+
     uint32_t incr_counter = 0;
     uint32_t load_counter = 0;
     uint32_t edat         = 0;
@@ -962,22 +992,9 @@ svga_render_8bpp_clone_highres(svga_t *svga)
             svga->lastline_draw = svga->displine;
 
             if (!svga->remap_required) {
-                for (x = 0; x <= (svga->hdisp /* + svga->scrollcache*/); x += 8) {
-                    dat  = *(uint32_t *) (&svga->vram[svga->ma & svga->vram_display_mask]);
-                    p[0] = svga->map8[dat & svga->dac_mask & 0xff];
-                    p[1] = svga->map8[(dat >> 8) & svga->dac_mask & 0xff];
-                    p[2] = svga->map8[(dat >> 16) & svga->dac_mask & 0xff];
-                    p[3] = svga->map8[(dat >> 24) & svga->dac_mask & 0xff];
-
-                    dat  = *(uint32_t *) (&svga->vram[(svga->ma + 4) & svga->vram_display_mask]);
-                    p[4] = svga->map8[dat & svga->dac_mask & 0xff];
-                    p[5] = svga->map8[(dat >> 8) & svga->dac_mask & 0xff];
-                    p[6] = svga->map8[(dat >> 16) & svga->dac_mask & 0xff];
-                    p[7] = svga->map8[(dat >> 24) & svga->dac_mask & 0xff];
-
-                    svga->ma += 8;
-                    p += 8;
-                }
+                x = (svga->hdisp & ~7) + 8;
+                svga_render_span_8bpp(svga, p, svga->ma, x);
+                svga->ma += x;
             } else {
                 for (x = 0; x <= (svga->hdisp /* + svga->scrollcache*/); x += 4) {
                     addr = svga->remap_func(svga, svga->ma);
@@ -1298,17 +1315,8 @@ svga_render_15bpp_lowres(svga_t *svga)
             svga->lastline_draw = svga->displine;
 
             if (!svga->remap_required) {
-                for (x = 0; x <= (svga->hdisp + svga->scrollcache); x += 4) {
-                    dat = *(uint32_t *) (&svga->vram[(svga->ma + (x << 1)) & svga->vram_display_mask]);
-
-                    *p++ = svga->conv_16to32(svga, dat & 0xffff, 15);
-                    *p++ = svga->conv_16to32(svga, dat >> 16, 15);
-
-                    dat = *(uint32_t *) (&svga->vram[(svga->ma + (x << 1) + 4) & svga->vram_display_mask]);
-
-                    *p++ = svga->conv_16to32(svga, dat & 0xffff, 15);
-                    *p++ = svga->conv_16to32(svga, dat >> 16, 15);
-                }
+                x = ((svga->hdisp + svga->scrollcache) & ~3) + 4;
+                svga_render_span_16bpp(svga, p, svga->ma, x, 15);
                 svga->ma += x << 1;
             } else {
                 for (x = 0; x <= (svga->hdisp + svga->scrollcache); x += 2) {
@@ -1376,23 +1384,8 @@ svga_render_15bpp_highres(svga_t *svga)
             svga->lastline_draw = svga->displine;
 
             if (!svga->remap_required) {
-                for (x = 0; x <= (svga->hdisp + svga->scrollcache); x += 8) {
-                    dat  = *(uint32_t *) (&svga->vram[(svga->ma + (x << 1)) & svga->vram_display_mask]);
-                    *p++ = svga->conv_16to32(svga, dat & 0xffff, 15);
-                    *p++ = svga->conv_16to32(svga, dat >> 16, 15);
-
-                    dat  = *(uint32_t *) (&svga->vram[(svga->ma + (x << 1) + 4) & svga->vram_display_mask]);
-                    *p++ = svga->conv_16to32(svga, dat & 0xffff, 15);
-                    *p++ = svga->conv_16to32(svga, dat >> 16, 15);
-
-                    dat  = *(uint32_t *) (&svga->vram[(svga->ma + (x << 1) + 8) & svga->vram_display_mask]);
-                    *p++ = svga->conv_16to32(svga, dat & 0xffff, 15);
-                    *p++ = svga->conv_16to32(svga, dat >> 16, 15);
-
-                    dat  = *(uint32_t *) (&svga->vram[(svga->ma + (x << 1) + 12) & svga->vram_display_mask]);
-                    *p++ = svga->conv_16to32(svga, dat & 0xffff, 15);
-                    *p++ = svga->conv_16to32(svga, dat >> 16, 15);
-                }
+                x = ((svga->hdisp + svga->scrollcache) & ~7) + 8;
+                svga_render_span_16bpp(svga, p, svga->ma, x, 15);
                 svga->ma += x << 1;
             } else {
                 for (x = 0; x <= (svga->hdisp + svga->scrollcache); x += 2) {
@@ -1530,17 +1523,8 @@ svga_render_16bpp_lowres(svga_t *svga)
             svga->lastline_draw = svga->displine;
 
             if (!svga->remap_required) {
-                for (x = 0; x <= (svga->hdisp + svga->scrollcache); x += 4) {
-                    dat = *(uint32_t *) (&svga->vram[(svga->ma + (x << 1)) & svga->vram_display_mask]);
-
-                    *p++ = svga->conv_16to32(svga, dat & 0xffff, 16);
-                    *p++ = svga->conv_16to32(svga, dat >> 16, 16);
-
-                    dat = *(uint32_t *) (&svga->vram[(svga->ma + (x << 1) + 4) & svga->vram_display_mask]);
-
-                    *p++ = svga->conv_16to32(svga, dat & 0xffff, 16);
-                    *p++ = svga->conv_16to32(svga, dat >> 16, 16);
-                }
+                x = ((svga->hdisp + svga->scrollcache) & ~3) + 4;
+                svga_render_span_16bpp(svga, p, svga->ma, x, 16);
                 svga->ma += x << 1;
             } else {
                 for (x = 0; x <= (svga->hdisp + svga->scrollcache); x += 2) {
@@ -1608,23 +1592,8 @@ svga_render_16bpp_highres(svga_t *svga)
             svga->lastline_draw = svga->displine;
 
             if (!svga->remap_required) {
-                for (x = 0; x <= (svga->hdisp + svga->scrollcache); x += 8) {
-                    dat  = *(uint32_t *) (&svga->vram[(svga->ma + (x << 1)) & svga->vram_display_mask]);
-                    *p++ = svga->conv_16to32(svga, dat & 0xffff, 16);
-                    *p++ = svga->conv_16to32(svga, dat >> 16, 16);
-
-                    dat  = *(uint32_t *) (&svga->vram[(svga->ma + (x << 1) + 4) & svga->vram_display_mask]);
-                    *p++ = svga->conv_16to32(svga, dat & 0xffff, 16);
-                    *p++ = svga->conv_16to32(svga, dat >> 16, 16);
-
-                    dat  = *(uint32_t *) (&svga->vram[(svga->ma + (x << 1) + 8) & svga->vram_display_mask]);
-                    *p++ = svga->conv_16to32(svga, dat & 0xffff, 16);
-                    *p++ = svga->conv_16to32(svga, dat >> 16, 16);
-
-                    dat  = *(uint32_t *) (&svga->vram[(svga->ma + (x << 1) + 12) & svga->vram_display_mask]);
-                    *p++ = svga->conv_16to32(svga, dat & 0xffff, 16);
-                    *p++ = svga->conv_16to32(svga, dat >> 16, 16);
-                }
+                x = ((svga->hdisp + svga->scrollcache) & ~7) + 8;
+                svga_render_span_16bpp(svga, p, svga->ma, x, 16);
                 svga->ma += x << 1;
             } else {
                 for (x = 0; x <= (svga->hdisp + svga->scrollcache); x += 2) {
@@ -1769,18 +1738,9 @@ svga_render_24bpp_highres(svga_t *svga)
             svga->lastline_draw = svga->displine;
 
             if (!svga->remap_required) {
-                for (x = 0; x <= (svga->hdisp + svga->scrollcache); x += 4) {
-                    dat0 = *(uint32_t *) (&svga->vram[svga->ma & svga->vram_display_mask]);
-                    dat1 = *(uint32_t *) (&svga->vram[(svga->ma + 4) & svga->vram_display_mask]);
-                    dat2 = *(uint32_t *) (&svga->vram[(svga->ma + 8) & svga->vram_display_mask]);
-
-                    *p++ = lookup_lut(dat0 & 0xffffff);
-                    *p++ = lookup_lut((dat0 >> 24) | ((dat1 & 0xffff) << 8));
-                    *p++ = lookup_lut((dat1 >> 16) | ((dat2 & 0xff) << 16));
-                    *p++ = lookup_lut(dat2 >> 8);
-
-                    svga->ma += 12;
-                }
+                x = ((svga->hdisp + svga->scrollcache) & ~3) + 4;
+                svga_render_span_24bpp(svga, p, svga->ma, x);
+                svga->ma += x * 3;
             } else {
                 for (x = 0; x <= (svga->hdisp + svga->scrollcache); x += 4) {
                     addr = svga->remap_func(svga, svga->ma);
@@ -1839,11 +1799,9 @@ svga_render_32bpp_lowres(svga_t *svga)
             svga->lastline_draw = svga->displine;
 
             if (!svga->remap_required) {
-                for (x = 0; x <= (svga->hdisp + svga->scrollcache); x++) {
-                    dat  = *(uint32_t *) (&svga->vram[(svga->ma + (x << 2)) & svga->vram_display_mask]);
-                    *p++ = lookup_lut(dat & 0xffffff);
-                    *p++ = lookup_lut(dat & 0xffffff);
-                }
+                x = svga->hdisp + svga->scrollcache + 1;
+                svga_render_span_32bpp(svga, p, svga->ma, x);
+                svga_render_span_double(p, x);
                 svga->ma += (x * 4);
             } else {
                 for (x = 0; x <= (svga->hdisp + svga->scrollcache); x++) {
@@ -1897,10 +1855,8 @@ svga_render_32bpp_highres(svga_t *svga)
             svga->lastline_draw = svga->displine;
 
             if (!svga->remap_required) {
-                for (x = 0; x <= (svga->hdisp + svga->scrollcache); x++) {
-                    dat  = *(uint32_t *) (&svga->vram[(svga->ma + (x << 2)) & svga->vram_display_mask]);
-                    *p++ = lookup_lut(dat & 0xffffff);
-                }
+                x = svga->hdisp + svga->scrollcache + 1;
+                svga_render_span_32bpp(svga, p, svga->ma, x);
                 svga->ma += (x * 4);
             } else {
                 for (x = 0; x <= (svga->hdisp + svga->scrollcache); x++) {
@@ -0,0 +1,368 @@
+/*
+ * 86Box    A hypervisor and IBM PC system emulator that specializes in
+ *          running old operating systems and software designed for IBM
+ *          PC systems and compatibles from 1981 through fairly recent
+ *          system designs based on the PCI bus.
+ *
+ *          This file is part of the 86Box distribution.
+ *
+ *          SVGA scanline span converters, with SSE2 and AVX2 versions
+ *          picked at run time.
+ *
+ *          Each converter turns a run of VRAM into target buffer pixels
+ *          and must give exactly the same result as the C version, which
+ *          in turn matches what the per-pixel renderer loops used to do.
+ *          Runs that wrap around the end of VRAM are always done pixel
+ *          by pixel.
+ *
+ *          Building with ENABLE_SVGA_SPAN_CHECK runs the C version
+ *          next to whichever version was picked on every span and
+ *          stops with a fatal error on the first pixel that differs.
+ *
+ *
+ *
+ *          Copyright 2026 The 86Box development team
+ */
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include <wchar.h>
+#include <86box/86box.h>
+#include <86box/device.h>
+#include <86box/mem.h>
+#include <86box/timer.h>
+#include <86box/video.h>
+#include <86box/vid_svga.h>
+#include <86box/vid_svga_render.h>
+
+#if (defined __amd64__ || defined _M_X64 || defined __i386__ || defined _M_IX86) && defined __GNUC__
+#    define USE_SPAN_SIMD
+#    include <immintrin.h>
+#endif
+
+static void
+span_8bpp_c(uint32_t *p, const uint8_t *src, int n, const uint32_t *pal, uint32_t mask)
+{
+    for (int x = 0; x < n; x++)
+        p[x] = pal[src[x] & mask];
+}
+
+static void
+span_16bpp_c(uint32_t *p, const uint8_t *src, int n, const uint32_t *table)
+{
+    for (int x = 0; x < n; x++)
+        p[x] = table[*(const uint16_t *) &src[x << 1]];
+}
+
+static void
+span_24bpp_c(uint32_t *p, const uint8_t *src, int n)
+{
+    for (int x = 0; x < n; x++)
+        p[x] = src[x * 3] | (src[(x * 3) + 1] << 8) | (src[(x * 3) + 2] << 16);
+}
+
+static void
+span_32bpp_c(uint32_t *p, const uint8_t *src, int n)
+{
+    for (int x = 0; x < n; x++)
+        p[x] = *(const uint32_t *) &src[x << 2] & 0xffffff;
+}
+
+static void
+span_lut_c(uint32_t *p, int n, const uint32_t *pallook)
+{
+    for (int x = 0; x < n; x++) {
+        uint32_t val = p[x];
+        uint8_t  r   = getcolr(pallook[getcolr(val)]);
+        uint8_t  g   = getcolg(pallook[getcolg(val)]);
+        uint8_t  b   = getcolb(pallook[getcolb(val)]);
+
+        p[x] = makecol32(r, g, b) | (val & 0xff000000);
+    }
+}
+
+static struct {
+    void (*conv_8bpp)(uint32_t *p, const uint8_t *src, int n, const uint32_t *pal, uint32_t mask);
+    void (*conv_16bpp)(uint32_t *p, const uint8_t *src, int n, const uint32_t *table);
+    void (*conv_24bpp)(uint32_t *p, const uint8_t *src, int n);
+    void (*conv_32bpp)(uint32_t *p, const uint8_t *src, int n);
+    void (*lut)(uint32_t *p, int n, const uint32_t *pallook);
+} span = {
+    .conv_8bpp  = span_8bpp_c,
+    .conv_16bpp = span_16bpp_c,
+    .conv_24bpp = span_24bpp_c,
+    .conv_32bpp = span_32bpp_c,
+    .lut        = span_lut_c
+};
+
+#ifdef USE_SPAN_SIMD
+/* SSE2 has neither gathers nor byte shuffles, so only the plain 32bpp
+   conversion gains anything from it. */
+__attribute__((target("sse2"))) static void
+span_32bpp_sse2(uint32_t *p, const uint8_t *src, int n)
+{
+    const __m128i mask = _mm_set1_epi32(0x00ffffff);
+    int           x    = 0;
+
+    for (; (x + 4) <= n; x += 4)
+        _mm_storeu_si128((__m128i *) &p[x], _mm_and_si128(_mm_loadu_si128((const __m128i *) &src[x << 2]), mask));
+
+    span_32bpp_c(&p[x], &src[x << 2], n - x);
+}
+
+__attribute__((target("avx2"))) static void
+span_8bpp_avx2(uint32_t *p, const uint8_t *src, int n, const uint32_t *pal, uint32_t mask)
+{
+    const __m256i vmask = _mm256_set1_epi32(mask);
+    int           x     = 0;
+
+    for (; (x + 8) <= n; x += 8) {
+        __m256i idx = _mm256_and_si256(_mm256_cvtepu8_epi32(_mm_loadl_epi64((const __m128i *) &src[x])), vmask);
+
+        _mm256_storeu_si256((__m256i *) &p[x], _mm256_i32gather_epi32((const int *) pal, idx, 4));
+    }
+
+    span_8bpp_c(&p[x], &src[x], n - x, pal, mask);
+}
+
+__attribute__((target("avx2"))) static void
+span_16bpp_avx2(uint32_t *p, const uint8_t *src, int n, const uint32_t *table)
+{
+    int x = 0;
+
+    for (; (x + 8) <= n; x += 8) {
+        __m256i idx = _mm256_cvtepu16_epi32(_mm_loadu_si128((const __m128i *) &src[x << 1]));
+
+        _mm256_storeu_si256((__m256i *) &p[x], _mm256_i32gather_epi32((const int *) table, idx, 4));
+    }
+
+    span_16bpp_c(&p[x], &src[x << 1], n - x, table);
+}
+
+__attribute__((target("avx2"))) static void
+span_24bpp_avx2(uint32_t *p, const uint8_t *src, int n)
+{
+    const __m256i shuf = _mm256_setr_epi8(0, 1, 2, -1, 3, 4, 5, -1, 6, 7, 8, -1, 9, 10, 11, -1,
+                                          0, 1, 2, -1, 3, 4, 5, -1, 6, 7, 8, -1, 9, 10, 11, -1);
+    int           x    = 0;
+
+    /* Each half loads 16 bytes for 12 used, so stay 4 bytes clear of the end. */
+    for (; ((x * 3) + 28) <= (n * 3); x += 8) {
+        __m128i lo = _mm_loadu_si128((const __m128i *) &src[x * 3]);
+        __m128i hi = _mm_loadu_si128((const __m128i *) &src[(x * 3) + 12]);
+
+        _mm256_storeu_si256((__m256i *) &p[x], _mm256_shuffle_epi8(_mm256_inserti128_si256(_mm256_castsi128_si256(lo), hi, 1), shuf));
+    }
+
+    span_24bpp_c(&p[x], &src[x * 3], n - x);
+}
+
+__attribute__((target("avx2"))) static void
+span_32bpp_avx2(uint32_t *p, const uint8_t *src, int n)
+{
+    const __m256i mask = _mm256_set1_epi32(0x00ffffff);
+    int           x    = 0;
+
+    for (; (x + 8) <= n; x += 8)
+        _mm256_storeu_si256((__m256i *) &p[x], _mm256_and_si256(_mm256_loadu_si256((const __m256i *) &src[x << 2]), mask));
+
+    span_32bpp_c(&p[x], &src[x << 2], n - x);
+}
+
+__attribute__((target("avx2"))) static void
+span_lut_avx2(uint32_t *p, int n, const uint32_t *pallook)
+{
+    const __m256i ff     = _mm256_set1_epi32(0x000000ff);
+    const __m256i ff00   = _mm256_set1_epi32(0x0000ff00);
+    const __m256i ff0000 = _mm256_set1_epi32(0x00ff0000);
+    const __m256i alpha  = _mm256_set1_epi32((int) 0xff000000);
+    int           x      = 0;
+
+    for (; (x + 8) <= n; x += 8) {
+        __m256i val = _mm256_loadu_si256((const __m256i *) &p[x]);
+        __m256i r   = _mm256_i32gather_epi32((const int *) pallook, _mm256_and_si256(_mm256_srli_epi32(val, 16), ff), 4);
+        __m256i g   = _mm256_i32gather_epi32((const int *) pallook, _mm256_and_si256(_mm256_srli_epi32(val, 8), ff), 4);
+        __m256i b   = _mm256_i32gather_epi32((const int *) pallook, _mm256_and_si256(val, ff), 4);
+
+        r = _mm256_or_si256(_mm256_and_si256(r, ff0000), _mm256_and_si256(g, ff00));
+        b = _mm256_or_si256(_mm256_and_si256(b, ff), _mm256_and_si256(val, alpha));
+        _mm256_storeu_si256((__m256i *) &p[x], _mm256_or_si256(r, b));
+    }
+
+    span_lut_c(&p[x], n - x, pallook);
+}
+#endif
+
+#ifdef ENABLE_SVGA_SPAN_CHECK
+#    define SPAN_CHECK_MAX 4096
+
+static void
+span_check(const char *name, const uint32_t *p, const uint32_t *ref, int n)
+{
+    for (int x = 0; x < n; x++) {
+        if (p[x] != ref[x])
+            fatal("SVGA span: %s pixel %i of %i is %08X, the C converter gives %08X\n", name, x, n, p[x], ref[x]);
+    }
+}
+
+#    define SPAN_CHECK(name, p, n, conv)     \
+        do {                                 \
+            uint32_t ref[SPAN_CHECK_MAX];    \
+                                             \
+            if ((n) <= SPAN_CHECK_MAX) {     \
+                conv;                        \
+                span_check(name, p, ref, n); \
+            }                                \
+        } while (0)
+#else
+#    define SPAN_CHECK(name, p, n, conv)
+#endif
+
+static void
+span_lut(uint32_t *p, int n, const uint32_t *pallook)
+{
+#ifdef ENABLE_SVGA_SPAN_CHECK
+    uint32_t ref[SPAN_CHECK_MAX];
+
+    if (n <= SPAN_CHECK_MAX) {
+        memcpy(ref, p, n * sizeof(uint32_t));
+        span_lut_c(ref, n, pallook);
+    }
+#endif
+
+    span.lut(p, n, pallook);
+
+#ifdef ENABLE_SVGA_SPAN_CHECK
+    if (n <= SPAN_CHECK_MAX)
+        span_check("LUT", p, ref, n);
+#endif
+}
+
+void
+svga_render_span_init(void)
+{
+#ifdef USE_SPAN_SIMD
+    __builtin_cpu_init();
+
+    if (__builtin_cpu_supports("sse2"))
+        span.conv_32bpp = span_32bpp_sse2;
+
+    if (__builtin_cpu_supports("avx2")) {
+        span.conv_8bpp  = span_8bpp_avx2;
+        span.conv_16bpp = span_16bpp_avx2;
+        span.conv_24bpp = span_24bpp_avx2;
+        span.conv_32bpp = span_32bpp_avx2;
+        span.lut        = span_lut_avx2;
+    }
+#endif
+}
+
+/* Returns the VRAM for len bytes at ma, or NULL if they wrap around. */
+static const uint8_t *
+span_src(const svga_t *svga, uint32_t ma, int len)
+{
+    uint32_t mask = (uint32_t) svga->vram_display_mask;
+
+    if ((mask & (mask + 1)) || (((ma & mask) + len) > (mask + 1)))
+        return NULL;
+
+    return &svga->vram[ma & mask];
+}
+
+/* n (multiple of 4) pixels of 8bpp through map8. */
+void
+svga_render_span_8bpp(svga_t *svga, uint32_t *p, uint32_t ma, int n)
+{
+    const uint8_t *src = span_src(svga, ma, n);
+    uint32_t       dat;
+
+    if (src != NULL) {
+        span.conv_8bpp(p, src, n, svga->map8, svga->dac_mask);
+        SPAN_CHECK("8bpp", p, n, span_8bpp_c(ref, src, n, svga->map8, svga->dac_mask));
+    } else {
+        for (int x = 0; x < n; x += 4) {
+            dat      = *(uint32_t *) (&svga->vram[(ma + x) & svga->vram_display_mask]);
+            p[x]     = svga->map8[dat & svga->dac_mask & 0xff];
+            p[x + 1] = svga->map8[(dat >> 8) & svga->dac_mask & 0xff];
+            p[x + 2] = svga->map8[(dat >> 16) & svga->dac_mask & 0xff];
+            p[x + 3] = svga->map8[(dat >> 24) & svga->dac_mask & 0xff];
+        }
+    }
+}
+
+/* n (even) pixels of 15 or 16bpp through conv_16to32. */
+void
+svga_render_span_16bpp(svga_t *svga, uint32_t *p, uint32_t ma, int n, uint8_t bpp)
+{
+    const uint8_t *src = span_src(svga, ma, n << 1);
+    uint32_t       dat;
+
+    if ((src != NULL) && (svga->conv_16to32 == svga_conv_16to32)) {
+        span.conv_16bpp(p, src, n, (bpp == 15) ? video_15to32 : video_16to32);
+        SPAN_CHECK("16bpp", p, n, span_16bpp_c(ref, src, n, (bpp == 15) ? video_15to32 : video_16to32));
+    } else {
+        for (int x = 0; x < n; x += 2) {
+            dat      = *(uint32_t *) (&svga->vram[(ma + (x << 1)) & svga->vram_display_mask]);
+            p[x]     = svga->conv_16to32(svga, dat & 0xffff, bpp);
+            p[x + 1] = svga->conv_16to32(svga, dat >> 16, bpp);
+        }
+    }
+}
+
+/* n (multiple of 4) pixels of packed 24bpp, through the RAMDAC LUT if enabled. */
+void
+svga_render_span_24bpp(svga_t *svga, uint32_t *p, uint32_t ma, int n)
+{
+    const uint8_t *src = span_src(svga, ma, n * 3);
+    uint32_t       dat0;
+    uint32_t       dat1;
+    uint32_t       dat2;
+
+    if (src != NULL) {
+        span.conv_24bpp(p, src, n);
+        SPAN_CHECK("24bpp", p, n, span_24bpp_c(ref, src, n));
+    } else {
+        for (int x = 0; x < n; x += 4) {
+            dat0 = *(uint32_t *) (&svga->vram[ma & svga->vram_display_mask]);
+            dat1 = *(uint32_t *) (&svga->vram[(ma + 4) & svga->vram_display_mask]);
+            dat2 = *(uint32_t *) (&svga->vram[(ma + 8) & svga->vram_display_mask]);
+
+            p[x]     = dat0 & 0xffffff;
+            p[x + 1] = (dat0 >> 24) | ((dat1 & 0xffff) << 8);
+            p[x + 2] = (dat1 >> 16) | ((dat2 & 0xff) << 16);
+            p[x + 3] = dat2 >> 8;
+
+            ma += 12;
+        }
+    }
+
+    if (svga->lut_map)
+        span_lut(p, n, svga->pallook);
+}
+
+/* n pixels of 32bpp, through the RAMDAC LUT if enabled. */
+void
+svga_render_span_32bpp(svga_t *svga, uint32_t *p, uint32_t ma, int n)
+{
+    const uint8_t *src = span_src(svga, ma, n << 2);
+
+    if (src != NULL) {
+        span.conv_32bpp(p, src, n);
+        SPAN_CHECK("32bpp", p, n, span_32bpp_c(ref, src, n));
+    } else {
+        for (int x = 0; x < n; x++)
+            p[x] = *(uint32_t *) (&svga->vram[(ma + (x << 2)) & svga->vram_display_mask]) & 0xffffff;
+    }
+
+    if (svga->lut_map)
+        span_lut(p, n, svga->pallook);
+}
+
+/* Doubles the n pixels at p in place, for the low resolution modes. */
+void
+svga_render_span_double(uint32_t *p, int n)
+{
+    for (int x = n - 1; x >= 0; x--)
+        p[(x << 1)] = p[(x << 1) + 1] = p[x];
+}
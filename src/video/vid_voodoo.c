@@ -38,6 +38,7 @@
 #include <86box/video.h>
 #include <86box/vid_svga.h>
 #include <86box/vid_voodoo_common.h>
+#include <86box/vid_voodoo_capture.h>
 #include <86box/vid_voodoo_blitter.h>
 #include <86box/vid_voodoo_display.h>
 #include <86box/vid_voodoo_dither.h>
@@ -493,6 +494,7 @@ voodoo_writel(uint32_t addr, uint32_t val, void *priv)
                 if (voodoo->initEnable & 0x01) {
                     voodoo->fbiInit4  = val;
                     voodoo->read_time = pci_nonburst_time + pci_burst_time * ((voodoo->fbiInit4 & 1) ? 2 : 1);
+                    voodoo_capture_state(voodoo, VOODOO_CAPTURE_STATE_FBIINIT0 + 4, voodoo->fbiInit4);
 #if 0
                     voodoo_log("fbiInit4 write %08x - read_time=%i\n", val, voodoo->read_time);
 #endif
@@ -508,10 +510,13 @@ voodoo_writel(uint32_t addr, uint32_t val, void *priv)
                 if ((voodoo->v_disp == 386) || (voodoo->v_disp == 402) ||
                     (voodoo->v_disp == 482) || (voodoo->v_disp == 602))
                     voodoo->v_disp     -= 2;
+                voodoo_capture_state(voodoo, VOODOO_CAPTURE_STATE_H_DISP, voodoo->h_disp);
+                voodoo_capture_state(voodoo, VOODOO_CAPTURE_STATE_V_DISP, voodoo->v_disp);
                 break;
             case SST_fbiInit0:
                 if (voodoo->initEnable & 0x01) {
                     voodoo->fbiInit0 = val;
+                    voodoo_capture_state(voodoo, VOODOO_CAPTURE_STATE_FBIINIT0 + 0, voodoo->fbiInit0);
                     thread_wait_mutex(voodoo->force_blit_mutex);
                     voodoo->can_blit = (voodoo->fbiInit0 & FBIINIT0_VGA_PASS) ? 1 : 0;
                     if (!voodoo->can_blit)
@@ -544,6 +549,7 @@ voodoo_writel(uint32_t addr, uint32_t val, void *priv)
                     voodoo->fbiInit1   = (val & ~5) | (voodoo->fbiInit1 & 5);
                     voodoo->write_time = pci_nonburst_time + pci_burst_time * ((voodoo->fbiInit1 & 2) ? 1 : 0);
                     voodoo->burst_time = pci_burst_time * ((voodoo->fbiInit1 & 2) ? 2 : 1);
+                    voodoo_capture_state(voodoo, VOODOO_CAPTURE_STATE_FBIINIT0 + 1, voodoo->fbiInit1);
 #if 0
                     voodoo_log("fbiInit1 write %08x - write_time=%i burst_time=%i\n", val, voodoo->write_time, voodoo->burst_time);
 #endif
@@ -552,12 +558,15 @@ voodoo_writel(uint32_t addr, uint32_t val, void *priv)
             case SST_fbiInit2:
                 if (voodoo->initEnable & 0x01) {
                     voodoo->fbiInit2 = val;
+                    voodoo_capture_state(voodoo, VOODOO_CAPTURE_STATE_FBIINIT0 + 2, voodoo->fbiInit2);
                     voodoo_recalc(voodoo);
                 }
                 break;
             case SST_fbiInit3:
-                if (voodoo->initEnable & 0x01)
+                if (voodoo->initEnable & 0x01) {
                     voodoo->fbiInit3 = val;
+                    voodoo_capture_state(voodoo, VOODOO_CAPTURE_STATE_FBIINIT0 + 3, voodoo->fbiInit3);
+                }
                 break;
 
             case SST_hSync:
@@ -638,17 +647,22 @@ voodoo_writel(uint32_t addr, uint32_t val, void *priv)
                 break;
 
             case SST_fbiInit5:
-                if (voodoo->initEnable & 0x01)
+                if (voodoo->initEnable & 0x01) {
                     voodoo->fbiInit5 = (val & ~0x41e6) | (voodoo->fbiInit5 & 0x41e6);
+                    voodoo_capture_state(voodoo, VOODOO_CAPTURE_STATE_FBIINIT0 + 5, voodoo->fbiInit5);
+                }
                 break;
             case SST_fbiInit6:
-                if (voodoo->initEnable & 0x01)
+                if (voodoo->initEnable & 0x01) {
                     voodoo->fbiInit6 = val;
+                    voodoo_capture_state(voodoo, VOODOO_CAPTURE_STATE_FBIINIT0 + 6, voodoo->fbiInit6);
+                }
                 break;
             case SST_fbiInit7:
                 if (voodoo->initEnable & 0x01) {
                     voodoo->fbiInit7        = val;
                     voodoo->cmdfifo_enabled = val & 0x100;
+                    voodoo_capture_state(voodoo, VOODOO_CAPTURE_STATE_FBIINIT0 + 7, voodoo->fbiInit7);
                 }
                 break;
 
@@ -866,6 +880,9 @@ voodoo_pci_write(int func, int addr, uint8_t val, void *priv)
         default:
             break;
     }
+
+    if ((addr >= 0x40) && (addr <= 0x43))
+        voodoo_capture_state(voodoo, VOODOO_CAPTURE_STATE_INITENABLE, voodoo->initEnable);
 }
 
 static void
@@ -922,10 +939,10 @@ voodoo_card_init(void)
     voodoo->fb_size           = device_get_config_int("framebuffer_memory");
     voodoo->fb_mask           = (voodoo->fb_size << 20) - 1;
     voodoo->render_threads    = device_get_config_int("render_threads");
-    voodoo->odd_even_mask     = voodoo->render_threads - 1;
 #ifndef NO_CODEGEN
     voodoo->use_recompiler = device_get_config_int("recompiler");
 #endif
+    voodoo->texture_cache_size = device_get_config_int("texture_cache");
     voodoo->type = device_get_config_int("type");
     switch (voodoo->type) {
         case VOODOO_1:
@@ -958,47 +975,23 @@ voodoo_card_init(void)
     voodoo->tex_mem_w[0] = (uint16_t *) voodoo->tex_mem[0];
     voodoo->tex_mem_w[1] = (uint16_t *) voodoo->tex_mem[1];
 
-    for (c = 0; c < TEX_CACHE_MAX; c++) {
-        voodoo->texture_cache[0][c].data     = malloc((256 * 256 + 256 * 256 + 128 * 128 + 64 * 64 + 32 * 32 + 16 * 16 + 8 * 8 + 4 * 4 + 2 * 2) * 4);
-        voodoo->texture_cache[0][c].base     = -1; /*invalid*/
-        voodoo->texture_cache[0][c].refcount = 0;
-        if (voodoo->dual_tmus) {
-            voodoo->texture_cache[1][c].data     = malloc((256 * 256 + 256 * 256 + 128 * 128 + 64 * 64 + 32 * 32 + 16 * 16 + 8 * 8 + 4 * 4 + 2 * 2) * 4);
-            voodoo->texture_cache[1][c].base     = -1; /*invalid*/
-            voodoo->texture_cache[1][c].refcount = 0;
-        }
-    }
+    voodoo_texture_cache_init(voodoo);
+
+    if (device_get_config_int("capture"))
+        voodoo_capture_open(voodoo);
+    voodoo_replay_open(voodoo);
 
     timer_add(&voodoo->timer, voodoo_callback, voodoo, 1);
 
     voodoo->svga     = svga_get_pri();
     voodoo->fbiInit0 = 0;
 
-    voodoo->wake_fifo_thread         = thread_create_event();
-    voodoo->wake_render_thread[0]    = thread_create_event();
-    voodoo->wake_render_thread[1]    = thread_create_event();
-    voodoo->wake_render_thread[2]    = thread_create_event();
-    voodoo->wake_render_thread[3]    = thread_create_event();
-    voodoo->wake_main_thread         = thread_create_event();
-    voodoo->fifo_not_full_event      = thread_create_event();
-    voodoo->render_not_full_event[0] = thread_create_event();
-    voodoo->render_not_full_event[1] = thread_create_event();
-    voodoo->render_not_full_event[2] = thread_create_event();
-    voodoo->render_not_full_event[3] = thread_create_event();
-    voodoo->fifo_thread_run          = 1;
-    voodoo->fifo_thread              = thread_create(voodoo_fifo_thread, voodoo);
-    voodoo->render_thread_run[0]     = 1;
-    voodoo->render_thread[0]         = thread_create(voodoo_render_thread_1, voodoo);
-    if (voodoo->render_threads >= 2) {
-        voodoo->render_thread_run[1] = 1;
-        voodoo->render_thread[1]     = thread_create(voodoo_render_thread_2, voodoo);
-    }
-    if (voodoo->render_threads == 4) {
-        voodoo->render_thread_run[2] = 1;
-        voodoo->render_thread[2]     = thread_create(voodoo_render_thread_3, voodoo);
-        voodoo->render_thread_run[3] = 1;
-        voodoo->render_thread[3]     = thread_create(voodoo_render_thread_4, voodoo);
-    }
+    voodoo->wake_fifo_thread    = thread_create_event();
+    voodoo->wake_main_thread    = thread_create_event();
+    voodoo->fifo_not_full_event = thread_create_event();
+    voodoo->fifo_thread_run     = 1;
+    voodoo->fifo_thread         = thread_create(voodoo_fifo_thread, voodoo);
+    voodoo_render_threads_init(voodoo);
     voodoo->swap_mutex = thread_create_mutex();
     timer_add(&voodoo->wake_timer, voodoo_wake_timer, (void *) voodoo, 0);
 
@@ -1051,6 +1044,9 @@ voodoo_card_init(void)
 #ifndef NO_CODEGEN
     voodoo_codegen_init(voodoo);
 #endif
+#ifdef ENABLE_VOODOO_RENDER_CHECK
+    voodoo_render_check(voodoo);
+#endif
 
     voodoo->disp_buffer = 0;
     voodoo->draw_buffer = 1;
@@ -1073,56 +1069,29 @@ voodoo_2d3d_card_init(int type)
     voodoo->dithersub_enabled = device_get_config_int("dithersub");
     voodoo->scrfilter         = device_get_config_int("dacfilter");
     voodoo->render_threads    = device_get_config_int("render_threads");
-    voodoo->odd_even_mask     = voodoo->render_threads - 1;
 #ifndef NO_CODEGEN
     voodoo->use_recompiler = device_get_config_int("recompiler");
 #endif
+    voodoo->texture_cache_size = device_get_config_int("texture_cache");
     voodoo->type      = type;
     voodoo->dual_tmus = (type == VOODOO_3) ? 1 : 0;
 
     /*generate filter lookup tables*/
     voodoo_generate_filter_v2(voodoo);
 
-    for (c = 0; c < TEX_CACHE_MAX; c++) {
-        voodoo->texture_cache[0][c].data     = malloc((256 * 256 + 256 * 256 + 128 * 128 + 64 * 64 + 32 * 32 + 16 * 16 + 8 * 8 + 4 * 4 + 2 * 2) * 4);
-        voodoo->texture_cache[0][c].base     = -1; /*invalid*/
-        voodoo->texture_cache[0][c].refcount = 0;
-        if (voodoo->dual_tmus) {
-            voodoo->texture_cache[1][c].data     = malloc((256 * 256 + 256 * 256 + 128 * 128 + 64 * 64 + 32 * 32 + 16 * 16 + 8 * 8 + 4 * 4 + 2 * 2) * 4);
-            voodoo->texture_cache[1][c].base     = -1; /*invalid*/
-            voodoo->texture_cache[1][c].refcount = 0;
-        }
-    }
+    voodoo_texture_cache_init(voodoo);
 
     timer_add(&voodoo->timer, voodoo_callback, voodoo, 1);
 
     voodoo->fbiInit0 = 0;
 
-    voodoo->wake_fifo_thread         = thread_create_event();
-    voodoo->wake_render_thread[0]    = thread_create_event();
-    voodoo->wake_render_thread[1]    = thread_create_event();
-    voodoo->wake_render_thread[2]    = thread_create_event();
-    voodoo->wake_render_thread[3]    = thread_create_event();
-    voodoo->wake_main_thread         = thread_create_event();
-    voodoo->fifo_not_full_event      = thread_create_event();
-    voodoo->render_not_full_event[0] = thread_create_event();
-    voodoo->render_not_full_event[1] = thread_create_event();
-    voodoo->render_not_full_event[2] = thread_create_event();
-    voodoo->render_not_full_event[3] = thread_create_event();
-    voodoo->fifo_thread_run          = 1;
-    voodoo->fifo_thread              = thread_create(voodoo_fifo_thread, voodoo);
-    voodoo->render_thread_run[0]     = 1;
-    voodoo->render_thread[0]         = thread_create(voodoo_render_thread_1, voodoo);
-    if (voodoo->render_threads >= 2) {
-        voodoo->render_thread_run[1] = 1;
-        voodoo->render_thread[1]     = thread_create(voodoo_render_thread_2, voodoo);
-    }
-    if (voodoo->render_threads == 4) {
-        voodoo->render_thread_run[2] = 1;
-        voodoo->render_thread[2]     = thread_create(voodoo_render_thread_3, voodoo);
-        voodoo->render_thread_run[3] = 1;
-        voodoo->render_thread[3]     = thread_create(voodoo_render_thread_4, voodoo);
-    }
+    voodoo->wake_fifo_thread    = thread_create_event();
+    voodoo->wake_main_thread    = thread_create_event();
+    voodoo->fifo_not_full_event = thread_create_event();
+    voodoo->fifo_thread_run     = 1;
+    /*The FIFO thread is started by the caller, once the memory pointers are
+      set and the capture or replay is attached*/
+    voodoo_render_threads_init(voodoo);
     voodoo->swap_mutex = thread_create_mutex();
     timer_add(&voodoo->wake_timer, voodoo_wake_timer, (void *) voodoo, 0);
 
@@ -1175,6 +1144,9 @@ voodoo_2d3d_card_init(int type)
 #ifndef NO_CODEGEN
     voodoo_codegen_init(voodoo);
 #endif
+#ifdef ENABLE_VOODOO_RENDER_CHECK
+    voodoo_render_check(voodoo);
+#endif
 
     voodoo->disp_buffer = 0;
     voodoo->draw_buffer = 1;
@@ -1249,35 +1221,14 @@ voodoo_card_close(voodoo_t *voodoo)
     voodoo->fifo_thread_run = 0;
     thread_set_event(voodoo->wake_fifo_thread);
     thread_wait(voodoo->fifo_thread);
-    voodoo->render_thread_run[0] = 0;
-    thread_set_event(voodoo->wake_render_thread[0]);
-    thread_wait(voodoo->render_thread[0]);
-    if (voodoo->render_threads >= 2) {
-        voodoo->render_thread_run[1] = 0;
-        thread_set_event(voodoo->wake_render_thread[1]);
-        thread_wait(voodoo->render_thread[1]);
-    }
-    if (voodoo->render_threads == 4) {
-        voodoo->render_thread_run[2] = 0;
-        thread_set_event(voodoo->wake_render_thread[2]);
-        thread_wait(voodoo->render_thread[2]);
-        voodoo->render_thread_run[3] = 0;
-        thread_set_event(voodoo->wake_render_thread[3]);
-        thread_wait(voodoo->render_thread[3]);
-    }
+    voodoo_render_threads_close(voodoo);
+    voodoo_capture_close(voodoo);
+    voodoo_replay_close(voodoo);
     thread_destroy_event(voodoo->fifo_not_full_event);
     thread_destroy_event(voodoo->wake_main_thread);
     thread_destroy_event(voodoo->wake_fifo_thread);
-    thread_destroy_event(voodoo->wake_render_thread[0]);
-    thread_destroy_event(voodoo->wake_render_thread[1]);
-    thread_destroy_event(voodoo->render_not_full_event[0]);
-    thread_destroy_event(voodoo->render_not_full_event[1]);
 
-    for (uint8_t c = 0; c < TEX_CACHE_MAX; c++) {
-        if (voodoo->dual_tmus)
-            free(voodoo->texture_cache[1][c].data);
-        free(voodoo->texture_cache[0][c].data);
-    }
+    voodoo_texture_cache_close(voodoo);
 #ifndef NO_CODEGEN
     voodoo_codegen_close(voodoo);
 #endif
@@ -1394,13 +1345,46 @@ static const device_config_t voodoo_config[] = {
         .file_filter    = NULL,
         .spinner        = { 0 },
         .selection      = {
-            { .description = "1", .value = 1 },
-            { .description = "2", .value = 2 },
-            { .description = "4", .value = 4 },
-            { .description = ""              }
+            { .description = "1",  .value = 1  },
+            { .description = "2",  .value = 2  },
+            { .description = "4",  .value = 4  },
+            { .description = "6",  .value = 6  },
+            { .description = "8",  .value = 8  },
+            { .description = "12", .value = 12 },
+            { .description = "16", .value = 16 },
+            { .description = ""                }
+        },
+        .bios           = { { 0 } }
+    },
+    {
+        .name           = "texture_cache",
+        .description    = "Texture cache entries",
+        .type           = CONFIG_SELECTION,
+        .default_string = NULL,
+        .default_int    = TEX_CACHE_DEFAULT,
+        .file_filter    = NULL,
+        .spinner        = { 0 },
+        .selection      = {
+            { .description = "64",   .value = 64   },
+            { .description = "128",  .value = 128  },
+            { .description = "256",  .value = 256  },
+            { .description = "512",  .value = 512  },
+            { .description = "1024", .value = 1024 },
+            { .description = ""                    }
         },
         .bios           = { { 0 } }
     },
+    {
+        .name           = "capture",
+        .description    = "Capture command stream",
+        .type           = CONFIG_BINARY,
+        .default_string = NULL,
+        .default_int    = 0,
+        .file_filter    = NULL,
+        .spinner        = { 0 },
+        .selection      = { { 0 } },
+        .bios           = { { 0 } }
+    },
     {
         .name           = "sli",
         .description    = "SLI",
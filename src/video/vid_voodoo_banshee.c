@@ -43,6 +43,7 @@
 #include <86box/vid_svga.h>
 #include <86box/vid_svga_render.h>
 #include <86box/vid_voodoo_common.h>
+#include <86box/vid_voodoo_capture.h>
 #include <86box/vid_voodoo_display.h>
 #include <86box/vid_voodoo_fb.h>
 #include <86box/vid_voodoo_fifo.h>
@@ -831,6 +832,7 @@ banshee_ext_outl(uint16_t addr, uint32_t val, void *priv)
         case Init_miscInit0:
             banshee->miscInit0    = val;
             voodoo->y_origin_swap = (val & MISCINIT0_Y_ORIGIN_SWAP_MASK) >> MISCINIT0_Y_ORIGIN_SWAP_SHIFT;
+            voodoo_capture_state(voodoo, VOODOO_CAPTURE_STATE_Y_ORIGIN_SWAP, voodoo->y_origin_swap);
             break;
         case Init_miscInit1:
             banshee->miscInit1 = val;
@@ -884,6 +886,7 @@ banshee_ext_outl(uint16_t addr, uint32_t val, void *priv)
         case DAC_dacData:
             svga->pallook[banshee->dacAddr] = val & 0xffffff;
             svga->fullchange                = changeframecount;
+            svga->render_gen++;
             break;
 
         case Video_vidProcCfg:
@@ -948,6 +951,8 @@ banshee_ext_outl(uint16_t addr, uint32_t val, void *priv)
             banshee->vidScreenSize = val;
             voodoo->h_disp         = (val & 0xfff) + 1;
             voodoo->v_disp         = (val >> 12) & 0xfff;
+            voodoo_capture_state(voodoo, VOODOO_CAPTURE_STATE_H_DISP, voodoo->h_disp);
+            voodoo_capture_state(voodoo, VOODOO_CAPTURE_STATE_V_DISP, voodoo->v_disp);
             break;
         case Video_vidOverlayStartCoords:
             voodoo->overlay.vidOverlayStartCoords = val;
@@ -1103,7 +1108,7 @@ banshee_status(banshee_t *banshee)
     int           fifo_entries = FIFO_ENTRIES;
     int           swap_count   = voodoo->swap_count;
     int           written      = voodoo->cmd_written + voodoo->cmd_written_fifo;
-    int           busy         = (written - voodoo->cmd_read) || (voodoo->cmdfifo_depth_rd != voodoo->cmdfifo_depth_wr) || (voodoo->cmdfifo_depth_rd_2 != voodoo->cmdfifo_depth_wr_2) || voodoo->render_voodoo_busy[0] || voodoo->render_voodoo_busy[1] || voodoo->render_voodoo_busy[2] || voodoo->render_voodoo_busy[3] || voodoo->voodoo_busy;
+    int           busy         = (written - voodoo->cmd_read) || (voodoo->cmdfifo_depth_rd != voodoo->cmdfifo_depth_wr) || (voodoo->cmdfifo_depth_rd_2 != voodoo->cmdfifo_depth_wr_2) || voodoo_render_busy(voodoo) || voodoo->voodoo_busy;
     uint32_t      ret          = 0;
 
     if (fifo_entries < 0x20)
@@ -3351,6 +3356,13 @@ banshee_init_common(const device_t *info, char *fn, int has_sgram, int type, int
     banshee->voodoo->cmd_status_2 = (1 << 28);
     voodoo_generate_filter_v1(banshee->voodoo);
 
+    /*Opened here rather than in voodoo_2d3d_card_init() so the header gets the
+      real memory masks, and before the FIFO thread so it sees the whole stream*/
+    if (device_get_config_int("capture"))
+        voodoo_capture_open(banshee->voodoo);
+    voodoo_replay_open(banshee->voodoo);
+    banshee->voodoo->fifo_thread = thread_create(voodoo_fifo_thread, banshee->voodoo);
+
     banshee->vidSerialParallelPort = VIDSERIAL_DDC_DCK_W | VIDSERIAL_DDC_DDA_W;
 
     banshee->i2c     = i2c_gpio_init("i2c_voodoo_banshee");
@@ -3699,13 +3711,46 @@ static const device_config_t banshee_sgram_config[] = {
         .file_filter    = NULL,
         .spinner        = { 0 },
         .selection      = {
-            { .description = "1", .value = 1 },
-            { .description = "2", .value = 2 },
-            { .description = "4", .value = 4 },
-            { .description = ""              }
+            { .description = "1",  .value = 1  },
+            { .description = "2",  .value = 2  },
+            { .description = "4",  .value = 4  },
+            { .description = "6",  .value = 6  },
+            { .description = "8",  .value = 8  },
+            { .description = "12", .value = 12 },
+            { .description = "16", .value = 16 },
+            { .description = ""                }
+        },
+        .bios           = { { 0 } }
+    },
+    {
+        .name           = "texture_cache",
+        .description    = "Texture cache entries",
+        .type           = CONFIG_SELECTION,
+        .default_string = NULL,
+        .default_int    = TEX_CACHE_DEFAULT,
+        .file_filter    = NULL,
+        .spinner        = { 0 },
+        .selection      = {
+            { .description = "64",   .value = 64   },
+            { .description = "128",  .value = 128  },
+            { .description = "256",  .value = 256  },
+            { .description = "512",  .value = 512  },
+            { .description = "1024", .value = 1024 },
+            { .description = ""                    }
         },
         .bios           = { { 0 } }
     },
+    {
+        .name           = "capture",
+        .description    = "Capture command stream",
+        .type           = CONFIG_BINARY,
+        .default_string = NULL,
+        .default_int    = 0,
+        .file_filter    = NULL,
+        .spinner        = { 0 },
+        .selection      = { { 0 } },
+        .bios           = { { 0 } }
+    },
 #ifndef NO_CODEGEN
     {
         .name           = "recompiler",
@@ -3765,13 +3810,46 @@ static const device_config_t banshee_sgram_16mbonly_config[] = {
         .file_filter    = NULL,
         .spinner        = { 0 },
         .selection      = {
-            { .description = "1", .value = 1 },
-            { .description = "2", .value = 2 },
-            { .description = "4", .value = 4 },
-            { .description = ""              }
+            { .description = "1",  .value = 1  },
+            { .description = "2",  .value = 2  },
+            { .description = "4",  .value = 4  },
+            { .description = "6",  .value = 6  },
+            { .description = "8",  .value = 8  },
+            { .description = "12", .value = 12 },
+            { .description = "16", .value = 16 },
+            { .description = ""                }
+        },
+        .bios           = { { 0 } }
+    },
+    {
+        .name           = "texture_cache",
+        .description    = "Texture cache entries",
+        .type           = CONFIG_SELECTION,
+        .default_string = NULL,
+        .default_int    = TEX_CACHE_DEFAULT,
+        .file_filter    = NULL,
+        .spinner        = { 0 },
+        .selection      = {
+            { .description = "64",   .value = 64   },
+            { .description = "128",  .value = 128  },
+            { .description = "256",  .value = 256  },
+            { .description = "512",  .value = 512  },
+            { .description = "1024", .value = 1024 },
+            { .description = ""                    }
         },
         .bios           = { { 0 } }
     },
+    {
+        .name           = "capture",
+        .description    = "Capture command stream",
+        .type           = CONFIG_BINARY,
+        .default_string = NULL,
+        .default_int    = 0,
+        .file_filter    = NULL,
+        .spinner        = { 0 },
+        .selection      = { { 0 } },
+        .bios           = { { 0 } }
+    },
 #ifndef NO_CODEGEN
     {
         .name           = "recompiler",
@@ -3831,13 +3909,46 @@ static const device_config_t banshee_sdram_config[] = {
         .file_filter    = NULL,
         .spinner        = { 0 },
         .selection      = {
-            { .description = "1", .value = 1 },
-            { .description = "2", .value = 2 },
-            { .description = "4", .value = 4 },
-            { .description = ""              }
+            { .description = "1",  .value = 1  },
+            { .description = "2",  .value = 2  },
+            { .description = "4",  .value = 4  },
+            { .description = "6",  .value = 6  },
+            { .description = "8",  .value = 8  },
+            { .description = "12", .value = 12 },
+            { .description = "16", .value = 16 },
+            { .description = ""                }
         },
         .bios           = { { 0 } }
     },
+    {
+        .name           = "texture_cache",
+        .description    = "Texture cache entries",
+        .type           = CONFIG_SELECTION,
+        .default_string = NULL,
+        .default_int    = TEX_CACHE_DEFAULT,
+        .file_filter    = NULL,
+        .spinner        = { 0 },
+        .selection      = {
+            { .description = "64",   .value = 64   },
+            { .description = "128",  .value = 128  },
+            { .description = "256",  .value = 256  },
+            { .description = "512",  .value = 512  },
+            { .description = "1024", .value = 1024 },
+            { .description = ""                    }
+        },
+        .bios           = { { 0 } }
+    },
+    {
+        .name           = "capture",
+        .description    = "Capture command stream",
+        .type           = CONFIG_BINARY,
+        .default_string = NULL,
+        .default_int    = 0,
+        .file_filter    = NULL,
+        .spinner        = { 0 },
+        .selection      = { { 0 } },
+        .bios           = { { 0 } }
+    },
 #ifndef NO_CODEGEN
     {
         .name           = "recompiler",
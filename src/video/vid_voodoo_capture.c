@@ -0,0 +1,295 @@
+/*
+ * 86Box    A hypervisor and IBM PC system emulator that specializes in
+ *          running old operating systems and software designed for IBM
+ *          PC systems and compatibles from 1981 through fairly recent
+ *          system designs based on the PCI bus.
+ *
+ *          This file is part of the 86Box distribution.
+ *
+ *          Voodoo Graphics, 2, Banshee, 3 command stream capture.
+ *
+ *          With the "capture" option set, everything the FIFO thread
+ *          executes is written to voodooN.vcap in the user directory,
+ *          from card init until the card is closed, along with per-frame
+ *          statistics and draw buffer checksums. Registers the CPU writes
+ *          directly are recorded as they are written. Recording from init
+ *          means no memory snapshot is needed to replay the stream.
+ *
+ *          voodoo_capture_read() walks a capture and hands back its
+ *          frames; the replay (vid_voodoo_replay.c) uses it.
+ *
+ *
+ *
+ *          Copyright 2026 The 86Box development team
+ */
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include <stdlib.h>
+#include <stddef.h>
+#include <wchar.h>
+#define HAVE_STDARG_H
+#include <86box/86box.h>
+#include <86box/device.h>
+#include <86box/mem.h>
+#include <86box/timer.h>
+#include <86box/path.h>
+#include <86box/plat.h>
+#include <86box/thread.h>
+#include <86box/video.h>
+#include <86box/vid_svga.h>
+#include <86box/vid_voodoo_common.h>
+#include <86box/vid_voodoo_capture.h>
+#include <86box/vid_voodoo_render.h>
+
+#define CAPTURE_BUFFER_SIZE (1 << 20)
+
+typedef struct voodoo_capture_t {
+    FILE *fp;
+
+    int      tri_count;
+    int      pixel_count;
+    int      texel_count;
+    uint64_t fifo_time;
+    uint64_t render_time;
+    int      frames;
+} voodoo_capture_t;
+
+static int capture_nr = 0;
+
+#ifdef ENABLE_VOODOO_CAPTURE_LOG
+int voodoo_capture_do_log = ENABLE_VOODOO_CAPTURE_LOG;
+
+static void
+voodoo_capture_log(const char *fmt, ...)
+{
+    va_list ap;
+
+    if (voodoo_capture_do_log) {
+        va_start(ap, fmt);
+        pclog_ex(fmt, ap);
+        va_end(ap);
+    }
+}
+#else
+#    define voodoo_capture_log(fmt, ...)
+#endif
+
+static void
+capture_record(voodoo_capture_t *capture, uint32_t addr_type, uint32_t val)
+{
+    uint32_t rec[2] = { addr_type, val };
+
+    fwrite(rec, sizeof(rec), 1, capture->fp);
+}
+
+/*Record the value of every register that is written directly rather than
+  through the FIFO; later writes are recorded by voodoo_capture_state()*/
+static void
+capture_write_state(voodoo_t *voodoo)
+{
+    uint32_t state[VOODOO_CAPTURE_STATE_COUNT];
+
+    state[VOODOO_CAPTURE_STATE_FBIINIT0 + 0]  = voodoo->fbiInit0;
+    state[VOODOO_CAPTURE_STATE_FBIINIT0 + 1]  = voodoo->fbiInit1;
+    state[VOODOO_CAPTURE_STATE_FBIINIT0 + 2]  = voodoo->fbiInit2;
+    state[VOODOO_CAPTURE_STATE_FBIINIT0 + 3]  = voodoo->fbiInit3;
+    state[VOODOO_CAPTURE_STATE_FBIINIT0 + 4]  = voodoo->fbiInit4;
+    state[VOODOO_CAPTURE_STATE_FBIINIT0 + 5]  = voodoo->fbiInit5;
+    state[VOODOO_CAPTURE_STATE_FBIINIT0 + 6]  = voodoo->fbiInit6;
+    state[VOODOO_CAPTURE_STATE_FBIINIT0 + 7]  = voodoo->fbiInit7;
+    state[VOODOO_CAPTURE_STATE_INITENABLE]    = voodoo->initEnable;
+    state[VOODOO_CAPTURE_STATE_H_DISP]        = voodoo->h_disp;
+    state[VOODOO_CAPTURE_STATE_V_DISP]        = voodoo->v_disp;
+    state[VOODOO_CAPTURE_STATE_Y_ORIGIN_SWAP] = voodoo->y_origin_swap;
+
+    for (int c = 0; c < VOODOO_CAPTURE_STATE_COUNT; c++)
+        capture_record(voodoo->capture, VOODOO_CAPTURE_STATE | c, state[c]);
+}
+
+/*FNV-1a over the draw buffer, used by replays to verify their output*/
+uint32_t
+voodoo_capture_checksum(voodoo_t *voodoo)
+{
+    uint32_t hash = 0x811c9dc5;
+    uint32_t addr = voodoo->params.draw_offset;
+    uint32_t size = voodoo->params.row_width * voodoo->v_disp;
+
+    if (size > (voodoo->fb_mask + 1))
+        size = voodoo->fb_mask + 1;
+
+    for (uint32_t c = 0; c < size; c += 4) {
+        hash ^= *(uint32_t *) &voodoo->fb_mem[(addr + c) & voodoo->fb_mask];
+        hash *= 0x01000193;
+    }
+
+    return hash;
+}
+
+void
+voodoo_capture_write(voodoo_t *voodoo, uint32_t addr_type, uint32_t val)
+{
+    capture_record(voodoo->capture, addr_type, val);
+}
+
+void
+voodoo_capture_end_frame(voodoo_t *voodoo)
+{
+    voodoo_capture_t *capture     = voodoo->capture;
+    int               pixel_count = 0;
+    int               texel_count = 0;
+    uint64_t          render_time = 0;
+
+    voodoo_wait_for_render_thread_idle(voodoo);
+
+    for (int c = 0; c < voodoo->render_threads; c++) {
+        pixel_count += voodoo->pixel_count[c];
+        texel_count += voodoo->texel_count[c];
+        render_time += voodoo->render_time[c];
+    }
+
+    capture_record(capture, VOODOO_CAPTURE_STAT | VOODOO_CAPTURE_STAT_TRIANGLES, voodoo->tri_count - capture->tri_count);
+    capture_record(capture, VOODOO_CAPTURE_STAT | VOODOO_CAPTURE_STAT_PIXELS, pixel_count - capture->pixel_count);
+    capture_record(capture, VOODOO_CAPTURE_STAT | VOODOO_CAPTURE_STAT_TEXELS, texel_count - capture->texel_count);
+    capture_record(capture, VOODOO_CAPTURE_STAT | VOODOO_CAPTURE_STAT_FIFO_TIME, (uint32_t) (voodoo->time - capture->fifo_time));
+    capture_record(capture, VOODOO_CAPTURE_STAT | VOODOO_CAPTURE_STAT_RENDER_TIME, (uint32_t) (render_time - capture->render_time));
+    capture_record(capture, VOODOO_CAPTURE_FRAME, voodoo_capture_checksum(voodoo));
+
+    capture->tri_count   = voodoo->tri_count;
+    capture->pixel_count = pixel_count;
+    capture->texel_count = texel_count;
+    capture->fifo_time   = voodoo->time;
+    capture->render_time = render_time;
+    capture->frames++;
+}
+
+/*Reads a capture back, calling frame_func (if set) for every complete frame.
+  Returns the number of frames, or -1 if the file is not a valid capture*/
+int
+voodoo_capture_read(const char *fn, voodoo_capture_header_t *header,
+                    void (*frame_func)(void *priv, const voodoo_capture_frame_t *frame), void *priv)
+{
+    voodoo_capture_frame_t frame = { 0 };
+    uint32_t               rec[2];
+    uint32_t               id;
+    int64_t                size;
+    int                    frames = 0;
+    FILE                  *fp     = plat_fopen(fn, "rb");
+
+    if (fp == NULL)
+        return -1;
+
+    /*A capture is the header and whole records, nothing cut short*/
+    fseeko64(fp, 0, SEEK_END);
+    size = ftello64(fp);
+    fseeko64(fp, 0, SEEK_SET);
+    if ((size < (int64_t) sizeof(voodoo_capture_header_t)) ||
+        ((size - sizeof(voodoo_capture_header_t)) % sizeof(rec)) ||
+        (fread(header, sizeof(voodoo_capture_header_t), 1, fp) != 1) ||
+        (header->magic != VOODOO_CAPTURE_MAGIC) || (header->version != VOODOO_CAPTURE_VERSION)) {
+        fclose(fp);
+        return -1;
+    }
+
+    while (fread(rec, sizeof(rec), 1, fp) == 1) {
+        id = rec[0] & FIFO_ADDR;
+
+        switch (rec[0] & FIFO_TYPE) {
+            case FIFO_WRITEL_REG:
+            case FIFO_WRITEW_FB:
+            case FIFO_WRITEL_FB:
+            case FIFO_WRITEL_TEX:
+            case FIFO_WRITEL_2DREG:
+            case VOODOO_CAPTURE_CMDFIFO:
+            case VOODOO_CAPTURE_CMDFIFO_2:
+                frame.records++;
+                break;
+
+            case VOODOO_CAPTURE_STATE:
+                if (id >= VOODOO_CAPTURE_STATE_COUNT)
+                    frames = -1;
+                break;
+
+            case VOODOO_CAPTURE_STAT:
+                if (id >= VOODOO_CAPTURE_STAT_COUNT)
+                    frames = -1;
+                else
+                    frame.stat[id] = rec[1];
+                break;
+
+            case VOODOO_CAPTURE_FRAME:
+                frame.checksum = rec[1];
+                if (frame_func)
+                    frame_func(priv, &frame);
+                memset(&frame, 0x00, sizeof(voodoo_capture_frame_t));
+                frames++;
+                break;
+
+            default:
+                frames = -1;
+                break;
+        }
+
+        if (frames < 0) {
+            voodoo_capture_log("Voodoo capture: bad record %08x in %s\n", rec[0], fn);
+            break;
+        }
+    }
+
+    fclose(fp);
+
+    return frames;
+}
+
+void
+voodoo_capture_open(voodoo_t *voodoo)
+{
+    voodoo_capture_t       *capture;
+    voodoo_capture_header_t header = {
+        .magic        = VOODOO_CAPTURE_MAGIC,
+        .version      = VOODOO_CAPTURE_VERSION,
+        .type         = voodoo->type,
+        .fb_mask      = voodoo->fb_mask,
+        .texture_mask = voodoo->texture_mask,
+        .dual_tmus    = voodoo->dual_tmus
+    };
+    char fn[1024];
+    char temp[32];
+    FILE *fp;
+
+    sprintf(temp, "voodoo%i.vcap", capture_nr++);
+    path_append_filename(fn, usr_path, temp);
+
+    fp = plat_fopen(fn, "wb");
+    if (fp == NULL) {
+        voodoo_capture_log("Voodoo capture: unable to open %s\n", fn);
+        return;
+    }
+
+    capture     = calloc(1, sizeof(voodoo_capture_t));
+    capture->fp = fp;
+    setvbuf(fp, NULL, _IOFBF, CAPTURE_BUFFER_SIZE);
+    fwrite(&header, sizeof(header), 1, fp);
+
+    voodoo->capture = capture;
+    capture_write_state(voodoo);
+
+    voodoo_capture_log("Voodoo capture: writing %s\n", fn);
+}
+
+void
+voodoo_capture_close(voodoo_t *voodoo)
+{
+    voodoo_capture_t *capture = voodoo->capture;
+
+    if (capture == NULL)
+        return;
+
+    voodoo->capture = NULL;
+    fclose(capture->fp);
+
+    voodoo_capture_log("Voodoo capture: %i frames\n", capture->frames);
+
+    free(capture);
+}
@@ -575,6 +575,10 @@ voodoo_callback(void *priv)
                 for (x = 0; x < v_x_add; x++)
                     monitor->target_buffer->line[voodoo->line + v_y_add][voodoo->h_disp + x + v_x_add] =
                     0x00000000;
+
+                /* svga_doblit() only hands marked lines on to the blitter. */
+                if (voodoo->svga)
+                    voodoo->svga->dirty_lines[(voodoo->line + v_y_add) & 0x7ff] = 1;
             }
         }
     }
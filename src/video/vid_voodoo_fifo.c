@@ -37,6 +37,7 @@
 #include <86box/vid_voodoo_common.h>
 #include <86box/vid_voodoo_banshee.h>
 #include <86box/vid_voodoo_banshee_blitter.h>
+#include <86box/vid_voodoo_capture.h>
 #include <86box/vid_voodoo_fb.h>
 #include <86box/vid_voodoo_fifo.h>
 #include <86box/vid_voodoo_reg.h>
@@ -160,19 +161,26 @@ cmdfifo_get(voodoo_t *voodoo)
 {
     uint32_t val;
 
-    if (!voodoo->cmdfifo_in_sub) {
-        while (voodoo->fifo_thread_run && (voodoo->cmdfifo_depth_rd == voodoo->cmdfifo_depth_wr)) {
-            thread_wait_event(voodoo->wake_fifo_thread, -1);
-            thread_reset_event(voodoo->wake_fifo_thread);
+    if (voodoo->replay) {
+        /*The words come from the capture rather than from memory*/
+        val = voodoo_replay_cmdfifo_get(voodoo, 0);
+    } else {
+        if (!voodoo->cmdfifo_in_sub) {
+            while (voodoo->fifo_thread_run && (voodoo->cmdfifo_depth_rd == voodoo->cmdfifo_depth_wr)) {
+                thread_wait_event(voodoo->wake_fifo_thread, -1);
+                thread_reset_event(voodoo->wake_fifo_thread);
+            }
         }
+
+        if (voodoo->cmdfifo_in_agp)
+            val = mem_readl_phys(voodoo->cmdfifo_rp);
+        else
+            val = *(uint32_t *) &voodoo->fb_mem[voodoo->cmdfifo_rp & voodoo->fb_mask];
     }
 
-    if (voodoo->cmdfifo_in_agp)
-        val = mem_readl_phys(voodoo->cmdfifo_rp);
-    else
-        val = *(uint32_t *) &voodoo->fb_mem[voodoo->cmdfifo_rp & voodoo->fb_mask];
+    voodoo_capture(voodoo, VOODOO_CAPTURE_CMDFIFO | (voodoo->cmdfifo_rp & 0xffffff), val);
 
-    if (!voodoo->cmdfifo_in_sub)
+    if (!voodoo->cmdfifo_in_sub && !voodoo->replay)
         voodoo->cmdfifo_depth_rd++;
     voodoo->cmdfifo_rp += 4;
 
@@ -197,19 +205,26 @@ cmdfifo_get_2(voodoo_t *voodoo)
 {
     uint32_t val;
 
-    if (!voodoo->cmdfifo_in_sub_2) {
-        while (voodoo->fifo_thread_run && (voodoo->cmdfifo_depth_rd_2 == voodoo->cmdfifo_depth_wr_2)) {
-            thread_wait_event(voodoo->wake_fifo_thread, -1);
-            thread_reset_event(voodoo->wake_fifo_thread);
+    if (voodoo->replay) {
+        /*The words come from the capture rather than from memory*/
+        val = voodoo_replay_cmdfifo_get(voodoo, 1);
+    } else {
+        if (!voodoo->cmdfifo_in_sub_2) {
+            while (voodoo->fifo_thread_run && (voodoo->cmdfifo_depth_rd_2 == voodoo->cmdfifo_depth_wr_2)) {
+                thread_wait_event(voodoo->wake_fifo_thread, -1);
+                thread_reset_event(voodoo->wake_fifo_thread);
+            }
         }
+
+        if (voodoo->cmdfifo_in_agp_2)
+            val = mem_readl_phys(voodoo->cmdfifo_rp_2);
+        else
+            val = *(uint32_t *) &voodoo->fb_mem[voodoo->cmdfifo_rp_2 & voodoo->fb_mask];
     }
 
-    if (voodoo->cmdfifo_in_agp_2)
-        val = mem_readl_phys(voodoo->cmdfifo_rp_2);
-    else
-        val = *(uint32_t *) &voodoo->fb_mem[voodoo->cmdfifo_rp_2 & voodoo->fb_mask];
+    voodoo_capture(voodoo, VOODOO_CAPTURE_CMDFIFO_2 | (voodoo->cmdfifo_rp_2 & 0xffffff), val);
 
-    if (!voodoo->cmdfifo_in_sub_2)
+    if (!voodoo->cmdfifo_in_sub_2 && !voodoo->replay)
         voodoo->cmdfifo_depth_rd_2++;
     voodoo->cmdfifo_rp_2 += 4;
 
@@ -260,6 +275,7 @@ voodoo_fifo_thread(void *param)
             switch (fifo->addr_type & FIFO_TYPE) {
                 case FIFO_WRITEL_REG:
                     while ((fifo->addr_type & FIFO_TYPE) == FIFO_WRITEL_REG) {
+                        voodoo_capture(voodoo, fifo->addr_type, fifo->val);
                         voodoo_reg_writel(fifo->addr_type & FIFO_ADDR, fifo->val, voodoo);
                         fifo->addr_type = FIFO_INVALID;
                         voodoo->fifo_read_idx++;
@@ -271,6 +287,7 @@ voodoo_fifo_thread(void *param)
                 case FIFO_WRITEW_FB:
                     voodoo_wait_for_render_thread_idle(voodoo);
                     while ((fifo->addr_type & FIFO_TYPE) == FIFO_WRITEW_FB) {
+                        voodoo_capture(voodoo, fifo->addr_type, fifo->val);
                         voodoo_fb_writew(fifo->addr_type & FIFO_ADDR, fifo->val, voodoo);
                         fifo->addr_type = FIFO_INVALID;
                         voodoo->fifo_read_idx++;
@@ -282,6 +299,7 @@ voodoo_fifo_thread(void *param)
                 case FIFO_WRITEL_FB:
                     voodoo_wait_for_render_thread_idle(voodoo);
                     while ((fifo->addr_type & FIFO_TYPE) == FIFO_WRITEL_FB) {
+                        voodoo_capture(voodoo, fifo->addr_type, fifo->val);
                         voodoo_fb_writel(fifo->addr_type & FIFO_ADDR, fifo->val, voodoo);
                         fifo->addr_type = FIFO_INVALID;
                         voodoo->fifo_read_idx++;
@@ -292,6 +310,7 @@ voodoo_fifo_thread(void *param)
                     break;
                 case FIFO_WRITEL_TEX:
                     while ((fifo->addr_type & FIFO_TYPE) == FIFO_WRITEL_TEX) {
+                        voodoo_capture(voodoo, fifo->addr_type, fifo->val);
                         if (!(fifo->addr_type & 0x400000))
                             voodoo_tex_writel(fifo->addr_type & FIFO_ADDR, fifo->val, voodoo);
                         fifo->addr_type = FIFO_INVALID;
@@ -303,6 +322,7 @@ voodoo_fifo_thread(void *param)
                     break;
                 case FIFO_WRITEL_2DREG:
                     while ((fifo->addr_type & FIFO_TYPE) == FIFO_WRITEL_2DREG) {
+                        voodoo_capture(voodoo, fifo->addr_type, fifo->val);
                         voodoo_2d_reg_writel(voodoo, fifo->addr_type & FIFO_ADDR, fifo->val);
                         fifo->addr_type = FIFO_INVALID;
                         voodoo->fifo_read_idx++;
@@ -326,7 +346,8 @@ voodoo_fifo_thread(void *param)
         voodoo->cmd_status |= (1 << 24);
         voodoo->cmd_status_2 |= (1 << 24);
 
-        while (voodoo->cmdfifo_enabled && (voodoo->cmdfifo_depth_rd != voodoo->cmdfifo_depth_wr || voodoo->cmdfifo_in_sub)) {
+        while (voodoo->replay ? voodoo_replay_cmdfifo_pending(voodoo, 0) :
+                                (voodoo->cmdfifo_enabled && (voodoo->cmdfifo_depth_rd != voodoo->cmdfifo_depth_wr || voodoo->cmdfifo_in_sub))) {
             uint64_t start_time = plat_timer_read();
             uint64_t end_time;
             uint32_t header = cmdfifo_get(voodoo);
@@ -617,7 +638,8 @@ voodoo_fifo_thread(void *param)
             voodoo->time += end_time - start_time;
         }
 
-        while (voodoo->cmdfifo_enabled_2 && (voodoo->cmdfifo_depth_rd_2 != voodoo->cmdfifo_depth_wr_2 || voodoo->cmdfifo_in_sub_2)) {
+        while (voodoo->replay ? voodoo_replay_cmdfifo_pending(voodoo, 1) :
+                                (voodoo->cmdfifo_enabled_2 && (voodoo->cmdfifo_depth_rd_2 != voodoo->cmdfifo_depth_wr_2 || voodoo->cmdfifo_in_sub_2))) {
             uint64_t start_time = plat_timer_read();
             uint64_t end_time;
             uint32_t header = cmdfifo_get_2(voodoo);
@@ -37,6 +37,7 @@
 #include <86box/vid_voodoo_common.h>
 #include <86box/vid_voodoo_banshee.h>
 #include <86box/vid_voodoo_blitter.h>
+#include <86box/vid_voodoo_capture.h>
 #include <86box/vid_voodoo_dither.h>
 #include <86box/vid_voodoo_fifo.h>
 #include <86box/vid_voodoo_regs.h>
@@ -98,6 +99,7 @@ voodoo_reg_writel(uint32_t addr, uint32_t val, void *priv)
         addr |= 0x400;
     switch (addr) {
         case SST_swapbufferCMD:
+            voodoo_capture_frame(voodoo);
             if (voodoo->type >= VOODOO_BANSHEE) {
 #if 0
                 voodoo_reg_log("swapbufferCMD %08x %08x\n", val, voodoo->leftOverlayBuf);
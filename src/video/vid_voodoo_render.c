@@ -659,12 +659,50 @@ voodoo_tmu_fetch_and_blend(voodoo_t *voodoo, voodoo_params_t *params, voodoo_sta
 #    include <86box/vid_voodoo_codegen_x86.h>
 #elif (defined __amd64__ || defined _M_X64)
 #    include <86box/vid_voodoo_codegen_x86-64.h>
+#elif (defined __aarch64__ || defined _M_ARM64) && !defined NO_CODEGEN
+#    include <86box/vid_voodoo_codegen_arm64.h>
 #else
 int voodoo_recomp = 0;
 #endif
 
+/*Step the per-line interpolants by dy lines*/
+static inline void
+voodoo_step_lines(voodoo_params_t *params, voodoo_state_t *state, int dy)
+{
+    state->base_r += params->dRdY * dy;
+    state->base_g += params->dGdY * dy;
+    state->base_b += params->dBdY * dy;
+    state->base_a += params->dAdY * dy;
+    state->base_z += params->dZdY * dy;
+    state->tmu[0].base_s += params->tmu[0].dSdY * dy;
+    state->tmu[0].base_t += params->tmu[0].dTdY * dy;
+    state->tmu[0].base_w += params->tmu[0].dWdY * dy;
+    state->tmu[1].base_s += params->tmu[1].dSdY * dy;
+    state->tmu[1].base_t += params->tmu[1].dTdY * dy;
+    state->tmu[1].base_w += params->tmu[1].dWdY * dy;
+    state->base_w += params->dWdY * dy;
+    state->xstart += state->dx1 * dy;
+    state->xend += state->dx2 * dy;
+}
+
+/*Number of steps from band line `line` to the next line belonging to `band`,
+  or 0 if it already does. dir is the direction the band line moves per step*/
+static inline int
+voodoo_band_skip(int line, int band, int dir)
+{
+    int group = line >> VOODOO_RENDER_BAND_SHIFT;
+
+    if ((group & (VOODOO_RENDER_BANDS - 1)) == band)
+        return 0;
+
+    if (dir > 0)
+        return ((group + ((band - group) & (VOODOO_RENDER_BANDS - 1))) << VOODOO_RENDER_BAND_SHIFT) - line;
+
+    return line - ((((group - ((group - band) & (VOODOO_RENDER_BANDS - 1))) + 1) << VOODOO_RENDER_BAND_SHIFT) - 1);
+}
+
 static void
-voodoo_half_triangle(voodoo_t *voodoo, voodoo_params_t *params, voodoo_state_t *state, int ystart, int yend, int odd_even)
+voodoo_half_triangle(voodoo_t *voodoo, voodoo_params_t *params, voodoo_state_t *state, int ystart, int yend, int band, int thread)
 {
 #if 0
     int rgb_sel                 = params->fbzColorPath & 3;
@@ -728,22 +766,7 @@ voodoo_half_triangle(voodoo_t *voodoo, voodoo_params_t *params, voodoo_state_t *
     state->tex_lod[1]    = params->tex_lod[1];
 
     if ((params->fbzMode & 1) && (ystart < params->clipLowY)) {
-        int dy = params->clipLowY - ystart;
-
-        state->base_r += params->dRdY * dy;
-        state->base_g += params->dGdY * dy;
-        state->base_b += params->dBdY * dy;
-        state->base_a += params->dAdY * dy;
-        state->base_z += params->dZdY * dy;
-        state->tmu[0].base_s += params->tmu[0].dSdY * dy;
-        state->tmu[0].base_t += params->tmu[0].dTdY * dy;
-        state->tmu[0].base_w += params->tmu[0].dWdY * dy;
-        state->tmu[1].base_s += params->tmu[1].dSdY * dy;
-        state->tmu[1].base_t += params->tmu[1].dTdY * dy;
-        state->tmu[1].base_w += params->tmu[1].dWdY * dy;
-        state->base_w += params->dWdY * dy;
-        state->xstart += state->dx1 * dy;
-        state->xend += state->dx2 * dy;
+        voodoo_step_lines(params, state, params->clipLowY - ystart);
 
         ystart = params->clipLowY;
     }
@@ -785,7 +808,7 @@ voodoo_half_triangle(voodoo_t *voodoo, voodoo_params_t *params, voodoo_state_t *
     }
 #ifndef NO_CODEGEN
     if (voodoo->use_recompiler)
-        voodoo_draw = voodoo_get_block(voodoo, params, state, odd_even);
+        voodoo_draw = voodoo_get_block(voodoo, params, state, thread);
     else
         voodoo_draw = NULL;
 #endif
@@ -829,12 +852,16 @@ voodoo_half_triangle(voodoo_t *voodoo, voodoo_params_t *params, voodoo_state_t *
         else
             real_y >>= 4;
 
-        if (SLI_ENABLED) {
-            if (((real_y >> 1) & voodoo->odd_even_mask) != odd_even)
-                goto next_line;
-        } else {
-            if ((real_y & voodoo->odd_even_mask) != odd_even)
+        if (voodoo->render_bands > 1) {
+            int skip = voodoo_band_skip(SLI_ENABLED ? (real_y >> 1) : real_y, band, (params->fbzMode & (1 << 17)) ? -1 : 1);
+
+            /*Jump straight to the line before the next one in this band,
+              next_line then steps onto it*/
+            if (skip) {
+                state->y += (skip - 1) * y_diff;
+                voodoo_step_lines(params, state, (skip - 1) * y_diff);
                 goto next_line;
+            }
         }
 
         start_x = x;
@@ -936,7 +963,7 @@ voodoo_half_triangle(voodoo_t *voodoo, voodoo_params_t *params, voodoo_state_t *
         state->x           = x;
         state->x2          = x2;
 #ifndef NO_CODEGEN
-        if (voodoo->use_recompiler) {
+        if (voodoo->use_recompiler && voodoo_draw) {
             voodoo_draw(state, params, x, real_y);
         } else
 #endif
@@ -944,8 +971,8 @@ voodoo_half_triangle(voodoo_t *voodoo, voodoo_params_t *params, voodoo_state_t *
                 int x_tiled = (x & 63) | ((x >> 6) * 128 * 32 / 2);
                 start_x     = x;
                 state->x    = x;
-                voodoo->pixel_count[odd_even]++;
-                voodoo->texel_count[odd_even] += texels;
+                voodoo->pixel_count[thread]++;
+                voodoo->texel_count[thread] += texels;
                 voodoo->fbiPixelsIn++;
 
                 voodoo_render_log("  X=%03i T=%08x\n", x, state->tmu0_t);
@@ -1353,8 +1380,8 @@ skip_pixel:
                 x += state->xdir;
             } while (start_x != x2);
 
-        voodoo->pixel_count[odd_even] += state->pixel_count;
-        voodoo->texel_count[odd_even] += state->texel_count;
+        voodoo->pixel_count[thread] += state->pixel_count;
+        voodoo->texel_count[thread] += state->texel_count;
         voodoo->fbiPixelsIn += state->pixel_count;
 
         if (voodoo->params.draw_offset == voodoo->params.front_offset && (real_y >> 1) < 2048)
@@ -1392,13 +1419,51 @@ next_line:
         state->xstart += state->dx1;
         state->xend += state->dx2;
     }
+}
+
+/*Conservative check of whether a triangle can touch any line of band*/
+static int
+voodoo_triangle_in_band(voodoo_t *voodoo, voodoo_params_t *params, int band)
+{
+    int y_origin = (voodoo->type >= VOODOO_BANSHEE) ? voodoo->y_origin_swap : (voodoo->v_disp - 1);
+    int vertexAy = params->vertexAy & 0xffff;
+    int vertexCy = params->vertexCy & 0xffff;
+    int ystart;
+    int yend;
+    int first;
+    int last;
+
+    if (voodoo->render_bands == 1)
+        return 1;
+
+    if (vertexAy & 0x8000)
+        vertexAy |= 0xffff0000;
+    if (vertexCy & 0x8000)
+        vertexCy |= 0xffff0000;
+    ystart = (vertexAy + 7) >> 4;
+    yend   = (vertexCy + 7) >> 4;
+    if (yend <= ystart)
+        return 0;
+
+    if (params->fbzMode & (1 << 17)) {
+        first = y_origin - (yend - 1);
+        last  = y_origin - ystart;
+    } else {
+        first = ystart;
+        last  = yend - 1;
+    }
+    if (SLI_ENABLED) {
+        first >>= 1;
+        last >>= 1;
+    }
+    first >>= VOODOO_RENDER_BAND_SHIFT;
+    last >>= VOODOO_RENDER_BAND_SHIFT;
 
-    voodoo->texture_cache[0][params->tex_entry[0]].refcount_r[odd_even]++;
-    voodoo->texture_cache[1][params->tex_entry[1]].refcount_r[odd_even]++;
+    return ((band - first) & (VOODOO_RENDER_BANDS - 1)) <= (last - first);
 }
 
-void
-voodoo_triangle(voodoo_t *voodoo, voodoo_params_t *params, int odd_even)
+static void
+voodoo_triangle(voodoo_t *voodoo, voodoo_params_t *params, int band, int thread)
 {
     voodoo_state_t state = { 0 };
     int            vertexAy_adjusted;
@@ -1412,9 +1477,10 @@ voodoo_triangle(voodoo_t *voodoo, voodoo_params_t *params, int odd_even)
     int      LOD;
     int      lodbias;
 
-    state.dx1 = state.dx2 = 0;
+    if (!voodoo_triangle_in_band(voodoo, params, band))
+        return;
 
-    voodoo->tri_count++;
+    state.dx1 = state.dx2 = 0;
 
     dx = 8 - (params->vertexAx & 0xf);
     if ((params->vertexAx & 0xf) > 8)
@@ -1425,7 +1491,7 @@ voodoo_triangle(voodoo_t *voodoo, voodoo_params_t *params, int odd_even)
 
 #if 0
 voodoo_render_log("voodoo_triangle %i %i %i : vA %f, %f  vB %f, %f  vC %f, %f f %i,%i %08x %08x %08x,%08x tex=%i,%i fogMode=%08x\n",
-                  odd_even, voodoo->params_read_idx[odd_even], voodoo->params_read_idx[odd_even] & PARAM_MASK, (float)params->vertexAx / 16.0, (float)params->vertexAy / 16.0,
+                  band, voodoo->params_read_idx[band], voodoo->params_read_idx[band] & PARAM_MASK, (float)params->vertexAx / 16.0, (float)params->vertexAy / 16.0,
                   (float)params->vertexBx / 16.0, (float)params->vertexBy / 16.0,
                   (float)params->vertexCx / 16.0, (float)params->vertexCy / 16.0,
                   (params->fbzColorPath & FBZCP_TEXTURE_ENABLED) ? params->tformat[0] : 0,
@@ -1545,92 +1611,309 @@ voodoo_render_log("voodoo_triangle %i %i %i : vA %f, %f  vB %f, %f  vC %f, %f f
         lodbias |= ~0x3f;
     state.tmu[1].lod = LOD + (lodbias << 6);
 
-    voodoo_half_triangle(voodoo, params, &state, vertexAy_adjusted, vertexCy_adjusted, odd_even);
+    voodoo_half_triangle(voodoo, params, &state, vertexAy_adjusted, vertexCy_adjusted, band, thread);
 }
 
+/*Called by each band once it has moved past a triangle. The last band to do so
+  releases the textures the triangle used*/
 static void
-render_thread(void *param, int odd_even)
+voodoo_retire_triangle(voodoo_t *voodoo, voodoo_params_t *params, int idx)
+{
+    if (atomic_fetch_sub(&voodoo->params_bands_left[idx & PARAM_MASK], 1) == 1) {
+        voodoo->texture_cache[0][params->tex_entry[0]].refcount_r++;
+        voodoo->texture_cache[1][params->tex_entry[1]].refcount_r++;
+    }
+}
+
+/*Claim band and render every triangle queued for it. Returns 0 if the band
+  had no work or another thread already owns it*/
+static int
+render_band(voodoo_t *voodoo, int band, int thread)
 {
-    voodoo_t *voodoo = (voodoo_t *) param;
+    int expected = 0;
+
+    if (PARAM_EMPTY(band))
+        return 0;
+    if (!atomic_compare_exchange_strong(&voodoo->params_band_claimed[band], &expected, 1))
+        return 0;
+
+    while (!PARAM_EMPTY(band)) {
+        int              idx    = voodoo->params_read_idx[band];
+        voodoo_params_t *params = &voodoo->params_buffer[idx & PARAM_MASK];
+
+        voodoo_triangle(voodoo, params, band, thread);
+        voodoo_retire_triangle(voodoo, params, idx);
+
+        voodoo->params_read_idx[band]++;
 
-    while (voodoo->render_thread_run[odd_even]) {
-        thread_set_event(voodoo->render_not_full_event[odd_even]);
-        thread_wait_event(voodoo->wake_render_thread[odd_even], -1);
-        thread_reset_event(voodoo->wake_render_thread[odd_even]);
-        voodoo->render_voodoo_busy[odd_even] = 1;
+        if (PARAM_ENTRIES(band) > (PARAM_SIZE - 10))
+            thread_set_event(voodoo->render_not_full_event);
+    }
+
+    voodoo->params_band_claimed[band] = 0;
+
+    return 1;
+}
+
+static void
+render_thread(void *param)
+{
+    voodoo_render_worker_t *worker = (voodoo_render_worker_t *) param;
+    voodoo_t               *voodoo = worker->voodoo;
+    int                     thread = worker->index;
+    /*Spread the threads' starting bands so they don't all contend for the same one*/
+    int first_band = (thread * voodoo->render_bands) / voodoo->render_threads;
 
-        while (!PARAM_EMPTY(odd_even)) {
-            uint64_t         start_time = plat_timer_read();
-            uint64_t         end_time;
-            voodoo_params_t *params = &voodoo->params_buffer[voodoo->params_read_idx[odd_even] & PARAM_MASK];
+    while (voodoo->render_thread_run[thread]) {
+        int progress;
 
-            voodoo_triangle(voodoo, params, odd_even);
+        thread_set_event(voodoo->render_not_full_event);
+        thread_wait_event(voodoo->wake_render_thread[thread], -1);
+        thread_reset_event(voodoo->wake_render_thread[thread]);
+        voodoo->render_voodoo_busy[thread] = 1;
 
-            voodoo->params_read_idx[odd_even]++;
+        do {
+            uint64_t start_time = plat_timer_read();
+            uint64_t end_time;
 
-            if (PARAM_ENTRIES(odd_even) > (PARAM_SIZE - 10))
-                thread_set_event(voodoo->render_not_full_event[odd_even]);
+            progress = 0;
+            for (int c = 0; c < voodoo->render_bands; c++)
+                progress |= render_band(voodoo, (first_band + c) & (voodoo->render_bands - 1), thread);
 
             end_time = plat_timer_read();
-            voodoo->render_time[odd_even] += end_time - start_time;
-        }
+            voodoo->render_time[thread] += end_time - start_time;
+        } while (progress);
 
-        voodoo->render_voodoo_busy[odd_even] = 0;
+        voodoo->render_voodoo_busy[thread] = 0;
     }
 }
 
 void
-voodoo_render_thread_1(void *param)
+voodoo_render_threads_init(voodoo_t *voodoo)
 {
-    render_thread(param, 0);
+    if (voodoo->render_threads < 1)
+        voodoo->render_threads = 1;
+    else if (voodoo->render_threads > VOODOO_MAX_RENDER_THREADS)
+        voodoo->render_threads = VOODOO_MAX_RENDER_THREADS;
+    voodoo->render_bands = (voodoo->render_threads == 1) ? 1 : VOODOO_RENDER_BANDS;
+
+    voodoo->render_not_full_event = thread_create_event();
+    for (int c = 0; c < voodoo->render_threads; c++) {
+        voodoo->render_worker[c].voodoo = voodoo;
+        voodoo->render_worker[c].index  = c;
+        voodoo->wake_render_thread[c]   = thread_create_event();
+        voodoo->render_thread_run[c]    = 1;
+        voodoo->render_thread[c]        = thread_create(render_thread, &voodoo->render_worker[c]);
+    }
 }
+
 void
-voodoo_render_thread_2(void *param)
+voodoo_render_threads_close(voodoo_t *voodoo)
 {
-    render_thread(param, 1);
+    for (int c = 0; c < voodoo->render_threads; c++) {
+        voodoo->render_thread_run[c] = 0;
+        thread_set_event(voodoo->wake_render_thread[c]);
+        thread_wait(voodoo->render_thread[c]);
+        thread_destroy_event(voodoo->wake_render_thread[c]);
+    }
+    thread_destroy_event(voodoo->render_not_full_event);
 }
-void
-voodoo_render_thread_3(void *param)
+
+static int
+voodoo_params_full(voodoo_t *voodoo)
 {
-    render_thread(param, 2);
+    for (int c = 0; c < voodoo->render_bands; c++) {
+        if (PARAM_FULL(c))
+            return 1;
+    }
+
+    return 0;
 }
-void
-voodoo_render_thread_4(void *param)
+
+static void
+voodoo_queue_params(voodoo_t *voodoo, voodoo_params_t *params)
 {
-    render_thread(param, 3);
+    voodoo_params_t *params_new = &voodoo->params_buffer[voodoo->params_write_idx & PARAM_MASK];
+
+    memcpy(params_new, params, sizeof(voodoo_params_t));
+    voodoo->params_bands_left[voodoo->params_write_idx & PARAM_MASK] = voodoo->render_bands;
+
+    voodoo->params_write_idx++;
+    voodoo->tri_count++;
+
+    /*A thread only sleeps once it has seen every band empty, so waking is only
+      needed while some band is close to empty*/
+    for (int c = 0; c < voodoo->render_bands; c++) {
+        if (PARAM_ENTRIES(c) < 4) {
+            voodoo_wake_render_thread(voodoo);
+            break;
+        }
+    }
 }
 
 void
 voodoo_queue_triangle(voodoo_t *voodoo, voodoo_params_t *params)
 {
-    voodoo_params_t *params_new = &voodoo->params_buffer[voodoo->params_write_idx & PARAM_MASK];
-
-    while (PARAM_FULL(0) || (voodoo->render_threads >= 2 && PARAM_FULL(1)) || (voodoo->render_threads == 4 && (PARAM_FULL(2) || PARAM_FULL(3)))) {
-        thread_reset_event(voodoo->render_not_full_event[0]);
-        if (voodoo->render_threads >= 2)
-            thread_reset_event(voodoo->render_not_full_event[1]);
-        if (voodoo->render_threads == 4) {
-            thread_reset_event(voodoo->render_not_full_event[2]);
-            thread_reset_event(voodoo->render_not_full_event[3]);
-        }
-        if (PARAM_FULL(0))
-            thread_wait_event(voodoo->render_not_full_event[0], -1); /*Wait for room in ringbuffer*/
-        if (voodoo->render_threads >= 2 && PARAM_FULL(1))
-            thread_wait_event(voodoo->render_not_full_event[1], -1); /*Wait for room in ringbuffer*/
-        if (voodoo->render_threads == 4 && PARAM_FULL(2))
-            thread_wait_event(voodoo->render_not_full_event[2], -1); /*Wait for room in ringbuffer*/
-        if (voodoo->render_threads == 4 && PARAM_FULL(3))
-            thread_wait_event(voodoo->render_not_full_event[3], -1); /*Wait for room in ringbuffer*/
+    while (voodoo_params_full(voodoo)) {
+        thread_reset_event(voodoo->render_not_full_event);
+        if (voodoo_params_full(voodoo))
+            thread_wait_event(voodoo->render_not_full_event, -1); /*Wait for room in ringbuffer*/
     }
 
     voodoo_use_texture(voodoo, params, 0);
     if (voodoo->dual_tmus)
         voodoo_use_texture(voodoo, params, 1);
 
-    memcpy(params_new, params, sizeof(voodoo_params_t));
+    voodoo_queue_params(voodoo, params);
+}
 
-    voodoo->params_write_idx++;
+#ifdef ENABLE_VOODOO_RENDER_CHECK
+#    define RENDER_CHECK_WIDTH  640
+#    define RENDER_CHECK_HEIGHT 480
+#    define RENDER_CHECK_SIZE   (RENDER_CHECK_WIDTH * RENDER_CHECK_HEIGHT * 2)
+#    define RENDER_CHECK_MASK   ((4 << 20) - 1)
+#    define RENDER_CHECK_TRIS   2048
+
+static uint32_t
+render_check_rand(uint32_t *seed)
+{
+    *seed = (*seed * 1103515245) + 12345;
 
-    if (PARAM_ENTRIES(0) < 4 || (voodoo->render_threads >= 2 && PARAM_ENTRIES(1) < 4) || (voodoo->render_threads == 4 && (PARAM_ENTRIES(2) < 4 || PARAM_ENTRIES(3) < 4)))
-        voodoo_wake_render_thread(voodoo);
+    return *seed >> 8;
 }
+
+static int32_t
+render_check_range(uint32_t *seed, int min, int max)
+{
+    return min + (int32_t) (render_check_rand(seed) % (uint32_t) (max - min));
+}
+
+/*Untextured, so the stream needs nothing from the texture cache*/
+static void
+render_check_triangle(voodoo_params_t *params, uint32_t *seed)
+{
+    int32_t x[3];
+    int32_t y[3];
+    int32_t t;
+    int64_t area;
+
+    for (int c = 0; c < 3; c++) {
+        x[c] = render_check_range(seed, -16 * 16, (RENDER_CHECK_WIDTH + 16) * 16);
+        y[c] = render_check_range(seed, -16 * 16, (RENDER_CHECK_HEIGHT + 16) * 16);
+    }
+    for (int c = 0; c < 2; c++) {
+        for (int d = 0; d < (2 - c); d++) {
+            if (y[d] > y[d + 1]) {
+                t        = y[d];
+                y[d]     = y[d + 1];
+                y[d + 1] = t;
+                t        = x[d];
+                x[d]     = x[d + 1];
+                x[d + 1] = t;
+            }
+        }
+    }
+    area = ((int64_t) (x[0] - x[1]) * (y[1] - y[2])) - ((int64_t) (x[1] - x[2]) * (y[0] - y[1]));
+
+    memset(params, 0, sizeof(voodoo_params_t));
+    params->vertexAx = x[0];
+    params->vertexAy = y[0];
+    params->vertexBx = x[1];
+    params->vertexBy = y[1];
+    params->vertexCx = x[2];
+    params->vertexCy = y[2];
+    params->sign     = (area < 0);
+
+    params->startR = render_check_range(seed, 0, 256) << 12;
+    params->startG = render_check_range(seed, 0, 256) << 12;
+    params->startB = render_check_range(seed, 0, 256) << 12;
+    params->startA = render_check_range(seed, 0, 256) << 12;
+    params->startZ = render_check_range(seed, 0, 0x10000) << 12;
+    params->dRdX   = render_check_range(seed, -0x1000, 0x1000);
+    params->dGdX   = render_check_range(seed, -0x1000, 0x1000);
+    params->dBdX   = render_check_range(seed, -0x1000, 0x1000);
+    params->dAdX   = render_check_range(seed, -0x1000, 0x1000);
+    params->dZdX   = render_check_range(seed, -0x100000, 0x100000);
+    params->dRdY   = render_check_range(seed, -0x1000, 0x1000);
+    params->dGdY   = render_check_range(seed, -0x1000, 0x1000);
+    params->dBdY   = render_check_range(seed, -0x1000, 0x1000);
+    params->dAdY   = render_check_range(seed, -0x1000, 0x1000);
+    params->dZdY   = render_check_range(seed, -0x100000, 0x100000);
+
+    /*Depth test, blending and dithering all read back what earlier triangles
+      wrote, so any reordering between bands shows up in the output*/
+    params->fbzMode = 1 | FBZ_DEPTH_ENABLE | FBZ_RGB_WMASK | FBZ_DEPTH_WMASK | (render_check_range(seed, 0, 8) << 5);
+    if (render_check_rand(seed) & 1)
+        params->fbzMode |= FBZ_DITHER | ((render_check_rand(seed) & 1) ? FBZ_DITHER_2x2 : 0);
+    if (render_check_rand(seed) & 1)
+        params->fbzColorPath |= FBZ_PARAM_ADJUST;
+    if (render_check_rand(seed) & 1)
+        params->alphaMode = (1 << 4) | (render_check_range(seed, 0, 8) << 8) | (render_check_range(seed, 0, 8) << 12);
+
+    params->clipRight     = RENDER_CHECK_WIDTH;
+    params->clipHighY     = RENDER_CHECK_HEIGHT;
+    params->aux_offset    = RENDER_CHECK_SIZE;
+    params->row_width     = RENDER_CHECK_WIDTH * 2;
+    params->aux_row_width = RENDER_CHECK_WIDTH * 2;
+}
+
+/*Renders a fixed triangle stream with one band on this thread, which is what
+  a single render thread does, then again through the render threads, and
+  fatal()s if the two framebuffers differ. Runs on scratch memory, with the
+  card's render thread count and recompiler setting, before the card is used*/
+void
+voodoo_render_check(voodoo_t *voodoo)
+{
+    uint8_t        *fb_mem  = voodoo->fb_mem;
+    uint32_t        fb_mask = voodoo->fb_mask;
+    uint8_t        *ref     = malloc(RENDER_CHECK_MASK + 1);
+    uint8_t        *out     = malloc(RENDER_CHECK_MASK + 1);
+    int             bands   = voodoo->render_bands;
+    voodoo_params_t params;
+    uint32_t        seed;
+
+    for (int c = 0; c <= RENDER_CHECK_MASK; c++)
+        ref[c] = out[c] = c * 7;
+
+    voodoo->fb_mask = RENDER_CHECK_MASK;
+
+    voodoo->fb_mem       = ref;
+    voodoo->render_bands = 1;
+    seed                 = 1;
+    for (int c = 0; c < RENDER_CHECK_TRIS; c++) {
+        render_check_triangle(&params, &seed);
+        voodoo_triangle(voodoo, &params, 0, 0);
+    }
+    voodoo->render_bands = bands;
+
+    voodoo->fb_mem = out;
+    seed           = 1;
+    for (int c = 0; c < RENDER_CHECK_TRIS; c++) {
+        render_check_triangle(&params, &seed);
+        while (voodoo_params_full(voodoo))
+            voodoo_wait_for_render_thread_idle(voodoo);
+        /*Balanced by voodoo_retire_triangle()*/
+        voodoo->texture_cache[0][0].refcount++;
+        voodoo->texture_cache[1][0].refcount++;
+        voodoo_queue_params(voodoo, &params);
+    }
+    voodoo_wait_for_render_thread_idle(voodoo);
+
+    voodoo->fb_mem  = fb_mem;
+    voodoo->fb_mask = fb_mask;
+
+    voodoo->fbiPixelsIn = voodoo->fbiChromaFail = voodoo->fbiZFuncFail = voodoo->fbiAFuncFail = voodoo->fbiPixelsOut = 0;
+    memset(voodoo->pixel_count, 0, sizeof(voodoo->pixel_count));
+    memset(voodoo->texel_count, 0, sizeof(voodoo->texel_count));
+
+    for (int c = 0; c < (RENDER_CHECK_SIZE * 2); c++) {
+        if (ref[c] != out[c])
+            fatal("Voodoo render check: %i render threads differ from one at offset %08x\n", voodoo->render_threads, c);
+    }
+
+    voodoo_render_log("Voodoo render check: %i render threads match one\n", voodoo->render_threads);
+
+    free(ref);
+    free(out);
+}
+#endif
@@ -0,0 +1,382 @@
+/*
+ * 86Box    A hypervisor and IBM PC system emulator that specializes in
+ *          running old operating systems and software designed for IBM
+ *          PC systems and compatibles from 1981 through fairly recent
+ *          system designs based on the PCI bus.
+ *
+ *          This file is part of the 86Box distribution.
+ *
+ *          Voodoo Graphics, 2, Banshee, 3 command stream replay.
+ *
+ *          Started with --replay (-A) path, the first Voodoo card of the
+ *          configured machine is driven from a capture written by
+ *          vid_voodoo_capture.c instead of by the guest. A timer on the
+ *          CPU thread feeds FIFO records through voodoo_queue_command()
+ *          and applies STATE records the way the CPU wrote them, while
+ *          the FIFO thread takes CMDFIFO words from the capture instead
+ *          of from memory. Records of one kind are only fed once the
+ *          card has finished with those of another, so they run in the
+ *          order they were captured.
+ *
+ *          At every swap the draw buffer checksum is compared with the
+ *          one in the capture. Once the capture is exhausted the result
+ *          is logged and, in benchmark mode (-B 0), the run ends with
+ *          exit code 0 if every frame matched and 1 otherwise, so
+ *          captures made with one render thread can be replayed with
+ *          several (or with the recompiler off) to check the output.
+ *
+ *          The guest should leave the card alone while it is replayed,
+ *          so use a machine that does not boot an operating system.
+ *
+ *
+ *
+ *          Copyright 2026 The 86Box development team
+ */
+#include <stdarg.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include <stdlib.h>
+#include <stddef.h>
+#include <wchar.h>
+#define HAVE_STDARG_H
+#include <86box/86box.h>
+#include <86box/device.h>
+#include <86box/mem.h>
+#include <86box/timer.h>
+#include <86box/plat.h>
+#include <86box/thread.h>
+#include <86box/video.h>
+#include <86box/perf.h>
+#include <86box/vid_svga.h>
+#include <86box/vid_voodoo_common.h>
+#include <86box/vid_voodoo_capture.h>
+#include <86box/vid_voodoo_fifo.h>
+#include <86box/vid_voodoo_regs.h>
+#include <86box/vid_voodoo_render.h>
+
+#define REPLAY_CMDFIFO_SIZE  (1 << 16)
+#define REPLAY_CMDFIFO_MASK  (REPLAY_CMDFIFO_SIZE - 1)
+#define REPLAY_RECORDS_SLICE 16384
+#define REPLAY_POLL_DELAY    (TIMER_USEC * 100)
+#define REPLAY_STALL_POLLS   10000
+
+enum {
+    REPLAY_NONE = 0,
+    REPLAY_FIFO,
+    REPLAY_CMDFIFO,
+    REPLAY_CMDFIFO_2,
+    REPLAY_STATE
+};
+
+typedef struct voodoo_replay_t {
+    FILE    *fp;
+    uint32_t rec[2];
+    int      have_rec; /*rec was read but not fed yet*/
+    int      kind;     /*kind of the last record fed*/
+    int      done;
+    int      stalled; /*polls spent drained at the end of the capture*/
+
+    uint32_t  *checksums; /*of every frame in the capture*/
+    int        frames;
+    int        frame; /*frames swapped so far, counted by the FIFO thread*/
+    int        mismatches;
+    pc_timer_t timer;
+
+    uint32_t   cmdfifo[2][REPLAY_CMDFIFO_SIZE];
+    atomic_int cmdfifo_rd[2];
+    atomic_int cmdfifo_wr[2];
+} voodoo_replay_t;
+
+char voodoo_replay_path[1024] = { '\0' };
+
+static voodoo_t *replay_voodoo = NULL;
+
+#ifdef ENABLE_VOODOO_REPLAY_LOG
+int voodoo_replay_do_log = ENABLE_VOODOO_REPLAY_LOG;
+
+static void
+voodoo_replay_log(const char *fmt, ...)
+{
+    va_list ap;
+
+    if (voodoo_replay_do_log) {
+        va_start(ap, fmt);
+        pclog_ex(fmt, ap);
+        va_end(ap);
+    }
+}
+#else
+#    define voodoo_replay_log(fmt, ...)
+#endif
+
+static void
+replay_add_frame(void *priv, const voodoo_capture_frame_t *frame)
+{
+    voodoo_replay_t *replay = (voodoo_replay_t *) priv;
+
+    replay->checksums                   = realloc(replay->checksums, (replay->frames + 1) * sizeof(uint32_t));
+    replay->checksums[replay->frames++] = frame->checksum;
+}
+
+static int
+replay_kind(uint32_t addr_type)
+{
+    switch (addr_type & FIFO_TYPE) {
+        case FIFO_WRITEL_REG:
+        case FIFO_WRITEW_FB:
+        case FIFO_WRITEL_FB:
+        case FIFO_WRITEL_TEX:
+        case FIFO_WRITEL_2DREG:
+            return REPLAY_FIFO;
+        case VOODOO_CAPTURE_CMDFIFO:
+            return REPLAY_CMDFIFO;
+        case VOODOO_CAPTURE_CMDFIFO_2:
+            return REPLAY_CMDFIFO_2;
+        case VOODOO_CAPTURE_STATE:
+            return REPLAY_STATE;
+
+        default:
+            /*STAT and FRAME records are only read back, by replay_add_frame()*/
+            return REPLAY_NONE;
+    }
+}
+
+/*Everything fed so far has been taken by the FIFO thread and rendered. The
+  FIFO thread itself may still be busy, or waiting for the rest of a CMDFIFO
+  packet if the capture was cut short*/
+static int
+replay_drained(voodoo_t *voodoo)
+{
+    return FIFO_EMPTY && !voodoo_render_busy(voodoo) &&
+           !voodoo_replay_cmdfifo_pending(voodoo, 0) && !voodoo_replay_cmdfifo_pending(voodoo, 1);
+}
+
+/*Same side effects as the CPU writes in voodoo_writel(), voodoo_pci_write()
+  and the Banshee init/video registers*/
+static void
+replay_state(voodoo_t *voodoo, int id, uint32_t val)
+{
+    switch (id) {
+        case VOODOO_CAPTURE_STATE_FBIINIT0 + 0:
+            voodoo->fbiInit0 = val;
+            if (val & FBIINIT0_GRAPHICS_RESET) {
+                voodoo->disp_buffer = 0;
+                voodoo->draw_buffer = 1;
+                voodoo_recalc(voodoo);
+                voodoo->front_offset = voodoo->params.front_offset;
+            }
+            break;
+        case VOODOO_CAPTURE_STATE_FBIINIT0 + 1:
+            voodoo->fbiInit1 = val;
+            break;
+        case VOODOO_CAPTURE_STATE_FBIINIT0 + 2:
+            voodoo->fbiInit2 = val;
+            voodoo_recalc(voodoo);
+            break;
+        case VOODOO_CAPTURE_STATE_FBIINIT0 + 3:
+            voodoo->fbiInit3 = val;
+            break;
+        case VOODOO_CAPTURE_STATE_FBIINIT0 + 4:
+            voodoo->fbiInit4 = val;
+            break;
+        case VOODOO_CAPTURE_STATE_FBIINIT0 + 5:
+            voodoo->fbiInit5 = val;
+            break;
+        case VOODOO_CAPTURE_STATE_FBIINIT0 + 6:
+            voodoo->fbiInit6 = val;
+            break;
+        case VOODOO_CAPTURE_STATE_FBIINIT0 + 7:
+            voodoo->fbiInit7        = val;
+            voodoo->cmdfifo_enabled = val & FBIINIT7_CMDFIFO_ENABLE;
+            break;
+        case VOODOO_CAPTURE_STATE_INITENABLE:
+            voodoo->initEnable = val;
+            break;
+        case VOODOO_CAPTURE_STATE_H_DISP:
+            voodoo->h_disp = val;
+            break;
+        case VOODOO_CAPTURE_STATE_V_DISP:
+            voodoo->v_disp = val;
+            break;
+        case VOODOO_CAPTURE_STATE_Y_ORIGIN_SWAP:
+            voodoo->y_origin_swap = val;
+            break;
+
+        default:
+            break;
+    }
+}
+
+static void
+replay_finish(voodoo_t *voodoo)
+{
+    voodoo_replay_t *replay = voodoo->replay;
+    int              failed = replay->mismatches || (replay->frame != replay->frames);
+
+    replay->done = 1;
+
+    pclog("Voodoo replay: %i of %i frames replayed, %i differ from the capture\n",
+          replay->frame, replay->frames, replay->mismatches);
+
+    if (perf_bench_enabled)
+        perf_bench_stop(failed ? 1 : 0);
+}
+
+/*Feeds the card from the capture, on the CPU thread like the guest would*/
+static void
+replay_poll(void *priv)
+{
+    voodoo_t        *voodoo = (voodoo_t *) priv;
+    voodoo_replay_t *replay = voodoo->replay;
+    int              kind;
+    int              fifo;
+
+    for (int c = 0; c < REPLAY_RECORDS_SLICE; c++) {
+        if (!replay->have_rec) {
+            if (fread(replay->rec, sizeof(replay->rec), 1, replay->fp) != 1) {
+                /*Give the FIFO thread time to check the last swap*/
+                if (replay_drained(voodoo) &&
+                    (!voodoo->voodoo_busy || (++replay->stalled >= REPLAY_STALL_POLLS))) {
+                    replay_finish(voodoo);
+                    return;
+                }
+                break;
+            }
+            replay->have_rec = 1;
+        }
+
+        kind = replay_kind(replay->rec[0]);
+        if (kind == REPLAY_NONE) {
+            replay->have_rec = 0;
+            continue;
+        }
+
+        /*Let the card finish one kind of record before starting on another*/
+        if ((kind != replay->kind) && !replay_drained(voodoo))
+            break;
+
+        if (kind == REPLAY_FIFO) {
+            if (FIFO_ENTRIES >= (FIFO_SIZE / 2))
+                break;
+            voodoo_queue_command(voodoo, replay->rec[0], replay->rec[1]);
+        } else if (kind == REPLAY_STATE)
+            replay_state(voodoo, replay->rec[0] & FIFO_ADDR, replay->rec[1]);
+        else {
+            fifo = (kind == REPLAY_CMDFIFO_2);
+            if ((atomic_load(&replay->cmdfifo_wr[fifo]) - atomic_load(&replay->cmdfifo_rd[fifo])) >= REPLAY_CMDFIFO_SIZE)
+                break;
+            replay->cmdfifo[fifo][atomic_load(&replay->cmdfifo_wr[fifo]) & REPLAY_CMDFIFO_MASK] = replay->rec[1];
+            atomic_fetch_add(&replay->cmdfifo_wr[fifo], 1);
+        }
+
+        replay->kind     = kind;
+        replay->have_rec = 0;
+    }
+
+    voodoo_wake_fifo_thread_now(voodoo);
+    timer_advance_u64(&replay->timer, REPLAY_POLL_DELAY);
+}
+
+int
+voodoo_replay_cmdfifo_pending(voodoo_t *voodoo, int fifo)
+{
+    voodoo_replay_t *replay = voodoo->replay;
+
+    return atomic_load(&replay->cmdfifo_rd[fifo]) != atomic_load(&replay->cmdfifo_wr[fifo]);
+}
+
+/*Called by the FIFO thread in place of reading the CMDFIFO from memory*/
+uint32_t
+voodoo_replay_cmdfifo_get(voodoo_t *voodoo, int fifo)
+{
+    voodoo_replay_t *replay = voodoo->replay;
+    uint32_t         val;
+
+    while (voodoo->fifo_thread_run && !voodoo_replay_cmdfifo_pending(voodoo, fifo)) {
+        thread_wait_event(voodoo->wake_fifo_thread, -1);
+        thread_reset_event(voodoo->wake_fifo_thread);
+    }
+
+    if (!voodoo_replay_cmdfifo_pending(voodoo, fifo))
+        return 0;
+
+    val = replay->cmdfifo[fifo][atomic_load(&replay->cmdfifo_rd[fifo]) & REPLAY_CMDFIFO_MASK];
+    atomic_fetch_add(&replay->cmdfifo_rd[fifo], 1);
+
+    return val;
+}
+
+/*Called by the FIFO thread on swapbufferCMD, where the capture checksummed
+  the same buffer*/
+void
+voodoo_replay_end_frame(voodoo_t *voodoo)
+{
+    voodoo_replay_t *replay = voodoo->replay;
+    uint32_t         checksum;
+
+    voodoo_wait_for_render_thread_idle(voodoo);
+    checksum = voodoo_capture_checksum(voodoo);
+
+    if ((replay->frame >= replay->frames) || (checksum != replay->checksums[replay->frame])) {
+        if (!replay->mismatches)
+            pclog("Voodoo replay: frame %i differs from the capture\n", replay->frame);
+        replay->mismatches++;
+    }
+
+    replay->frame++;
+}
+
+void
+voodoo_replay_open(voodoo_t *voodoo)
+{
+    voodoo_replay_t        *replay;
+    voodoo_capture_header_t header;
+    int                     frames;
+
+    if ((voodoo_replay_path[0] == '\0') || (replay_voodoo != NULL))
+        return;
+
+    replay = calloc(1, sizeof(voodoo_replay_t));
+
+    /*Asked for on the command line, so there is no point in carrying on
+      without it*/
+    frames = voodoo_capture_read(voodoo_replay_path, &header, replay_add_frame, replay);
+    if (frames < 0)
+        fatal("Voodoo replay: %s is not a valid capture\n", voodoo_replay_path);
+    if ((header.type != voodoo->type) || (header.fb_mask != voodoo->fb_mask) ||
+        (header.texture_mask != voodoo->texture_mask) || (header.dual_tmus != voodoo->dual_tmus))
+        fatal("Voodoo replay: %s was captured on a different card or memory size\n", voodoo_replay_path);
+
+    replay->fp = plat_fopen(voodoo_replay_path, "rb");
+    if (replay->fp == NULL)
+        fatal("Voodoo replay: unable to open %s\n", voodoo_replay_path);
+    fseek(replay->fp, sizeof(voodoo_capture_header_t), SEEK_SET);
+
+    voodoo->replay = replay;
+    replay_voodoo  = voodoo;
+    timer_add(&replay->timer, replay_poll, voodoo, 1);
+
+    voodoo_replay_log("Voodoo replay: %s, %i frames\n", voodoo_replay_path, replay->frames);
+}
+
+void
+voodoo_replay_close(voodoo_t *voodoo)
+{
+    voodoo_replay_t *replay = voodoo->replay;
+
+    if (replay == NULL)
+        return;
+
+    if (!replay->done)
+        pclog("Voodoo replay: stopped after %i of %i frames\n", replay->frame, replay->frames);
+
+    timer_disable(&replay->timer);
+    voodoo->replay = NULL;
+    replay_voodoo  = NULL;
+
+    fclose(replay->fp);
+    free(replay->checksums);
+    free(replay);
+}
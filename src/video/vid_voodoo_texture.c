@@ -31,6 +31,7 @@
 #include <86box/timer.h>
 #include <86box/device.h>
 #include <86box/plat.h>
+#include <86box/perf.h>
 #include <86box/thread.h>
 #include <86box/video.h>
 #include <86box/vid_svga.h>
@@ -239,15 +240,99 @@ voodoo_recalc_tex3(voodoo_t *voodoo, int tmu)
 
 #define makergba(r, g, b, a) ((b) | ((g) << 8) | ((r) << 16) | ((a) << 24))
 
+#define TEX_DATA_SIZE ((256 * 256 + 256 * 256 + 128 * 128 + 64 * 64 + 32 * 32 + 16 * 16 + 8 * 8 + 4 * 4 + 2 * 2) * 4)
+
+static int
+texture_hash(uint32_t base, uint32_t tLOD, uint32_t palette_checksum, uint32_t tformat)
+{
+    uint32_t hash = (base >> 3) ^ (tLOD * 0x9e3779b1) ^ palette_checksum ^ (tformat << 24);
+
+    hash ^= hash >> 15;
+    hash *= 0x85ebca6b;
+    hash ^= hash >> 13;
+
+    return hash & (TEX_HASH_SIZE - 1);
+}
+
+/*Add (count = 1) or drop (count = -1) the texture's memory ranges from the
+  pages texture writes check against*/
+static void
+texture_mark_present(voodoo_t *voodoo, int tmu, const texture_t *tex, int count)
+{
+    for (uint8_t d = 0; d < 4; d++) {
+        uint32_t addr     = tex->addr_start[d];
+        uint32_t addr_end = tex->addr_end[d];
+
+        if (addr_end != 0) {
+            for (; addr <= addr_end; addr += (1 << TEX_DIRTY_SHIFT))
+                voodoo->texture_present[tmu][(addr & voodoo->texture_mask) >> TEX_DIRTY_SHIFT] += count;
+        }
+    }
+}
+
+static void
+texture_remove(voodoo_t *voodoo, int tmu, int c)
+{
+    texture_t *tex  = &voodoo->texture_cache[tmu][c];
+    int       *next = &voodoo->texture_hash[tmu][tex->hash];
+
+    while (*next != c)
+        next = &voodoo->texture_cache[tmu][*next].hash_next;
+    *next = tex->hash_next;
+
+    texture_mark_present(voodoo, tmu, tex, -1);
+    tex->base = -1;
+}
+
+void
+voodoo_texture_cache_init(voodoo_t *voodoo)
+{
+    int size = TEX_CACHE_DEFAULT;
+
+    /*Round down to a power of 2, eviction wraps with a mask*/
+    while ((size << 1) <= voodoo->texture_cache_size)
+        size <<= 1;
+    voodoo->texture_cache_size = size;
+
+    /*Both TMUs get entries even on single TMU cards, as the renderer always
+      looks up tex_entry[1]. Entry data is only allocated once first used*/
+    for (uint8_t tmu = 0; tmu < 2; tmu++) {
+        voodoo->texture_cache[tmu] = calloc(size, sizeof(texture_t));
+        for (int c = 0; c < size; c++)
+            voodoo->texture_cache[tmu][c].base = -1; /*invalid*/
+    }
+
+    for (uint8_t tmu = 0; tmu < 2; tmu++) {
+        for (int c = 0; c < TEX_HASH_SIZE; c++)
+            voodoo->texture_hash[tmu][c] = -1;
+    }
+}
+
+void
+voodoo_texture_cache_close(voodoo_t *voodoo)
+{
+    for (uint8_t tmu = 0; tmu < 2; tmu++) {
+        if (!voodoo->texture_cache[tmu])
+            continue;
+
+        for (int c = 0; c < voodoo->texture_cache_size; c++)
+            free(voodoo->texture_cache[tmu][c].data);
+        free(voodoo->texture_cache[tmu]);
+        voodoo->texture_cache[tmu] = NULL;
+    }
+}
+
 void
 voodoo_use_texture(voodoo_t *voodoo, voodoo_params_t *params, int tmu)
 {
-    int      c;
-    int      lod_min;
-    int      lod_max;
-    uint32_t addr = 0;
-    uint32_t addr_end;
-    uint32_t palette_checksum;
+    int        c;
+    int        hash;
+    int        lod_min;
+    int        lod_max;
+    uint32_t   addr = 0;
+    uint32_t   tLOD;
+    uint32_t   palette_checksum;
+    texture_t *tex;
 
     lod_min = (params->tLOD[tmu] >> 2) & 15;
     lod_max = (params->tLOD[tmu] >> 8) & 15;
@@ -271,36 +356,46 @@ voodoo_use_texture(voodoo_t *voodoo, voodoo_params_t *params, int tmu)
     else
         addr = params->texBaseAddr[tmu];
 
+    tLOD = params->tLOD[tmu] & 0xf00fff;
+    hash = texture_hash(addr, tLOD, palette_checksum, params->tformat[tmu]);
+
     /*Try to find texture in cache*/
-    for (c = 0; c < TEX_CACHE_MAX; c++) {
-        if (voodoo->texture_cache[tmu][c].base == addr && voodoo->texture_cache[tmu][c].tLOD == (params->tLOD[tmu] & 0xf00fff) && voodoo->texture_cache[tmu][c].palette_checksum == palette_checksum) {
+    for (c = voodoo->texture_hash[tmu][hash]; c != -1; c = tex->hash_next) {
+        tex = &voodoo->texture_cache[tmu][c];
+        if (tex->base == addr && tex->tLOD == tLOD && tex->palette_checksum == palette_checksum && tex->tformat == params->tformat[tmu]) {
             params->tex_entry[tmu] = c;
-            voodoo->texture_cache[tmu][c].refcount++;
+            tex->refcount++;
+            perf_counters.voodoo_tex_hits++;
             return;
         }
     }
+    perf_counters.voodoo_tex_misses++;
 
     /*Texture not found, search for unused texture*/
     do {
-        for (c = 0; c < TEX_CACHE_MAX; c++) {
+        for (c = 0; c < voodoo->texture_cache_size; c++) {
             voodoo->texture_last_removed++;
-            voodoo->texture_last_removed &= (TEX_CACHE_MAX - 1);
-            if (voodoo->texture_cache[tmu][voodoo->texture_last_removed].refcount == voodoo->texture_cache[tmu][voodoo->texture_last_removed].refcount_r[0] && (voodoo->render_threads == 1 || voodoo->texture_cache[tmu][voodoo->texture_last_removed].refcount == voodoo->texture_cache[tmu][voodoo->texture_last_removed].refcount_r[1]))
+            voodoo->texture_last_removed &= (voodoo->texture_cache_size - 1);
+            if (voodoo->texture_cache[tmu][voodoo->texture_last_removed].refcount == voodoo->texture_cache[tmu][voodoo->texture_last_removed].refcount_r)
                 break;
         }
-        if (c == TEX_CACHE_MAX)
+        if (c == voodoo->texture_cache_size)
             voodoo_wait_for_render_thread_idle(voodoo);
-    } while (c == TEX_CACHE_MAX);
-    if (c == TEX_CACHE_MAX)
-        fatal("Texture cache full!\n");
+    } while (c == voodoo->texture_cache_size);
 
-    c = voodoo->texture_last_removed;
+    c   = voodoo->texture_last_removed;
+    tex = &voodoo->texture_cache[tmu][c];
 
-    if ((voodoo->params.tLOD[tmu] & LOD_SPLIT) && (voodoo->params.tLOD[tmu] & LOD_ODD) && (voodoo->params.tLOD[tmu] & LOD_TMULTIBASEADDR))
-        voodoo->texture_cache[tmu][c].base = params->texBaseAddr1[tmu];
-    else
-        voodoo->texture_cache[tmu][c].base = params->texBaseAddr[tmu];
-    voodoo->texture_cache[tmu][c].tLOD = params->tLOD[tmu] & 0xf00fff;
+    if (tex->base != -1) {
+        texture_remove(voodoo, tmu, c);
+        perf_counters.voodoo_tex_evicted++;
+    }
+    if (!tex->data)
+        tex->data = malloc(TEX_DATA_SIZE);
+
+    tex->base    = addr;
+    tex->tLOD    = tLOD;
+    tex->tformat = params->tformat[tmu];
 
     lod_min = (params->tLOD[tmu] >> 2) & 15;
     lod_max = (params->tLOD[tmu] >> 8) & 15;
@@ -536,18 +631,14 @@ voodoo_use_texture(voodoo_t *voodoo, voodoo_params_t *params, int tmu)
     } else
         voodoo->texture_cache[tmu][c].addr_start[3] = voodoo->texture_cache[tmu][c].addr_end[3] = 0;
 
-    for (uint8_t d = 0; d < 4; d++) {
-        addr     = voodoo->texture_cache[tmu][c].addr_start[d];
-        addr_end = voodoo->texture_cache[tmu][c].addr_end[d];
+    texture_mark_present(voodoo, tmu, tex, 1);
 
-        if (addr_end != 0) {
-            for (; addr <= addr_end; addr += (1 << TEX_DIRTY_SHIFT))
-                voodoo->texture_present[tmu][(addr & voodoo->texture_mask) >> TEX_DIRTY_SHIFT] = 1;
-        }
-    }
+    tex->hash                        = hash;
+    tex->hash_next                   = voodoo->texture_hash[tmu][hash];
+    voodoo->texture_hash[tmu][hash] = c;
 
     params->tex_entry[tmu] = c;
-    voodoo->texture_cache[tmu][c].refcount++;
+    tex->refcount++;
 }
 
 void
@@ -555,11 +646,12 @@ flush_texture_cache(voodoo_t *voodoo, uint32_t dirty_addr, int tmu)
 {
     int wait_for_idle = 0;
 
-    memset(voodoo->texture_present[tmu], 0, sizeof(voodoo->texture_present[0]));
 #if 0
     voodoo_texture_log("Evict %08x %i\n", dirty_addr, sizeof(voodoo->texture_present));
 #endif
-    for (uint8_t c = 0; c < TEX_CACHE_MAX; c++) {
+    /*Only the textures covering the written page are dropped, the page
+      counts of everything else stay as they are*/
+    for (int c = 0; c < voodoo->texture_cache_size; c++) {
         if (voodoo->texture_cache[tmu][c].base != -1) {
             for (uint8_t d = 0; d < 4; d++) {
                 int addr_start = voodoo->texture_cache[tmu][c].addr_start[d];
@@ -576,13 +668,12 @@ flush_texture_cache(voodoo_t *voodoo, uint32_t dirty_addr, int tmu)
                         voodoo_texture_log("  Evict texture %i %08x\n", c, voodoo->texture_cache[tmu][c].base);
 #endif
 
-                        if (voodoo->texture_cache[tmu][c].refcount != voodoo->texture_cache[tmu][c].refcount_r[0] || (voodoo->render_threads == 2 && voodoo->texture_cache[tmu][c].refcount != voodoo->texture_cache[tmu][c].refcount_r[1]))
+                        if (voodoo->texture_cache[tmu][c].refcount != voodoo->texture_cache[tmu][c].refcount_r)
                             wait_for_idle = 1;
 
-                        voodoo->texture_cache[tmu][c].base = -1;
-                    } else {
-                        for (; addr_start <= addr_end; addr_start += (1 << TEX_DIRTY_SHIFT))
-                            voodoo->texture_present[tmu][(addr_start & voodoo->texture_mask) >> TEX_DIRTY_SHIFT] = 1;
+                        texture_remove(voodoo, tmu, c);
+                        perf_counters.voodoo_tex_invalidated++;
+                        break;
                     }
                 }
             }
@@ -3126,6 +3126,11 @@ xga_poll(void *priv)
                 xga_render_overscan_right(xga, svga);
                 svga->x_add = (overscan_x >> 1);
 
+                /* The renderers move lastline_draw onto the lines they redraw;
+                   svga_doblit() only hands marked lines on to the blitter. */
+                if ((xga->lastline_draw == xga->displine) || xga->hwcursor_on)
+                    svga->dirty_lines[(xga->displine + svga->y_add) & 0x7ff] = 1;
+
                 if (xga->hwcursor_on) {
                     xga_hwcursor_draw(svga, xga->displine + svga->y_add);
                     xga->hwcursor_on--;
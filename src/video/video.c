@@ -73,6 +73,7 @@
 #include <86box/thread.h>
 #include <86box/video.h>
 #include <86box/vid_svga.h>
+#include <86box/perf.h>
 
 #include <minitrace/minitrace.h>
 
@@ -234,13 +235,36 @@ const uint32_t shade[5][256] = {
     }
 };
 
+/* Frames are handed to the blit thread by swapping target buffers rather
+   than by waiting for the renderer: one buffer is drawn into by the video
+   card, one holds the frame queued for the blit thread and one is read by
+   the renderer, so the emulation thread always has a free buffer to draw
+   the next frame into. */
+#define BLIT_BUFFERS 3
+
+typedef struct blit_frame_t {
+    int      buf; /* index into buffers, -1 = none */
+    int      x, y, w, h;
+    uint32_t seq;
+} blit_frame_t;
+
 typedef struct blit_data_struct {
-    int x, y, w, h;
+    int x, y, w, h; /* geometry of the last frame submitted */
     int busy;
     int buffer_in_use;
     int thread_run;
     int monitor_index;
 
+    uint32_t seq;            /* number of the last blit submitted */
+    uint32_t line_seq[2048]; /* number of the blit each line last changed in */
+
+    bitmap_t    *buffers[BLIT_BUFFERS];
+    uint32_t     buffer_seq[BLIT_BUFFERS]; /* number of the blit each buffer is up to date with */
+    int          back;                     /* buffer the video card draws into */
+    blit_frame_t pending;                  /* submitted, not picked up by the blit thread yet */
+    blit_frame_t front;                    /* being read by the renderer */
+
+    mutex_t  *lock;
     thread_t *blit_thread;
     event_t  *wake_blit_thread;
     event_t  *blit_complete;
@@ -275,11 +299,16 @@ video_setblit(void (*blit)(int, int, int, int, int))
     blit_func = blit;
 }
 
+/* Called by the renderers once they no longer need the frame's buffer. */
 void
 video_blit_complete_monitor(int monitor_index)
 {
-    blit_data_t *blit_data_ptr   = monitors[monitor_index].mon_blit_data_ptr;
+    blit_data_t *blit_data_ptr = monitors[monitor_index].mon_blit_data_ptr;
+
+    thread_wait_mutex(blit_data_ptr->lock);
     blit_data_ptr->buffer_in_use = 0;
+    blit_data_ptr->front.buf     = -1;
+    thread_release_mutex(blit_data_ptr->lock);
 
     thread_set_event(blit_data_ptr->buffer_not_in_use);
 }
@@ -288,20 +317,35 @@ void
 video_wait_for_blit_monitor(int monitor_index)
 {
     blit_data_t *blit_data_ptr = monitors[monitor_index].mon_blit_data_ptr;
+    uint64_t     start;
+
+    if (!blit_data_ptr->busy)
+        return;
 
+    start = plat_get_micro_ticks();
     while (blit_data_ptr->busy)
         thread_wait_event(blit_data_ptr->blit_complete, -1);
     thread_reset_event(blit_data_ptr->blit_complete);
+    perf_counters.video_blit_wait_us += plat_get_micro_ticks() - start;
 }
 
+/* With the target buffers swapped on every blit, the buffer being drawn into
+   is never the one the renderer reads, so this only waits if that ever
+   stops being the case. */
 void
 video_wait_for_buffer_monitor(int monitor_index)
 {
     blit_data_t *blit_data_ptr = monitors[monitor_index].mon_blit_data_ptr;
+    uint64_t     start;
 
-    while (blit_data_ptr->buffer_in_use)
+    if (!blit_data_ptr->buffer_in_use || (blit_data_ptr->front.buf != blit_data_ptr->back))
+        return;
+
+    start = plat_get_micro_ticks();
+    while (blit_data_ptr->buffer_in_use && (blit_data_ptr->front.buf == blit_data_ptr->back))
         thread_wait_event(blit_data_ptr->buffer_not_in_use, -1);
     thread_reset_event(blit_data_ptr->buffer_not_in_use);
+    perf_counters.video_blit_wait_us += plat_get_micro_ticks() - start;
 }
 
 static png_structp png_ptr[MONITORS_NUM];
@@ -340,20 +384,20 @@ video_take_screenshot_monitor(const char *fn, uint32_t *buf, int start_x, int st
 
     png_init_io(png_ptr[monitor_index], fp);
 
-    png_set_IHDR(png_ptr[monitor_index], info_ptr[monitor_index], blit_data_ptr->w, blit_data_ptr->h,
+    png_set_IHDR(png_ptr[monitor_index], info_ptr[monitor_index], blit_data_ptr->front.w, blit_data_ptr->front.h,
                  8, PNG_COLOR_TYPE_RGB, PNG_INTERLACE_NONE,
                  PNG_COMPRESSION_TYPE_BASE, PNG_FILTER_TYPE_BASE);
 
-    b_rgb = (png_bytep *) malloc(sizeof(png_bytep) * blit_data_ptr->h);
+    b_rgb = (png_bytep *) malloc(sizeof(png_bytep) * blit_data_ptr->front.h);
     if (b_rgb == NULL) {
         video_log("[video_take_screenshot] Unable to Allocate RGB Bitmap Memory");
         fclose(fp);
         return;
     }
 
-    for (int y = 0; y < blit_data_ptr->h; ++y) {
+    for (int y = 0; y < blit_data_ptr->front.h; ++y) {
         b_rgb[y] = (png_byte *) malloc(png_get_rowbytes(png_ptr[monitor_index], info_ptr[monitor_index]));
-        for (int x = 0; x < blit_data_ptr->w; ++x) {
+        for (int x = 0; x < blit_data_ptr->front.w; ++x) {
             if (buf == NULL)
                 memset(&(b_rgb[y][x * 3]), 0x00, 3);
             else {
@@ -372,7 +416,7 @@ video_take_screenshot_monitor(const char *fn, uint32_t *buf, int start_x, int st
     png_write_end(png_ptr[monitor_index], NULL);
 
     /* cleanup heap allocation */
-    for (int i = 0; i < blit_data_ptr->h; i++)
+    for (int i = 0; i < blit_data_ptr->front.h; i++)
         if (b_rgb[i])
             free(b_rgb[i]);
 
@@ -445,42 +489,211 @@ static void
 blit_thread(void *param)
 {
     blit_data_t *data = param;
+    char         name[16];
+
+    sprintf(name, "blit%i", data->monitor_index);
+    perf_thread_register(name);
+
     while (data->thread_run) {
         thread_wait_event(data->wake_blit_thread, -1);
         thread_reset_event(data->wake_blit_thread);
         MTR_BEGIN("video", "blit_thread");
 
-        if (blit_func)
-            blit_func(data->x, data->y, data->w, data->h, data->monitor_index);
+        /* Only the newest frame is ever queued, so a slow renderer skips
+           frames instead of holding up the emulation. */
+        while (1) {
+            thread_wait_mutex(data->lock);
+            if (data->pending.buf == -1) {
+                data->busy = 0;
+                thread_release_mutex(data->lock);
+                break;
+            }
+            data->front         = data->pending;
+            data->pending.buf   = -1;
+            data->buffer_in_use = 1;
+            thread_release_mutex(data->lock);
 
-        data->busy = 0;
+            if (blit_func)
+                blit_func(data->front.x, data->front.y, data->front.w, data->front.h, data->monitor_index);
+            else
+                video_blit_complete_monitor(data->monitor_index);
+        }
 
         MTR_END("video", "blit_thread");
         thread_set_event(data->blit_complete);
     }
 }
 
+/* Picks the buffer the video card draws the next frame into and brings it up
+   to date with the frame just submitted. Only the lines that changed since
+   the buffer last held a frame are copied, so a static screen costs
+   nothing. */
+static void
+video_blit_swap_buffers(blit_data_t *data, const blit_frame_t *frame, int monitor_index)
+{
+    const bitmap_t *src;
+    bitmap_t       *dst;
+    int             next = -1;
+
+    thread_wait_mutex(data->lock);
+    for (int i = 0; i < BLIT_BUFFERS; i++) {
+        if ((i == frame->buf) || (i == data->pending.buf) || (i == data->front.buf))
+            continue;
+        if ((next == -1) || (data->buffer_seq[i] > data->buffer_seq[next]))
+            next = i;
+    }
+    thread_release_mutex(data->lock);
+
+    src = data->buffers[frame->buf];
+    dst = data->buffers[next];
+    for (int i = 0; i < frame->h; i++) {
+        int line = (frame->y + i) & 0x7ff;
+
+        if (data->line_seq[line] > data->buffer_seq[next])
+            memcpy(&dst->line[line][frame->x], &src->line[line][frame->x], frame->w * sizeof(uint32_t));
+    }
+
+    data->buffer_seq[next]               = frame->seq;
+    data->back                           = next;
+    monitors[monitor_index].target_buffer = dst;
+}
+
+/* Submits a frame to the blitter. If dirty is not NULL, it flags (indexed by
+   target buffer line) the lines that changed since the previous frame, and
+   only those get copied out by the renderers; otherwise every line in the
+   rectangle is assumed to have changed. */
 void
-video_blit_memtoscreen_monitor(int x, int y, int w, int h, int monitor_index)
+video_blit_memtoscreen_dirty_monitor(int x, int y, int w, int h, const uint8_t *dirty, int monitor_index)
 {
+    blit_data_t *data    = monitors[monitor_index].mon_blit_data_ptr;
+    blit_frame_t frame;
+    int          changed = 0;
+
     MTR_BEGIN("video", "video_blit_memtoscreen");
 
     if ((w <= 0) || (h <= 0))
         return;
 
-    video_wait_for_blit_monitor(monitor_index);
+    /* Line stamps only ever grow, so the renderer reading them while they
+       are updated at worst copies a line once more than needed. A change in
+       geometry invalidates everything the renderers hold. */
+    data->seq++;
+    if ((dirty == NULL) || (x != data->x) || (y != data->y) || (w != data->w) || (h != data->h))
+        dirty = NULL;
+
+    for (int i = 0; i < h; i++) {
+        if ((dirty == NULL) || dirty[(y + i) & 0x7ff]) {
+            data->line_seq[(y + i) & 0x7ff] = data->seq;
+            changed++;
+        }
+    }
 
-    monitors[monitor_index].mon_blit_data_ptr->busy          = 1;
-    monitors[monitor_index].mon_blit_data_ptr->buffer_in_use = 1;
-    monitors[monitor_index].mon_blit_data_ptr->x             = x;
-    monitors[monitor_index].mon_blit_data_ptr->y             = y;
-    monitors[monitor_index].mon_blit_data_ptr->w             = w;
-    monitors[monitor_index].mon_blit_data_ptr->h             = h;
+    perf_counters.video_lines_copied += changed;
+    perf_counters.video_lines_skipped += h - changed;
 
-    thread_set_event(monitors[monitor_index].mon_blit_data_ptr->wake_blit_thread);
+    data->x = x;
+    data->y = y;
+    data->w = w;
+    data->h = h;
+
+    frame.buf = data->back;
+    frame.x   = x;
+    frame.y   = y;
+    frame.w   = w;
+    frame.h   = h;
+    frame.seq = data->seq;
+
+    data->buffer_seq[frame.buf] = frame.seq;
+
+    /* Queue the frame, replacing one the blit thread has not got to yet. */
+    thread_wait_mutex(data->lock);
+    if (data->pending.buf != -1)
+        perf_counters.video_frames_dropped++;
+    data->pending = frame;
+    data->busy    = 1;
+    thread_release_mutex(data->lock);
+
+    video_blit_swap_buffers(data, &frame, monitor_index);
+
+    thread_set_event(data->wake_blit_thread);
     MTR_END("video", "video_blit_memtoscreen");
 }
 
+void
+video_blit_memtoscreen_monitor(int x, int y, int w, int h, int monitor_index)
+{
+    video_blit_memtoscreen_dirty_monitor(x, y, w, h, NULL, monitor_index);
+}
+
+/* Called by the renderers from the blit thread. Copies the lines of the
+   current frame that changed since the frame numbered *seq (0 = all of them)
+   from the target buffer to dst, one line every pitch bytes, and updates
+   *seq. Returns the number of lines copied, first and last (if not NULL) get
+   the first and last line copied, relative to the frame. */
+int
+video_blit_copy_monitor(uint8_t *dst, int pitch, uint32_t *seq, int *first, int *last, int monitor_index)
+{
+    const blit_data_t  *data   = monitors[monitor_index].mon_blit_data_ptr;
+    const blit_frame_t *frame  = &data->front;
+    const bitmap_t     *buf;
+    int                 copied = 0;
+
+    if (first)
+        *first = -1;
+    if (last)
+        *last = -1;
+
+    if (frame->buf == -1)
+        return 0;
+    buf = data->buffers[frame->buf];
+
+    for (int i = 0; i < frame->h; i++) {
+        if ((*seq != 0) && (data->line_seq[(frame->y + i) & 0x7ff] <= *seq))
+            continue;
+
+        video_copy(&dst[i * pitch], &(buf->line[frame->y + i][frame->x]), frame->w * sizeof(uint32_t));
+
+        if (first && (*first == -1))
+            *first = i;
+        if (last)
+            *last = i;
+        copied++;
+    }
+
+    *seq = frame->seq;
+
+    return copied;
+}
+
+/* Like video_blit_copy_monitor(), but hands each line that changed to func
+   straight from the target buffer, for renderers that compare it against
+   what they already hold before copying any of it. line is relative to the
+   frame. Returns the number of lines passed to func. */
+int
+video_blit_lines_monitor(void (*func)(int line, const uint32_t *src, int w, void *priv), void *priv, uint32_t *seq, int monitor_index)
+{
+    const blit_data_t  *data  = monitors[monitor_index].mon_blit_data_ptr;
+    const blit_frame_t *frame = &data->front;
+    const bitmap_t     *buf;
+    int                 lines = 0;
+
+    if (frame->buf == -1)
+        return 0;
+    buf = data->buffers[frame->buf];
+
+    for (int i = 0; i < frame->h; i++) {
+        if ((*seq != 0) && (data->line_seq[(frame->y + i) & 0x7ff] <= *seq))
+            continue;
+
+        func(i, &(buf->line[frame->y + i][frame->x]), frame->w, priv);
+        lines++;
+    }
+
+    *seq = frame->seq;
+
+    return lines;
+}
+
 uint8_t
 pixels8(uint32_t *pixels)
 {
@@ -857,8 +1070,13 @@ video_monitor_init(int index)
     monitors[index].mon_unscaled_size_y                  = 480;
     monitors[index].mon_bpp                              = 8;
     monitors[index].mon_changeframecount                 = 2;
-    monitors[index].target_buffer                        = create_bitmap(2048, 2048);
     monitors[index].mon_blit_data_ptr                    = calloc(1, sizeof(blit_data_t));
+    for (int i = 0; i < BLIT_BUFFERS; i++)
+        monitors[index].mon_blit_data_ptr->buffers[i] = create_bitmap(2048, 2048);
+    monitors[index].mon_blit_data_ptr->pending.buf       = -1;
+    monitors[index].mon_blit_data_ptr->front.buf         = -1;
+    monitors[index].mon_blit_data_ptr->lock              = thread_create_mutex();
+    monitors[index].target_buffer                        = monitors[index].mon_blit_data_ptr->buffers[0];
     monitors[index].mon_blit_data_ptr->wake_blit_thread  = thread_create_event();
     monitors[index].mon_blit_data_ptr->blit_complete     = thread_create_event();
     monitors[index].mon_blit_data_ptr->buffer_not_in_use = thread_create_event();
@@ -889,12 +1107,14 @@ video_monitor_close(int monitor_index)
     thread_destroy_event(monitors[monitor_index].mon_blit_data_ptr->buffer_not_in_use);
     thread_destroy_event(monitors[monitor_index].mon_blit_data_ptr->blit_complete);
     thread_destroy_event(monitors[monitor_index].mon_blit_data_ptr->wake_blit_thread);
+    thread_close_mutex(monitors[monitor_index].mon_blit_data_ptr->lock);
+    for (int i = 0; i < BLIT_BUFFERS; i++)
+        destroy_bitmap(monitors[monitor_index].mon_blit_data_ptr->buffers[i]);
     free(monitors[monitor_index].mon_blit_data_ptr);
     if (!monitors[monitor_index].mon_pal_lookup_static)
         free(monitors[monitor_index].mon_pal_lookup);
     if (!monitors[monitor_index].mon_cga_palette_static)
         free(monitors[monitor_index].mon_cga_palette);
-    destroy_bitmap(monitors[monitor_index].target_buffer);
     monitors[monitor_index].target_buffer = NULL;
     memset(&monitors[monitor_index], 0, sizeof(monitor_t));
 }
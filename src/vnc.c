@@ -31,12 +31,24 @@
 #include <86box/plat.h>
 #include <86box/ui.h>
 #include <86box/vnc.h>
+#include <86box/perf.h>
 
 #define VNC_MIN_X 320
 #define VNC_MAX_X 2048
 #define VNC_MIN_Y 200
 #define VNC_MAX_Y 2048
 
+/* Changed lines are compared against the frame buffer in tiles, and only
+   the tiles that differ are copied and marked modified, so the clients
+   only get to encode what actually changed on screen. */
+#define VNC_TILE_W     64
+#define VNC_TILE_H     16
+#define VNC_TILES_X    (VNC_MAX_X / VNC_TILE_W)
+#define VNC_TILES_Y    (VNC_MAX_Y / VNC_TILE_H)
+
+#define TILE_TOUCHED   1 /* on a line that changed */
+#define TILE_MODIFIED  2 /* contents differ from the frame buffer */
+
 static rfbScreenInfoPtr rfb = NULL;
 static int              clients;
 static int              updatingSize;
@@ -45,6 +57,9 @@ static int              allowedY;
 static int              ptr_x;
 static int              ptr_y;
 static int              ptr_but;
+static uint32_t         fb_seq;
+static int              fb_stale;
+static uint8_t          tiles[VNC_TILES_Y][VNC_TILES_X];
 
 #ifdef ENABLE_VNC_LOG
 int vnc_do_log = ENABLE_VNC_LOG;
@@ -173,24 +188,87 @@ vnc_display(rfbClientPtr cl)
     }
 }
 
+/* Compares one changed line against the frame buffer a tile at a time and
+   copies the tiles that differ. */
+static void
+vnc_blit_line(int line, const uint32_t *src, int w, UNUSED(void *priv))
+{
+    uint32_t *dst = &((uint32_t *) rfb->frameBuffer)[line * VNC_MAX_X];
+    uint8_t  *row = tiles[line / VNC_TILE_H];
+
+    for (int x = 0; x < w; x += VNC_TILE_W) {
+        int len = ((w - x) < VNC_TILE_W) ? (w - x) : VNC_TILE_W;
+
+        row[x / VNC_TILE_W] |= TILE_TOUCHED;
+        if (memcmp(&dst[x], &src[x], len * sizeof(uint32_t))) {
+            memcpy(&dst[x], &src[x], len * sizeof(uint32_t));
+            row[x / VNC_TILE_W] |= TILE_MODIFIED;
+        }
+    }
+}
+
+/* Marks the modified tiles, merging runs of them along a row of tiles into
+   one rectangle, and clears the tile state for the next frame. */
+static void
+vnc_mark_tiles(int mark)
+{
+    for (int ty = 0; ty < VNC_TILES_Y; ty++) {
+        uint8_t *row = tiles[ty];
+        int      y1  = (ty + 1) * VNC_TILE_H;
+
+        for (int tx = 0; tx < VNC_TILES_X; tx++) {
+            int start = tx;
+
+            if (!(row[tx] & TILE_MODIFIED)) {
+                if (row[tx])
+                    perf_counters.vnc_tiles_skipped++;
+                row[tx] = 0;
+                continue;
+            }
+
+            while ((tx < VNC_TILES_X) && (row[tx] & TILE_MODIFIED)) {
+                row[tx] = 0;
+                tx++;
+            }
+            perf_counters.vnc_tiles_sent += tx - start;
+
+            if (mark && ((start * VNC_TILE_W) < allowedX) && ((ty * VNC_TILE_H) < allowedY))
+                rfbMarkRectAsModified(rfb, start * VNC_TILE_W, ty * VNC_TILE_H,
+                                      ((tx * VNC_TILE_W) < allowedX) ? (tx * VNC_TILE_W) : allowedX,
+                                      (y1 < allowedY) ? y1 : allowedY);
+            tx--;
+        }
+    }
+}
+
 static void
 vnc_blit(int x, int y, int w, int h, int monitor_index)
 {
+    int lines;
+
     if (monitor_index || (x < 0) || (y < 0) || (w < VNC_MIN_X) || (h < VNC_MIN_Y) || (w > VNC_MAX_X) || (h > VNC_MAX_Y) || (buffer32 == NULL)) {
         video_blit_complete_monitor(monitor_index);
         return;
     }
 
-    for (int row = 0; row < h; ++row)
-        video_copy(&(((uint8_t *) rfb->frameBuffer)[row * 2048 * sizeof(uint32_t)]), &(buffer32->line[y + row][x]), w * sizeof(uint32_t));
+    /* Only the lines that changed since the last frame need looking at. */
+    lines = video_blit_lines_monitor(vnc_blit_line, NULL, &fb_seq, monitor_index);
 
     if (screenshots)
         video_screenshot((uint32_t *) rfb->frameBuffer, 0, 0, VNC_MAX_X);
 
     video_blit_complete_monitor(monitor_index);
 
-    if (!updatingSize)
+    /* Changes made while a resize is pending are sent in one go afterwards. */
+    if (updatingSize) {
+        fb_stale = 1;
+        vnc_mark_tiles(0);
+    } else if (fb_stale) {
         rfbMarkRectAsModified(rfb, 0, 0, allowedX, allowedY);
+        vnc_mark_tiles(0);
+        fb_stale = 0;
+    } else if (lines)
+        vnc_mark_tiles(1);
 }
 
 /* Initialize VNC for operation. */
@@ -223,6 +301,7 @@ vnc_init(UNUSED(void *arg))
         rfb              = rfbGetScreen(0, NULL, VNC_MAX_X, VNC_MAX_Y, 8, 3, 4);
         rfb->desktopName = title;
         rfb->frameBuffer = (char *) malloc(VNC_MAX_X * VNC_MAX_Y * 4);
+        fb_seq           = 0;
 
         rfb->serverFormat  = rpf;
         rfb->alwaysShared  = TRUE;